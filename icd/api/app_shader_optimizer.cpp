@@ -38,21 +38,297 @@
 
 #include "palDbgPrint.h"
 #include "palFile.h"
+#include "palHashMapImpl.h"
+#include "palInlineFuncs.h"
+#include "palSysUtil.h"
+#include "palVectorImpl.h"
+
+#include <algorithm>
 
 #if VKI_RUNTIME_APP_PROFILE
 #include "utils/json_reader.h"
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#endif
 #endif
 
 namespace vk
 {
 
+// Hash buckets of the profile indices.  Runtime profiles generated by tuning tools can have thousands of entries.
+constexpr uint32_t ProfileIndexBuckets        = 64;
+constexpr uint32_t RuntimeProfileIndexBuckets = 1024;
+
+#if VKI_RUNTIME_APP_PROFILE
+// Minimum number of keys for a runtime profile JSON object to get a hashed key index.
+constexpr uint32_t RuntimeProfileJsonKeyIndexMinKeys = 8;
+
+// Header of the binary form of a parsed runtime pipeline profile, stored next to the JSON file it was parsed from.  The
+// profile entries directly follow the header and are used in place from a read-only mapping of the file.
+struct RuntimeProfileBinaryHeader
+{
+    uint32_t              magic;
+    uint32_t              version;
+    uint32_t              buildHash;   // utils::GetBuildTimeHash() of the driver which wrote the file
+    uint32_t              entrySize;   // sizeof(PipelineProfileEntry)
+    Util::MetroHash::Hash jsonHash;    // Hash of the contents of the JSON file
+    uint64_t              entryCount;
+    uint64_t              fileSize;
+};
+
+constexpr uint32_t RuntimeProfileBinaryMagic   = 0x50505256; // "VRPP"
+constexpr uint32_t RuntimeProfileBinaryVersion = 1;
+
+static_assert((sizeof(RuntimeProfileBinaryHeader) % alignof(PipelineProfileEntry)) == 0,
+              "Runtime profile binary entries must be naturally aligned");
+#endif
+
+// =====================================================================================================================
+PipelineProfileIndex::PipelineProfileIndex(
+    uint32_t      numBuckets,
+    PalAllocator* pAllocator)
+    :
+    m_shaderMap(numBuckets, pAllocator),
+    m_pEntryIndices(nullptr),
+    m_wildcards{},
+    m_valid(false)
+{
+}
+
+// =====================================================================================================================
+// Builds the index for the given profile.  The profile must not be modified afterwards.
+void PipelineProfileIndex::Build(
+    const PipelineProfile&       profile,
+    const VkAllocationCallbacks* pAllocCB)
+{
+    struct Record
+    {
+        ShaderKey key;
+        uint32_t  entryIdx;
+    };
+
+    // An entry is indexed if it can only match pipelines containing a shader with a specific stage and code hash.
+    // Shader-only patterns compare the target shader against the pattern hash of its own stage, so they are indexed
+    // under every stage.
+    auto GetRecordCount = [](const PipelineProfilePattern& pattern) -> uint32_t
+    {
+        uint32_t count = 0;
+
+        if (pattern.match.always == 0)
+        {
+            for (uint32_t stage = 0; stage < ShaderStageCount; ++stage)
+            {
+                if (pattern.shaders[stage].match.codeHash != 0)
+                {
+                    count = (pattern.match.shaderOnly != 0) ? ShaderStageCount : 1;
+                    break;
+                }
+            }
+        }
+
+        return count;
+    };
+
+    uint32_t wildcardCount = 0;
+    uint32_t recordCount   = 0;
+
+    for (uint32_t entryIdx = 0; entryIdx < profile.entryCount; ++entryIdx)
+    {
+        const uint32_t count = GetRecordCount(profile.pEntries[entryIdx].pattern);
+
+        wildcardCount += (count == 0) ? 1 : 0;
+        recordCount   += count;
+    }
+
+    const size_t indicesSize = Util::Pow2Align(sizeof(uint32_t) * (wildcardCount + recordCount), alignof(Record));
+    const size_t recordsSize = sizeof(Record) * recordCount;
+
+    void* pMemory = nullptr;
+
+    if (profile.entryCount == 0)
+    {
+        m_valid = true;
+    }
+    else
+    {
+        pMemory = pAllocCB->pfnAllocation(pAllocCB->pUserData,
+                                          indicesSize + recordsSize,
+                                          VK_DEFAULT_MEM_ALIGN,
+                                          VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+    }
+
+    if ((pMemory != nullptr) && ((recordCount == 0) || (m_shaderMap.Init() == Pal::Result::Success)))
+    {
+        m_pEntryIndices = static_cast<uint32_t*>(pMemory);
+        m_valid         = true;
+
+        // Records are appended after the entry indices and are only needed until the map is built
+        Record*  pRecords    = static_cast<Record*>(Util::VoidPtrInc(pMemory, indicesSize));
+        uint32_t recordIdx   = 0;
+        uint32_t wildcardIdx = 0;
+
+        for (uint32_t entryIdx = 0; entryIdx < profile.entryCount; ++entryIdx)
+        {
+            const PipelineProfilePattern& pattern = profile.pEntries[entryIdx].pattern;
+            const uint32_t                count   = GetRecordCount(pattern);
+
+            if (count == 0)
+            {
+                m_pEntryIndices[wildcardIdx++] = entryIdx;
+            }
+
+            for (uint32_t stage = 0; (stage < ShaderStageCount) && (count > 0); ++stage)
+            {
+                if ((count == ShaderStageCount) || (pattern.shaders[stage].match.codeHash != 0))
+                {
+                    Record* pRecord = &pRecords[recordIdx++];
+
+                    memset(&pRecord->key, 0, sizeof(pRecord->key));
+                    pRecord->key.codeHash = pattern.shaders[stage].codeHash;
+                    pRecord->key.stage    = stage;
+                    pRecord->entryIdx     = entryIdx;
+
+                    if (count == 1)
+                    {
+                        break;
+                    }
+                }
+            }
+        }
+
+        VK_ASSERT((wildcardIdx == wildcardCount) && (recordIdx == recordCount));
+
+        m_wildcards.first = 0;
+        m_wildcards.count = wildcardCount;
+
+        // Group the records by shader key, keeping the profile order within each group
+        std::sort(pRecords, pRecords + recordCount, [](const Record& lhs, const Record& rhs)
+        {
+            const int cmp = memcmp(&lhs.key, &rhs.key, sizeof(ShaderKey));
+
+            return (cmp != 0) ? (cmp < 0) : (lhs.entryIdx < rhs.entryIdx);
+        });
+
+        uint32_t indexPos = wildcardCount;
+
+        for (uint32_t first = 0; (first < recordCount) && m_valid; )
+        {
+            uint32_t last = first + 1;
+
+            while ((last < recordCount) && (memcmp(&pRecords[first].key, &pRecords[last].key, sizeof(ShaderKey)) == 0))
+            {
+                ++last;
+            }
+
+            EntryRange range = { indexPos, last - first };
+
+            for (uint32_t recordIdx = first; recordIdx < last; ++recordIdx)
+            {
+                m_pEntryIndices[indexPos++] = pRecords[recordIdx].entryIdx;
+            }
+
+            m_valid = (m_shaderMap.Insert(pRecords[first].key, range) == Pal::Result::Success);
+
+            first = last;
+        }
+    }
+    else if (pMemory != nullptr)
+    {
+        pAllocCB->pfnFree(pAllocCB->pUserData, pMemory);
+    }
+}
+
+// =====================================================================================================================
+void PipelineProfileIndex::Destroy(
+    const VkAllocationCallbacks* pAllocCB)
+{
+    if (m_pEntryIndices != nullptr)
+    {
+        pAllocCB->pfnFree(pAllocCB->pUserData, m_pEntryIndices);
+        m_pEntryIndices = nullptr;
+    }
+
+    m_valid = false;
+}
+
+// =====================================================================================================================
+// Collects the indices of the profile entries that may match the given pipeline in profile order.  Returns false if the
+// index is unavailable, in which case every entry of the profile must be tested.
+bool PipelineProfileIndex::GetCandidateEntries(
+    const PipelineOptimizerKey& pipelineKey,
+    EntryList*                  pEntries,
+    uint32_t*                   pEntryCount
+    ) const
+{
+    bool     success     = m_valid;
+    uint32_t sourceCount = 0;
+
+    for (uint32_t i = 0; success && (i < m_wildcards.count); ++i)
+    {
+        success = (pEntries->PushBack(m_pEntryIndices[m_wildcards.first + i]) == Pal::Result::Success);
+    }
+
+    sourceCount += (m_wildcards.count > 0) ? 1 : 0;
+
+    for (uint32_t shaderIdx = 0;
+         success && (m_shaderMap.GetNumEntries() > 0) && (shaderIdx < pipelineKey.shaderCount);
+         ++shaderIdx)
+    {
+        const ShaderOptimizerKey& shader = pipelineKey.pShaders[shaderIdx];
+
+        ShaderKey key = {};
+        key.codeHash = shader.codeHash;
+        key.stage    = static_cast<uint32_t>(shader.stage);
+
+        const EntryRange* pRange = m_shaderMap.FindKey(key);
+
+        if (pRange != nullptr)
+        {
+            for (uint32_t i = 0; success && (i < pRange->count); ++i)
+            {
+                success = (pEntries->PushBack(m_pEntryIndices[pRange->first + i]) == Pal::Result::Success);
+            }
+
+            ++sourceCount;
+        }
+    }
+
+    uint32_t entryCount = pEntries->NumElements();
+
+    // Entries gathered from multiple shaders (or wildcards) need to be merged back into profile order
+    if (success && (sourceCount > 1))
+    {
+        uint32_t* pBegin = &pEntries->At(0);
+
+        std::sort(pBegin, pBegin + entryCount);
+        entryCount = static_cast<uint32_t>(std::unique(pBegin, pBegin + entryCount) - pBegin);
+    }
+
+    *pEntryCount = entryCount;
+
+    return success;
+}
+
 // =====================================================================================================================
 ShaderOptimizer::ShaderOptimizer(
     Device*         pDevice,
     PhysicalDevice* pPhysicalDevice)
     :
     m_pDevice(pDevice),
-    m_settings(pPhysicalDevice->GetRuntimeSettings())
+    m_settings(pPhysicalDevice->GetRuntimeSettings()),
+    m_tuningProfileIndex(ProfileIndexBuckets, pDevice->VkInstance()->Allocator()),
+    m_appProfileIndex(ProfileIndexBuckets, pDevice->VkInstance()->Allocator())
+#if VKI_RUNTIME_APP_PROFILE
+    , m_runtimeProfileIndex(RuntimeProfileIndexBuckets, pDevice->VkInstance()->Allocator())
+    , m_pRuntimeProfileMapping(nullptr)
+    , m_runtimeProfileMappingSize(0)
+#endif
 {
 }
 
@@ -71,6 +347,14 @@ void ShaderOptimizer::Init()
 #if VKI_RUNTIME_APP_PROFILE
     BuildRuntimeProfile();
 #endif
+
+    const VkAllocationCallbacks* pAllocCB = m_pDevice->VkInstance()->GetAllocCallbacks();
+
+    m_appProfileIndex.Build(m_appProfile, pAllocCB);
+    m_tuningProfileIndex.Build(m_tuningProfile, pAllocCB);
+#if VKI_RUNTIME_APP_PROFILE
+    m_runtimeProfileIndex.Build(m_runtimeProfile, pAllocCB);
+#endif
 }
 
 // =====================================================================================================================
@@ -105,13 +389,19 @@ void ShaderOptimizer::CreateShaderOptimizerKey(
 // =====================================================================================================================
 bool ShaderOptimizer::HasMatchingProfileEntry(
     const PipelineProfile&      profile,
+    const PipelineProfileIndex& index,
     const PipelineOptimizerKey& pipelineKey
     ) const
 {
     bool foundMatch = false;
 
-    for (uint32_t entryIdx = 0; entryIdx < profile.entryCount; ++entryIdx)
+    const PipelineProfileCandidates candidates(
+        profile, index, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < candidates.Count(); ++candidate)
     {
+        const uint32_t entryIdx = candidates.Entry(candidate);
+
         const auto& pattern = profile.pEntries[entryIdx].pattern;
 
         if ((GetFirstMatchingShader(pattern, InvalidShaderIndex, pipelineKey) != InvalidShaderIndex))
@@ -129,17 +419,17 @@ bool ShaderOptimizer::HasMatchingProfileEntry(
     const PipelineOptimizerKey& pipelineKey
     ) const
 {
-    bool foundMatch = HasMatchingProfileEntry(m_appProfile, pipelineKey);
+    bool foundMatch = HasMatchingProfileEntry(m_appProfile, m_appProfileIndex, pipelineKey);
 
     if (foundMatch == false)
     {
-        foundMatch = HasMatchingProfileEntry(m_tuningProfile, pipelineKey);
+        foundMatch = HasMatchingProfileEntry(m_tuningProfile, m_tuningProfileIndex, pipelineKey);
     }
 
 #if VKI_RUNTIME_APP_PROFILE
     if (foundMatch == false)
     {
-        foundMatch = HasMatchingProfileEntry(m_runtimeProfile, pipelineKey);
+        foundMatch = HasMatchingProfileEntry(m_runtimeProfile, m_runtimeProfileIndex, pipelineKey);
     }
 #endif
 
@@ -149,12 +439,18 @@ bool ShaderOptimizer::HasMatchingProfileEntry(
 // =====================================================================================================================
 void ShaderOptimizer::CalculateMatchingProfileEntriesHash(
     const PipelineProfile&      profile,
+    const PipelineProfileIndex& index,
     const PipelineOptimizerKey& pipelineKey,
     Util::MetroHash128*         pHasher
     ) const
 {
-    for (uint32_t entryIdx = 0; entryIdx < profile.entryCount; ++entryIdx)
+    const PipelineProfileCandidates candidates(
+        profile, index, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < candidates.Count(); ++candidate)
     {
+        const uint32_t entryIdx = candidates.Entry(candidate);
+
         const auto& pattern = profile.pEntries[entryIdx].pattern;
 
         for (uint32_t shaderIdx = 0; shaderIdx < pipelineKey.shaderCount; ++shaderIdx)
@@ -190,23 +486,29 @@ void ShaderOptimizer::CalculateMatchingProfileEntriesHash(
     Util::MetroHash128*         pHasher
     ) const
 {
-    CalculateMatchingProfileEntriesHash(m_appProfile, pipelineKey, pHasher);
-    CalculateMatchingProfileEntriesHash(m_tuningProfile, pipelineKey, pHasher);
+    CalculateMatchingProfileEntriesHash(m_appProfile, m_appProfileIndex, pipelineKey, pHasher);
+    CalculateMatchingProfileEntriesHash(m_tuningProfile, m_tuningProfileIndex, pipelineKey, pHasher);
 #if VKI_RUNTIME_APP_PROFILE
-    CalculateMatchingProfileEntriesHash(m_runtimeProfile, pipelineKey, pHasher);
+    CalculateMatchingProfileEntriesHash(m_runtimeProfile, m_runtimeProfileIndex, pipelineKey, pHasher);
 #endif
 }
 
 // =====================================================================================================================
 void ShaderOptimizer::ApplyProfileToShaderCreateInfo(
     const PipelineProfile&           profile,
+    const PipelineProfileIndex&      index,
     const PipelineOptimizerKey&      pipelineKey,
     uint32_t                         shaderIndex,
     PipelineShaderOptionsPtr         options
     ) const
 {
-    for (uint32_t entry = 0; entry < profile.entryCount; ++entry)
+    const PipelineProfileCandidates candidates(
+        profile, index, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < candidates.Count(); ++candidate)
     {
+        const uint32_t entry = candidates.Entry(candidate);
+
         const PipelineProfileEntry& profileEntry = profile.pEntries[entry];
 
         if (GetFirstMatchingShader(profileEntry.pattern, shaderIndex, pipelineKey) != InvalidShaderIndex)
@@ -444,12 +746,12 @@ void ShaderOptimizer::OverrideShaderCreateInfo(
     ) const
 {
 
-    ApplyProfileToShaderCreateInfo(m_appProfile, pipelineKey, shaderIndex, options);
+    ApplyProfileToShaderCreateInfo(m_appProfile, m_appProfileIndex, pipelineKey, shaderIndex, options);
 
-    ApplyProfileToShaderCreateInfo(m_tuningProfile, pipelineKey, shaderIndex, options);
+    ApplyProfileToShaderCreateInfo(m_tuningProfile, m_tuningProfileIndex, pipelineKey, shaderIndex, options);
 
 #if VKI_RUNTIME_APP_PROFILE
-    ApplyProfileToShaderCreateInfo(m_runtimeProfile, pipelineKey, shaderIndex, options);
+    ApplyProfileToShaderCreateInfo(m_runtimeProfile, m_runtimeProfileIndex, pipelineKey, shaderIndex, options);
 #endif
 }
 
@@ -461,9 +763,12 @@ Vkgc::ThreadGroupSwizzleMode ShaderOptimizer::OverrideThreadGroupSwizzleMode(
 {
     Vkgc::ThreadGroupSwizzleMode swizzleMode = Vkgc::ThreadGroupSwizzleMode::Default;
 
-    for (uint32_t entry = 0; entry < m_appProfile.entryCount; ++entry)
+    const PipelineProfileCandidates appCandidates(
+        m_appProfile, m_appProfileIndex, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < appCandidates.Count(); ++candidate)
     {
-        const PipelineProfileEntry& profileEntry = m_appProfile.pEntries[entry];
+        const PipelineProfileEntry& profileEntry = m_appProfile.pEntries[appCandidates.Entry(candidate)];
 
         if (GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey) != InvalidShaderIndex)
         {
@@ -476,9 +781,12 @@ Vkgc::ThreadGroupSwizzleMode ShaderOptimizer::OverrideThreadGroupSwizzleMode(
         }
     }
 
-    for (uint32_t entry = 0; entry < m_tuningProfile.entryCount; ++entry)
+    const PipelineProfileCandidates tuningCandidates(
+        m_tuningProfile, m_tuningProfileIndex, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < tuningCandidates.Count(); ++candidate)
     {
-        const PipelineProfileEntry& profileEntry = m_tuningProfile.pEntries[entry];
+        const PipelineProfileEntry& profileEntry = m_tuningProfile.pEntries[tuningCandidates.Entry(candidate)];
 
         if (GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey) != InvalidShaderIndex)
         {
@@ -502,9 +810,12 @@ bool ShaderOptimizer::OverrideThreadIdSwizzleMode(
 {
     bool swizzleMode = false;
 
-    for (uint32_t entry = 0; entry < m_appProfile.entryCount; ++entry)
+    const PipelineProfileCandidates appCandidates(
+        m_appProfile, m_appProfileIndex, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < appCandidates.Count(); ++candidate)
     {
-        const PipelineProfileEntry& profileEntry = m_appProfile.pEntries[entry];
+        const PipelineProfileEntry& profileEntry = m_appProfile.pEntries[appCandidates.Entry(candidate)];
 
         if (GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey) != InvalidShaderIndex)
         {
@@ -514,9 +825,12 @@ bool ShaderOptimizer::OverrideThreadIdSwizzleMode(
         }
     }
 
-    for (uint32_t entry = 0; entry < m_tuningProfile.entryCount; ++entry)
+    const PipelineProfileCandidates tuningCandidates(
+        m_tuningProfile, m_tuningProfileIndex, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < tuningCandidates.Count(); ++candidate)
     {
-        const PipelineProfileEntry& profileEntry = m_tuningProfile.pEntries[entry];
+        const PipelineProfileEntry& profileEntry = m_tuningProfile.pEntries[tuningCandidates.Entry(candidate)];
 
         if (GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey) != InvalidShaderIndex)
         {
@@ -541,9 +855,12 @@ void ShaderOptimizer::OverrideShaderThreadGroupSize(
     uint32_t*                   pThreadGroupSizeZ
     ) const
 {
-    for (uint32_t entry = 0; entry < m_appProfile.entryCount; ++entry)
+    const PipelineProfileCandidates appCandidates(
+        m_appProfile, m_appProfileIndex, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < appCandidates.Count(); ++candidate)
     {
-        const PipelineProfileEntry& profileEntry = m_appProfile.pEntries[entry];
+        const PipelineProfileEntry& profileEntry = m_appProfile.pEntries[appCandidates.Entry(candidate)];
 
         if (GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey) != InvalidShaderIndex)
         {
@@ -558,9 +875,12 @@ void ShaderOptimizer::OverrideShaderThreadGroupSize(
         }
     }
 
-    for (uint32_t entry = 0; entry < m_tuningProfile.entryCount; ++entry)
+    const PipelineProfileCandidates tuningCandidates(
+        m_tuningProfile, m_tuningProfileIndex, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < tuningCandidates.Count(); ++candidate)
     {
-        const PipelineProfileEntry& profileEntry = m_tuningProfile.pEntries[entry];
+        const PipelineProfileEntry& profileEntry = m_tuningProfile.pEntries[tuningCandidates.Entry(candidate)];
 
         if (GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey) != InvalidShaderIndex)
         {
@@ -585,9 +905,12 @@ bool ShaderOptimizer::OverrideReverseWorkgroupOrder(
 {
     bool overrideReverseWorkgroupOrderHw = false;
 
-    for (uint32_t entry = 0; entry < m_appProfile.entryCount; ++entry)
+    const PipelineProfileCandidates appCandidates(
+        m_appProfile, m_appProfileIndex, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < appCandidates.Count(); ++candidate)
     {
-        const PipelineProfileEntry& profileEntry = m_appProfile.pEntries[entry];
+        const PipelineProfileEntry& profileEntry = m_appProfile.pEntries[appCandidates.Entry(candidate)];
 
         if (GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey) != InvalidShaderIndex)
         {
@@ -600,9 +923,12 @@ bool ShaderOptimizer::OverrideReverseWorkgroupOrder(
         }
     }
 
-    for (uint32_t entry = 0; entry < m_tuningProfile.entryCount; ++entry)
+    const PipelineProfileCandidates tuningCandidates(
+        m_tuningProfile, m_tuningProfileIndex, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < tuningCandidates.Count(); ++candidate)
     {
-        const PipelineProfileEntry& profileEntry = m_tuningProfile.pEntries[entry];
+        const PipelineProfileEntry& profileEntry = m_tuningProfile.pEntries[tuningCandidates.Entry(candidate)];
 
         if (GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey) != InvalidShaderIndex)
         {
@@ -627,9 +953,12 @@ CsDispatchInterleaveSize ShaderOptimizer::OverrideDispatchInterleaveSize(
 {
     CsDispatchInterleaveSize interleaveSize = CsDispatchInterleaveSizeDefault;
 
-    for (uint32_t entry = 0; entry < m_appProfile.entryCount; ++entry)
+    const PipelineProfileCandidates appCandidates(
+        m_appProfile, m_appProfileIndex, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < appCandidates.Count(); ++candidate)
     {
-        const PipelineProfileEntry& profileEntry = m_appProfile.pEntries[entry];
+        const PipelineProfileEntry& profileEntry = m_appProfile.pEntries[appCandidates.Entry(candidate)];
 
         if (GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey) != InvalidShaderIndex)
         {
@@ -643,9 +972,12 @@ CsDispatchInterleaveSize ShaderOptimizer::OverrideDispatchInterleaveSize(
         }
     }
 
-    for (uint32_t entry = 0; entry < m_tuningProfile.entryCount; ++entry)
+    const PipelineProfileCandidates tuningCandidates(
+        m_tuningProfile, m_tuningProfileIndex, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < tuningCandidates.Count(); ++candidate)
     {
-        const PipelineProfileEntry& profileEntry = m_tuningProfile.pEntries[entry];
+        const PipelineProfileEntry& profileEntry = m_tuningProfile.pEntries[tuningCandidates.Entry(candidate)];
 
         if (GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey) != InvalidShaderIndex)
         {
@@ -671,14 +1003,14 @@ void ShaderOptimizer::OverrideGraphicsPipelineCreateInfo(
     ) const
 {
     ApplyProfileToGraphicsPipelineCreateInfo(
-        m_appProfile, pipelineKey, shaderStages, pPalCreateInfo, pGraphicsShaderInfos);
+        m_appProfile, m_appProfileIndex, pipelineKey, shaderStages, pPalCreateInfo, pGraphicsShaderInfos);
 
     ApplyProfileToGraphicsPipelineCreateInfo(
-        m_tuningProfile, pipelineKey, shaderStages, pPalCreateInfo, pGraphicsShaderInfos);
+        m_tuningProfile, m_tuningProfileIndex, pipelineKey, shaderStages, pPalCreateInfo, pGraphicsShaderInfos);
 
 #if VKI_RUNTIME_APP_PROFILE
     ApplyProfileToGraphicsPipelineCreateInfo(
-        m_runtimeProfile, pipelineKey, shaderStages, pPalCreateInfo, pGraphicsShaderInfos);
+        m_runtimeProfile, m_runtimeProfileIndex, pipelineKey, shaderStages, pPalCreateInfo, pGraphicsShaderInfos);
 #endif
 }
 
@@ -688,12 +1020,15 @@ void ShaderOptimizer::OverrideComputePipelineCreateInfo(
     Pal::DynamicComputeShaderInfo*   pDynamicCompueShaderInfo
     ) const
 {
-    ApplyProfileToComputePipelineCreateInfo(m_appProfile, pipelineKey, pDynamicCompueShaderInfo);
+    ApplyProfileToComputePipelineCreateInfo(
+        m_appProfile, m_appProfileIndex, pipelineKey, pDynamicCompueShaderInfo);
 
-    ApplyProfileToComputePipelineCreateInfo(m_tuningProfile, pipelineKey, pDynamicCompueShaderInfo);
+    ApplyProfileToComputePipelineCreateInfo(
+        m_tuningProfile, m_tuningProfileIndex, pipelineKey, pDynamicCompueShaderInfo);
 
 #if VKI_RUNTIME_APP_PROFILE
-    ApplyProfileToComputePipelineCreateInfo(m_runtimeProfile, pipelineKey, pDynamicCompueShaderInfo);
+    ApplyProfileToComputePipelineCreateInfo(
+        m_runtimeProfile, m_runtimeProfileIndex, pipelineKey, pDynamicCompueShaderInfo);
 #endif
 }
 
@@ -702,6 +1037,12 @@ ShaderOptimizer::~ShaderOptimizer()
 {
     const VkAllocationCallbacks* pAllocCB = m_pDevice->VkInstance()->GetAllocCallbacks();
 
+    m_appProfileIndex.Destroy(pAllocCB);
+    m_tuningProfileIndex.Destroy(pAllocCB);
+#if VKI_RUNTIME_APP_PROFILE
+    m_runtimeProfileIndex.Destroy(pAllocCB);
+#endif
+
     if (m_appProfile.pEntries != nullptr)
     {
         pAllocCB->pfnFree(pAllocCB->pUserData, m_appProfile.pEntries);
@@ -711,7 +1052,13 @@ ShaderOptimizer::~ShaderOptimizer()
         pAllocCB->pfnFree(pAllocCB->pUserData, m_tuningProfile.pEntries);
     }
 #if VKI_RUNTIME_APP_PROFILE
-    if (m_runtimeProfile.pEntries != nullptr)
+    if (m_pRuntimeProfileMapping != nullptr)
+    {
+#if defined(__unix__)
+        munmap(m_pRuntimeProfileMapping, m_runtimeProfileMappingSize);
+#endif
+    }
+    else if (m_runtimeProfile.pEntries != nullptr)
     {
         pAllocCB->pfnFree(pAllocCB->pUserData, m_runtimeProfile.pEntries);
     }
@@ -756,6 +1103,7 @@ bool ShaderOptimizer::ApplyProfileToDynamicGraphicsShaderInfo(
 // =====================================================================================================================
 void ShaderOptimizer::ApplyProfileToGraphicsPipelineCreateInfo(
     const PipelineProfile&            profile,
+    const PipelineProfileIndex&       index,
     const PipelineOptimizerKey&       pipelineKey,
     VkShaderStageFlagBits             shaderStages,
     Pal::GraphicsPipelineCreateInfo*  pPalCreateInfo,
@@ -764,8 +1112,13 @@ void ShaderOptimizer::ApplyProfileToGraphicsPipelineCreateInfo(
 {
     uint32_t vkgcStages = VkToVkgcShaderStageMask(shaderStages);
 
-    for (uint32_t entry = 0; entry < profile.entryCount; ++entry)
+    const PipelineProfileCandidates candidates(
+        profile, index, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < candidates.Count(); ++candidate)
     {
+        const uint32_t entry = candidates.Entry(candidate);
+
         const auto& profileEntry     = profile.pEntries[entry];
         uint32_t    firstShaderMatch = GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey);
 
@@ -850,12 +1203,18 @@ void ShaderOptimizer::ApplyProfileToGraphicsPipelineCreateInfo(
 // =====================================================================================================================
 void ShaderOptimizer::ApplyProfileToComputePipelineCreateInfo(
     const PipelineProfile&           profile,
+    const PipelineProfileIndex&      index,
     const PipelineOptimizerKey&      pipelineKey,
     Pal::DynamicComputeShaderInfo*   pDynamicComputeShaderInfo
     ) const
 {
-    for (uint32_t entry = 0; entry < profile.entryCount; ++entry)
+    const PipelineProfileCandidates candidates(
+        profile, index, pipelineKey, m_pDevice->VkInstance()->Allocator());
+
+    for (uint32_t candidate = 0; candidate < candidates.Count(); ++candidate)
     {
+        const uint32_t entry = candidates.Entry(candidate);
+
         const auto& profileEntry     = profile.pEntries[entry];
         uint32_t    firstShaderMatch = GetFirstMatchingShader(profileEntry.pattern, InvalidShaderIndex, pipelineKey);
 
@@ -1597,6 +1956,11 @@ void ShaderOptimizer::BuildRuntimeProfile()
     utils::JsonSettings jsonSettings = utils::JsonMakeInstanceSettings(pAllocCB);
     utils::Json* pJson               = nullptr;
 
+    // The tree only lives until the profile has been converted, so parse it into an arena and let the generated key
+    // lookups hash into objects with many keys rather than walk them.
+    jsonSettings.arenaAlloc      = true;
+    jsonSettings.keyIndexMinKeys = RuntimeProfileJsonKeyIndexMinKeys;
+
     if (m_settings.pipelineProfileRuntimeFile[0] != '\0')
     {
         Util::File jsonFile;
@@ -1613,7 +1977,21 @@ void ShaderOptimizer::BuildRuntimeProfile()
 
                 jsonFile.Read(pJsonBuffer, size, &bytesRead);
 
+                char                  binaryPath[Util::PathBufferLen] = {};
+                Util::MetroHash::Hash jsonHash                        = {};
+
                 if (bytesRead > 0)
+                {
+                    Util::Snprintf(binaryPath, sizeof(binaryPath), "%s.bin", m_settings.pipelineProfileRuntimeFile);
+                    Util::MetroHash128::Hash(static_cast<const uint8_t*>(pJsonBuffer), bytesRead, jsonHash.bytes);
+                }
+
+                // Skip parsing if the binary of a previous run was parsed from the same JSON contents
+                const bool loadedBinary = (bytesRead > 0) &&
+                                          m_settings.pipelineProfileRuntimeBinaryCache &&
+                                          LoadRuntimeProfileBinary(binaryPath, jsonHash);
+
+                if ((bytesRead > 0) && (loadedBinary == false))
                 {
                     pJson = utils::JsonParse(jsonSettings, pJsonBuffer, bytesRead);
 
@@ -1629,6 +2007,10 @@ void ShaderOptimizer::BuildRuntimeProfile()
                             // Failed to parse some part of the profile (e.g. unsupported/missing key name)
                             RuntimeProfileParseError();
                         }
+                        else if (m_settings.pipelineProfileRuntimeBinaryCache)
+                        {
+                            StoreRuntimeProfileBinary(binaryPath, jsonHash);
+                        }
 
                         utils::JsonDestroy(jsonSettings, pJson);
                     }
@@ -1646,6 +2028,135 @@ void ShaderOptimizer::BuildRuntimeProfile()
         }
     }
 }
+
+// =====================================================================================================================
+// Maps the binary form of the runtime profile written by StoreRuntimeProfileBinary() and points the runtime profile at
+// its entries.  Returns false if there is no binary, or it was written for different JSON contents or a different
+// driver build, in which case the JSON file needs to be parsed.
+bool ShaderOptimizer::LoadRuntimeProfileBinary(
+    const char*                  pBinaryPath,
+    const Util::MetroHash::Hash& jsonHash)
+{
+    bool loaded = false;
+
+#if defined(__unix__)
+    const int fd = open(pBinaryPath, O_RDONLY | O_CLOEXEC);
+
+    if (fd >= 0)
+    {
+        struct stat fileStat = {};
+        void*       pMapped  = MAP_FAILED;
+        size_t      fileSize = 0;
+
+        if ((fstat(fd, &fileStat) == 0) &&
+            (static_cast<size_t>(fileStat.st_size) >= sizeof(RuntimeProfileBinaryHeader)))
+        {
+            fileSize = static_cast<size_t>(fileStat.st_size);
+            pMapped  = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+
+        // The mapping stays valid after the descriptor is closed.
+        close(fd);
+
+        if (pMapped != MAP_FAILED)
+        {
+            const RuntimeProfileBinaryHeader* pHeader = static_cast<const RuntimeProfileBinaryHeader*>(pMapped);
+
+            if ((pHeader->magic      == RuntimeProfileBinaryMagic)                         &&
+                (pHeader->version    == RuntimeProfileBinaryVersion)                       &&
+                (pHeader->buildHash  == utils::GetBuildTimeHash())                         &&
+                (pHeader->entrySize  == sizeof(PipelineProfileEntry))                      &&
+                (memcmp(&pHeader->jsonHash, &jsonHash, sizeof(jsonHash)) == 0)             &&
+                (pHeader->fileSize   == fileSize)                                          &&
+                (pHeader->entryCount <= UINT32_MAX)                                        &&
+                ((sizeof(RuntimeProfileBinaryHeader) + (pHeader->entryCount * sizeof(PipelineProfileEntry))) ==
+                 fileSize))
+            {
+                const VkAllocationCallbacks* pAllocCB = m_pDevice->VkInstance()->GetAllocCallbacks();
+
+                if (m_runtimeProfile.pEntries != nullptr)
+                {
+                    pAllocCB->pfnFree(pAllocCB->pUserData, m_runtimeProfile.pEntries);
+                }
+
+                m_pRuntimeProfileMapping    = pMapped;
+                m_runtimeProfileMappingSize = fileSize;
+
+                m_runtimeProfile.entryCount    = static_cast<uint32_t>(pHeader->entryCount);
+                m_runtimeProfile.entryCapacity = m_runtimeProfile.entryCount;
+                m_runtimeProfile.pEntries      =
+                    static_cast<PipelineProfileEntry*>(Util::VoidPtrInc(pMapped, sizeof(RuntimeProfileBinaryHeader)));
+
+                loaded = true;
+            }
+            else
+            {
+                munmap(pMapped, fileSize);
+            }
+        }
+    }
+#endif
+
+    return loaded;
+}
+
+// =====================================================================================================================
+// Writes the freshly parsed runtime profile in binary form so that later runs can skip parsing the JSON file.  The file
+// is written under a temporary name and renamed into place, so concurrent runs never map a partially written file.
+void ShaderOptimizer::StoreRuntimeProfileBinary(
+    const char*                  pBinaryPath,
+    const Util::MetroHash::Hash& jsonHash
+    ) const
+{
+#if defined(__unix__)
+    bool storable = true;
+
+    // Entries referencing out-of-line data (e.g. replacement shader code) can not be stored by value
+    for (uint32_t entry = 0; storable && (entry < m_runtimeProfile.entryCount); ++entry)
+    {
+        for (uint32_t stage = 0; stage < ShaderStageCount; ++stage)
+        {
+            storable &= (m_runtimeProfile.pEntries[entry].action.shaders[stage].shaderReplace.pCode == nullptr);
+        }
+    }
+
+    if (storable)
+    {
+        RuntimeProfileBinaryHeader header = {};
+        header.magic      = RuntimeProfileBinaryMagic;
+        header.version    = RuntimeProfileBinaryVersion;
+        header.buildHash  = utils::GetBuildTimeHash();
+        header.entrySize  = sizeof(PipelineProfileEntry);
+        header.jsonHash   = jsonHash;
+        header.entryCount = m_runtimeProfile.entryCount;
+        header.fileSize   = sizeof(header) + (header.entryCount * sizeof(PipelineProfileEntry));
+
+        char tempPath[Util::PathBufferLen] = {};
+        Util::Snprintf(tempPath, sizeof(tempPath), "%s.%d.tmp", pBinaryPath, static_cast<int>(getpid()));
+
+        Util::File   file;
+        Pal::Result  result = file.Open(tempPath, Util::FileAccessWrite | Util::FileAccessBinary);
+
+        if (result == Pal::Result::Success)
+        {
+            result = file.Write(&header, sizeof(header));
+
+            if ((result == Pal::Result::Success) && (m_runtimeProfile.entryCount > 0))
+            {
+                result = file.Write(m_runtimeProfile.pEntries,
+                                    m_runtimeProfile.entryCount * sizeof(PipelineProfileEntry));
+            }
+
+            file.Close();
+
+            if ((result != Pal::Result::Success) || (std::rename(tempPath, pBinaryPath) != 0))
+            {
+                std::remove(tempPath);
+            }
+        }
+    }
+#endif
+}
 #endif
 
 };
@@ -0,0 +1,311 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  archive_write_behind_queue.cpp
+* @brief Implementation of the queue writing pipeline binaries to the archive file layers in the background.
+***********************************************************************************************************************
+*/
+
+#include "include/archive_write_behind_queue.h"
+#include "include/pipeline_binary_cache.h"
+
+#include <string.h>
+
+namespace vk
+{
+
+// =====================================================================================================================
+// Creates the queue and starts its flush thread. Returns nullptr on failure, in which case the caller should keep
+// writing to the target layer directly.
+ArchiveWriteBehindQueue* ArchiveWriteBehindQueue::Create(
+    PipelineBinaryCache* pPipelineBinaryCache,
+    Util::ICacheLayer*   pTargetLayer,
+    uint64_t             budget)
+{
+    VK_ASSERT(pPipelineBinaryCache != nullptr);
+    VK_ASSERT(pTargetLayer != nullptr);
+
+    ArchiveWriteBehindQueue* pObj = nullptr;
+    void*                    pMem = pPipelineBinaryCache->AllocMem(sizeof(ArchiveWriteBehindQueue));
+
+    if (pMem != nullptr)
+    {
+        pObj = VK_PLACEMENT_NEW(pMem) ArchiveWriteBehindQueue(pPipelineBinaryCache, pTargetLayer, budget);
+
+        Util::EventCreateFlags flags = {};
+        flags.manualReset       = true;
+        flags.initiallySignaled = false;
+
+        Util::Result result = pObj->m_event.Init(flags);
+
+        if (result == Util::Result::Success)
+        {
+            result = Util::Thread::Begin(ThreadFunc, pObj);
+        }
+
+        if (result != Util::Result::Success)
+        {
+            Util::Destructor(pObj);
+            pPipelineBinaryCache->FreeMem(pMem);
+            pObj = nullptr;
+        }
+    }
+
+    return pObj;
+}
+
+// =====================================================================================================================
+// Flushes all queued writes, stops the flush thread and frees the queue.
+void ArchiveWriteBehindQueue::Destroy()
+{
+    m_stop = true;
+    m_event.Set();
+
+    Join();
+
+    PipelineBinaryCache* pCache = m_pPipelineBinaryCache;
+    void*                pMem   = this;
+    Util::Destructor(this);
+    pCache->FreeMem(pMem);
+}
+
+// =====================================================================================================================
+ArchiveWriteBehindQueue::ArchiveWriteBehindQueue(
+    PipelineBinaryCache* pPipelineBinaryCache,
+    Util::ICacheLayer*   pTargetLayer,
+    uint64_t             budget)
+    :
+    m_pPipelineBinaryCache { pPipelineBinaryCache },
+    m_pTargetLayer         { pTargetLayer },
+    m_budget               { budget },
+    m_queue                { pPipelineBinaryCache->GetPalAllocator() },
+    m_stop                 { false },
+    m_pendingBytes         { 0 },
+    m_queuedEntries        { 0 },
+    m_queuedBytes          { 0 },
+    m_flushedEntries       { 0 },
+    m_flushedBytes         { 0 },
+    m_synchronousWrites    { 0 }
+{
+}
+
+// =====================================================================================================================
+ArchiveWriteBehindQueue::~ArchiveWriteBehindQueue()
+{
+    VK_ASSERT(m_queue.NumElements() == 0);
+}
+
+// =====================================================================================================================
+// Queues a binary to be written to the target layer. The data is copied, so the caller's buffer may be released as soon
+// as this returns. Falls back to writing on the calling thread if the binary does not fit into the budget.
+Util::Result ArchiveWriteBehindQueue::Store(
+    const Util::MetroHash::Hash* pCacheId,
+    const void*                  pData,
+    size_t                       dataSize)
+{
+    VK_ASSERT(pCacheId != nullptr);
+    VK_ASSERT(pData != nullptr);
+
+    Util::Result result = Util::Result::ErrorOutOfMemory;
+
+    PendingWrite write = {};
+    write.cacheId  = *pCacheId;
+    write.dataSize = dataSize;
+
+    {
+        Util::MutexAuto lock(&m_lock);
+
+        // Reserve the bytes up front so that concurrent stores can't overshoot the budget while copying.
+        if ((m_pendingBytes + dataSize) <= m_budget)
+        {
+            m_pendingBytes += dataSize;
+            result          = Util::Result::Success;
+        }
+    }
+
+    if (result == Util::Result::Success)
+    {
+        write.pData = m_pPipelineBinaryCache->AllocMem(dataSize);
+
+        if (write.pData != nullptr)
+        {
+            memcpy(write.pData, pData, dataSize);
+
+            Util::MutexAuto lock(&m_lock);
+
+            result = m_queue.PushBack(write);
+
+            if (result == Util::Result::Success)
+            {
+                m_queuedEntries++;
+                m_queuedBytes += dataSize;
+            }
+        }
+        else
+        {
+            result = Util::Result::ErrorOutOfMemory;
+        }
+
+        if (result == Util::Result::Success)
+        {
+            m_event.Set();
+        }
+        else
+        {
+            Util::MutexAuto lock(&m_lock);
+            m_pendingBytes -= dataSize;
+        }
+    }
+
+    if (result != Util::Result::Success)
+    {
+        if (write.pData != nullptr)
+        {
+            m_pPipelineBinaryCache->FreeMem(write.pData);
+        }
+
+        result = Write(pCacheId, pData, dataSize);
+
+        Util::MutexAuto lock(&m_lock);
+        m_synchronousWrites++;
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Writes a binary to the target layer, passing it on to the archive files.
+Util::Result ArchiveWriteBehindQueue::Write(
+    const Util::MetroHash::Hash* pCacheId,
+    const void*                  pData,
+    size_t                       dataSize) const
+{
+    Util::StoreFlags storeFlags  = {};
+    storeFlags.enableFileCache   = true;
+    storeFlags.enableCompression = true;
+
+    Util::Result result = m_pTargetLayer->Store(storeFlags, pCacheId, pData, dataSize);
+
+    return (result == Util::Result::AlreadyExists) ? Util::Result::Success : result;
+}
+
+// =====================================================================================================================
+// Body of the flush thread. Every wake-up takes the whole queue in one batch, so stores issued in a burst are written
+// back to back and the queue lock and counters are only touched once per batch instead of once per entry. The queue is
+// drained one final time once the thread is asked to stop.
+void ArchiveWriteBehindQueue::FlushThreadFunc()
+{
+    WriteBatch batch(m_pPipelineBinaryCache->GetPalAllocator());
+    bool       done = false;
+
+    while (done == false)
+    {
+        {
+            Util::MutexAuto lock(&m_lock);
+
+            PendingWrite write = {};
+            while ((m_queue.NumElements() > 0) && (m_queue.PopFront(&write) == Util::Result::Success))
+            {
+                if (batch.PushBack(write) != Util::Result::Success)
+                {
+                    // Out of memory for a bigger batch, the rest is picked up by the next one.
+                    m_queue.PushFront(write);
+                    break;
+                }
+            }
+        }
+
+        if (batch.NumElements() > 0)
+        {
+            FlushBatch(&batch);
+        }
+        else if (m_stop)
+        {
+            done = true;
+        }
+        else
+        {
+            // The queue is checked again after the reset, so a write queued in between is not missed.
+            m_event.Wait(Util::fseconds{ 1.0f });
+            m_event.Reset();
+        }
+    }
+}
+
+// =====================================================================================================================
+// Writes a batch of queued binaries to the target layer, frees their copies and empties the batch. The archive layer
+// only accepts one binary per store, so the binaries are stored back to back and the bookkeeping is done once.
+void ArchiveWriteBehindQueue::FlushBatch(
+    WriteBatch* pBatch)
+{
+    uint64_t writtenBytes   = 0;
+    uint64_t flushedEntries = 0;
+    uint64_t flushedBytes   = 0;
+
+    for (uint32_t i = 0; i < pBatch->NumElements(); i++)
+    {
+        const PendingWrite& write = pBatch->At(i);
+
+        const Util::Result result = Write(&write.cacheId, write.pData, write.dataSize);
+        VK_ALERT(result != Util::Result::Success);
+
+        if (result == Util::Result::Success)
+        {
+            flushedEntries++;
+            flushedBytes += write.dataSize;
+        }
+
+        writtenBytes += write.dataSize;
+
+        m_pPipelineBinaryCache->FreeMem(write.pData);
+    }
+
+    pBatch->Clear();
+
+    Util::MutexAuto lock(&m_lock);
+
+    m_pendingBytes   -= writtenBytes;
+    m_flushedEntries += flushedEntries;
+    m_flushedBytes   += flushedBytes;
+}
+
+// =====================================================================================================================
+void ArchiveWriteBehindQueue::GetStats(
+    PipelineBinaryCacheWriteBehindStats* pStats) const
+{
+    VK_ASSERT(pStats != nullptr);
+
+    Util::MutexAuto lock(&m_lock);
+
+    pStats->queuedEntries     = m_queuedEntries;
+    pStats->queuedBytes       = m_queuedBytes;
+    pStats->flushedEntries    = m_flushedEntries;
+    pStats->flushedBytes      = m_flushedBytes;
+    pStats->pendingBytes      = m_pendingBytes;
+    pStats->synchronousWrites = m_synchronousWrites;
+}
+
+} // namespace vk
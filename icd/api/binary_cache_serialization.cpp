@@ -57,9 +57,12 @@
 #include "include/binary_cache_serialization.h"
 
 #include "palAssert.h"
+#include "palFile.h"
 #include "palInlineFuncs.h"
 #include "palPlatformKey.h"
+#include "palSysUtil.h"
 
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
@@ -112,6 +115,212 @@ Util::Result WriteVkPipelineCacheHeaderData(
     return result;
 }
 
+// =====================================================================================================================
+// Checks whether the given cache data (following the private header) starts with a delta chunk header. Returns true and
+// fills in pDeltaHeader if it does.
+bool ReadPipelineBinaryCacheDeltaHeader(
+    const void*                     pCacheData,
+    size_t                          dataSize,
+    PipelineBinaryCacheDeltaHeader* pDeltaHeader)
+{
+    PAL_ASSERT(pCacheData != nullptr);
+    PAL_ASSERT(pDeltaHeader != nullptr);
+
+    bool isDelta = false;
+
+    if (dataSize >= sizeof(PipelineBinaryCacheDeltaHeader))
+    {
+        // The header is not guaranteed to be 8 byte aligned within the blob, so read it through memcpy.
+        memcpy(pDeltaHeader, pCacheData, sizeof(PipelineBinaryCacheDeltaHeader));
+
+        isDelta = (pDeltaHeader->magic == PipelineBinaryCacheDeltaMagic) &&
+                  (pDeltaHeader->baseGeneration <= pDeltaHeader->generation);
+    }
+
+    return isDelta;
+}
+
+// =====================================================================================================================
+// Converts a pipeline binary cache blob (as produced by PipelineBinaryCacheSerializer, starting at the private header)
+// into a memory-mappable archive with an on-disk hash index, and writes it to the given file. The blob is expected to
+// have been validated by the caller. Duplicate entries are only written once.
+Util::Result WriteMappedPipelineArchive(
+    VkAllocationCallbacks*    pAllocationCallbacks,
+    const Util::IPlatformKey* pPlatformKey,
+    const void*               pCacheBlob,
+    size_t                    cacheBlobSize,
+    const char*               pFilePath)
+{
+    PAL_ASSERT(pAllocationCallbacks != nullptr);
+    PAL_ASSERT(pPlatformKey != nullptr);
+    PAL_ASSERT(pCacheBlob != nullptr);
+    PAL_ASSERT(pFilePath != nullptr);
+
+    constexpr size_t EntrySize = sizeof(BinaryCacheEntry);
+
+    Util::Result result = Util::Result::ErrorInvalidValue;
+
+    const void* pEntries    = nullptr;
+    size_t      entriesSize = 0;
+
+    if (cacheBlobSize > sizeof(PipelineBinaryCachePrivateHeader))
+    {
+        pEntries    = Util::VoidPtrInc(pCacheBlob, sizeof(PipelineBinaryCachePrivateHeader));
+        entriesSize = cacheBlobSize - sizeof(PipelineBinaryCachePrivateHeader);
+
+        PipelineBinaryCacheDeltaHeader deltaHeader;
+        if (ReadPipelineBinaryCacheDeltaHeader(pEntries, entriesSize, &deltaHeader))
+        {
+            pEntries     = Util::VoidPtrInc(pEntries, sizeof(PipelineBinaryCacheDeltaHeader));
+            entriesSize -= sizeof(PipelineBinaryCacheDeltaHeader);
+        }
+
+        result = Util::Result::Success;
+    }
+
+    // First pass: count the entries to size the index.
+    uint64_t blobEntryCount = 0;
+    size_t   blobEntriesEnd = 0;
+
+    while ((result == Util::Result::Success) && ((entriesSize - blobEntriesEnd) > EntrySize))
+    {
+        BinaryCacheEntry entry;
+        memcpy(&entry, Util::VoidPtrInc(pEntries, blobEntriesEnd), EntrySize);
+
+        if ((entriesSize - blobEntriesEnd - EntrySize) < entry.dataSize)
+        {
+            break;
+        }
+
+        blobEntriesEnd += EntrySize + entry.dataSize;
+        ++blobEntryCount;
+    }
+
+    // Keep the load factor at or below one half so that probe sequences stay short.
+    const uint32_t indexSize    = Util::Pow2Pad(static_cast<uint32_t>(Util::Max(blobEntryCount * 2, uint64_t(2))));
+    const size_t   indexMemSize = sizeof(MappedPipelineArchiveIndexEntry) * indexSize;
+
+    MappedPipelineArchiveIndexEntry* pIndex = nullptr;
+
+    if (result == Util::Result::Success)
+    {
+        pIndex = static_cast<MappedPipelineArchiveIndexEntry*>(
+            pAllocationCallbacks->pfnAllocation(pAllocationCallbacks->pUserData,
+                                                indexMemSize,
+                                                16,
+                                                VK_SYSTEM_ALLOCATION_SCOPE_COMMAND));
+        if (pIndex != nullptr)
+        {
+            memset(pIndex, 0, indexMemSize);
+        }
+        else
+        {
+            result = Util::Result::ErrorOutOfMemory;
+        }
+    }
+
+    MappedPipelineArchiveHeader header = {};
+    header.magic       = MappedPipelineArchiveMagic;
+    header.version     = MappedPipelineArchiveVersion;
+    header.indexSize   = indexSize;
+    header.platformKey = pPlatformKey->GetKey64();
+    header.fileSize    = sizeof(header) + indexMemSize;
+
+    // Second pass: fill in the index, assigning data offsets in blob order. Only the first copy of a duplicate entry
+    // gets a slot.
+    for (size_t offset = 0; (result == Util::Result::Success) && (offset < blobEntriesEnd); )
+    {
+        BinaryCacheEntry entry;
+        memcpy(&entry, Util::VoidPtrInc(pEntries, offset), EntrySize);
+
+        uint32_t slot = GetMappedPipelineArchiveSlot(entry.hashId, indexSize);
+
+        while ((pIndex[slot].dataOffset != 0) &&
+               (memcmp(&pIndex[slot].hashId, &entry.hashId, sizeof(entry.hashId)) != 0))
+        {
+            slot = (slot + 1) & (indexSize - 1);
+        }
+
+        if (pIndex[slot].dataOffset == 0)
+        {
+            pIndex[slot].hashId     = entry.hashId;
+            pIndex[slot].dataOffset = header.fileSize;
+            pIndex[slot].dataSize   = entry.dataSize;
+            pIndex[slot].checksum   = entry.checksum;
+
+            header.fileSize += entry.dataSize;
+            ++header.entryCount;
+        }
+
+        offset += EntrySize + entry.dataSize;
+    }
+
+    // The archive is written next to its destination and renamed into place, so that processes which currently map a
+    // previous version of the file never see it truncated or partially written.
+    char tempPath[Util::PathBufferLen] = {};
+    Util::Snprintf(tempPath, sizeof(tempPath), "%s.%u.tmp", pFilePath, Util::GetIdOfCurrentProcess());
+
+    Util::File file;
+
+    if (result == Util::Result::Success)
+    {
+        result = file.Open(tempPath, Util::FileAccessWrite | Util::FileAccessBinary);
+    }
+
+    if (result == Util::Result::Success)
+    {
+        result = file.Write(&header, sizeof(header));
+    }
+
+    if (result == Util::Result::Success)
+    {
+        result = file.Write(pIndex, indexMemSize);
+    }
+
+    // Third pass: write out the binaries of the entries that own their index slot, which reproduces the offsets
+    // assigned above.
+    uint64_t writeOffset = sizeof(header) + indexMemSize;
+
+    for (size_t offset = 0; (result == Util::Result::Success) && (offset < blobEntriesEnd); )
+    {
+        BinaryCacheEntry entry;
+        memcpy(&entry, Util::VoidPtrInc(pEntries, offset), EntrySize);
+
+        uint32_t slot = GetMappedPipelineArchiveSlot(entry.hashId, indexSize);
+
+        while (memcmp(&pIndex[slot].hashId, &entry.hashId, sizeof(entry.hashId)) != 0)
+        {
+            slot = (slot + 1) & (indexSize - 1);
+        }
+
+        if (pIndex[slot].dataOffset == writeOffset)
+        {
+            result       = file.Write(Util::VoidPtrInc(pEntries, offset + EntrySize), entry.dataSize);
+            writeOffset += entry.dataSize;
+        }
+
+        offset += EntrySize + entry.dataSize;
+    }
+
+    if (file.IsOpen())
+    {
+        file.Close();
+
+        if ((result != Util::Result::Success) || (std::rename(tempPath, pFilePath) != 0))
+        {
+            std::remove(tempPath);
+            result = (result == Util::Result::Success) ? Util::Result::ErrorUnknown : result;
+        }
+    }
+
+    if (pIndex != nullptr)
+    {
+        pAllocationCallbacks->pfnFree(pAllocationCallbacks->pUserData, pIndex);
+    }
+
+    return result;
+}
+
 // =====================================================================================================================
 Util::Result CalculatePipelineBinaryCacheHashId(
     VkAllocationCallbacks*    pAllocationCallbacks,
@@ -152,47 +361,107 @@ Util::Result CalculatePipelineBinaryCacheHashId(
     return result;
 }
 
+// =====================================================================================================================
+PipelineBinaryCacheSerializer::~PipelineBinaryCacheSerializer()
+{
+    DestroyHashContext();
+}
+
+// =====================================================================================================================
+void PipelineBinaryCacheSerializer::DestroyHashContext()
+{
+    if (m_pHashContext != nullptr)
+    {
+        m_pHashContext->Destroy();
+        m_pHashContext = nullptr;
+    }
+    if (m_pHashContextMem != nullptr)
+    {
+        m_pAllocationCallbacks->pfnFree(m_pAllocationCallbacks->pUserData, m_pHashContextMem);
+        m_pHashContextMem = nullptr;
+    }
+}
+
 // =====================================================================================================================
 // Returns Util::Result::Success on success or Util::Result::ErrorInvalidMemorySize if the provided buffer is too small
-// to create a valid pipeline binary cache blob.
+// to create a valid pipeline binary cache blob. If pDeltaHeader is provided, the blob is written as a delta chunk.
 Util::Result PipelineBinaryCacheSerializer::Initialize(
-    size_t bufferCapacity,
-    void*  pOutputBuffer)
+    VkAllocationCallbacks*                pAllocationCallbacks,
+    const Util::IPlatformKey*             pKey,
+    size_t                                bufferCapacity,
+    void*                                 pOutputBuffer,
+    const PipelineBinaryCacheDeltaHeader* pDeltaHeader)
 {
+    PAL_ASSERT(pAllocationCallbacks != nullptr);
+    PAL_ASSERT(pKey != nullptr);
     PAL_ASSERT(pOutputBuffer != nullptr);
+    PAL_ASSERT(m_pHashContext == nullptr);
 
-    Util::Result result = Util::Result::ErrorInvalidMemorySize;
+    Util::Result result       = Util::Result::ErrorInvalidMemorySize;
+    const size_t headersSize  = HeaderSize + ((pDeltaHeader != nullptr) ? DeltaHeaderSize : 0);
 
-    m_pOutputBuffer = pOutputBuffer;
-    if (bufferCapacity >= HeaderSize)
+    m_pOutputBuffer        = pOutputBuffer;
+    m_pAllocationCallbacks = pAllocationCallbacks;
+    if (bufferCapacity >= headersSize)
     {
+        result = Util::Result::ErrorOutOfMemory;
+
+        m_pHashContextMem = pAllocationCallbacks->pfnAllocation(pAllocationCallbacks->pUserData,
+                                                                pKey->GetKeyContext()->GetDuplicateObjectSize(),
+                                                                16,
+                                                                VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+        if (m_pHashContextMem != nullptr)
+        {
+            result = pKey->GetKeyContext()->Duplicate(m_pHashContextMem, &m_pHashContext);
+        }
+    }
+
+    if (result == Util::Result::Success)
+    {
+        if (pDeltaHeader != nullptr)
+        {
+            PAL_ASSERT(pDeltaHeader->magic == PipelineBinaryCacheDeltaMagic);
+            memcpy(Util::VoidPtrInc(m_pOutputBuffer, HeaderSize), pDeltaHeader, DeltaHeaderSize);
+
+            result = m_pHashContext->AddData(pDeltaHeader, DeltaHeaderSize);
+        }
+
         m_bufferCapacity = bufferCapacity;
-        m_bytesUsed = HeaderSize;
-        result = Util::Result::Success;
+        m_bytesUsed = headersSize;
     }
     return result;
 }
 
 // =====================================================================================================================
-// Copies the provided data into the internal buffer.
+// Copies the provided data into the internal buffer and folds it into the blob digest. The checksum of the entry header
+// is filled in from the data.
 Util::Result PipelineBinaryCacheSerializer::AddPipelineBinary(
     const BinaryCacheEntry* pEntry,
     const void*             pData)
 {
     PAL_ASSERT(pEntry != nullptr);
     PAL_ASSERT(pData != nullptr);
+    PAL_ASSERT(m_pHashContext != nullptr);
 
     Util::Result result = Util::Result::ErrorIncompleteResults;
     const size_t bytesToWrite = EntryHeaderSize + pEntry->dataSize;
     if (bytesToWrite <= (m_bufferCapacity - m_bytesUsed))
     {
+        BinaryCacheEntry entry = *pEntry;
+        entry.checksum = CalculateBinaryCacheEntryChecksum(pData, entry.dataSize);
+
         void *pOutputMem = Util::VoidPtrInc(m_pOutputBuffer, m_bytesUsed);
-        memcpy(pOutputMem, pEntry, EntryHeaderSize);
-        pOutputMem = Util::VoidPtrInc(pOutputMem, EntryHeaderSize);
-        memcpy(pOutputMem, pData, pEntry->dataSize);
-        m_bytesUsed += bytesToWrite;
-        ++m_numEntries;
-        result = Util::Result::Success;
+        memcpy(pOutputMem, &entry, EntryHeaderSize);
+        memcpy(Util::VoidPtrInc(pOutputMem, EntryHeaderSize), pData, entry.dataSize);
+
+        // Hash the copy while it is still hot in the cache instead of walking the whole blob again in Finalize.
+        result = m_pHashContext->AddData(pOutputMem, bytesToWrite);
+
+        if (result == Util::Result::Success)
+        {
+            m_bytesUsed += bytesToWrite;
+            ++m_numEntries;
+        }
     }
 
     return result;
@@ -202,17 +471,12 @@ Util::Result PipelineBinaryCacheSerializer::AddPipelineBinary(
 // Writes a pipeline binary cache header based on the added data entries, producing a valid pipeline binary cache blob.
 // No further data entries can be added after calling Finalize.
 Util::Result PipelineBinaryCacheSerializer::Finalize(
-    VkAllocationCallbacks*    pAllocationCallbacks,
-    const Util::IPlatformKey* pKey,
-    size_t*                   pCacheEntriesWritten,
-    size_t*                   pBytesWritten)
+    size_t* pCacheEntriesWritten,
+    size_t* pBytesWritten)
 {
-    PAL_ASSERT(pAllocationCallbacks != nullptr);
-    PAL_ASSERT(pKey != nullptr);
+    PAL_ASSERT(m_pHashContext != nullptr);
 
-    auto pPrivateHeader         = static_cast<PipelineBinaryCachePrivateHeader*>(m_pOutputBuffer);
-    void *pCacheDataBegin       = Util::VoidPtrInc(m_pOutputBuffer, HeaderSize);
-    const size_t cacheDataBytes = m_bytesUsed - HeaderSize;
+    auto pPrivateHeader = static_cast<PipelineBinaryCachePrivateHeader*>(m_pOutputBuffer);
 
     if (pCacheEntriesWritten != nullptr)
     {
@@ -223,11 +487,11 @@ Util::Result PipelineBinaryCacheSerializer::Finalize(
         *pBytesWritten = m_bytesUsed;
     }
 
-    return CalculatePipelineBinaryCacheHashId(pAllocationCallbacks,
-                                              pKey,
-                                              pCacheDataBegin,
-                                              cacheDataBytes,
-                                              pPrivateHeader->hashId);
+    const Util::Result result = m_pHashContext->Finish(pPrivateHeader->hashId);
+
+    DestroyHashContext();
+
+    return result;
 }
 
 }
@@ -282,7 +282,9 @@ VkResult CompilerSolutionLlpc::CreateGraphicsPipelineBinary(
         }
     }
 
-    pCreateInfo->pipelineFeedback = {};
+    // Only the cache flags are reset; the phase durations accumulated so far must be kept.
+    pCreateInfo->pipelineFeedback.feedbackValid       = false;
+    pCreateInfo->pipelineFeedback.hitApplicationCache = false;
     memset(pCreateInfo->stageFeedback, 0, sizeof(pCreateInfo->stageFeedback));
     if (llpcResult != Vkgc::Result::Success)
     {
@@ -708,8 +710,12 @@ VkResult CompilerSolutionLlpc::CreateGraphicsShaderBinary(
         FreeGraphicsPipelineBinary(pipelineOut.pipelineBin);
     }
 
+    const int64_t compileTime = Util::GetPerfCpuTime() - startTime;
+
     m_gplCacheMatrix.totalBinaries++;
-    m_gplCacheMatrix.totalTimeSpent += (Util::GetPerfCpuTime() - startTime);
+    m_gplCacheMatrix.totalTimeSpent += compileTime;
+
+    m_pPhysicalDevice->GetCompiler()->RecordPipelineCompile(PipelineTelemetryType::GraphicsLibrary, compileTime);
 
     PipelineCompiler::DumpCacheMatrix(
         m_pPhysicalDevice, "GraphicsPipelineLibrary_runtime", m_gplCacheMatrix.totalBinaries, &m_gplCacheMatrix);
@@ -760,7 +766,9 @@ VkResult CompilerSolutionLlpc::CreateComputePipelineBinary(
 
     // Build pipline binary
     auto llpcResult = m_pLlpc->BuildComputePipeline(pPipelineBuildInfo, &pipelineOut, pPipelineDumpHandle);
-    pCreateInfo->pipelineFeedback = {};
+    // Only the cache flags are reset; the phase durations accumulated so far must be kept.
+    pCreateInfo->pipelineFeedback.feedbackValid       = false;
+    pCreateInfo->pipelineFeedback.hitApplicationCache = false;
     pCreateInfo->stageFeedback = {};
     if (llpcResult != Vkgc::Result::Success)
     {
@@ -833,7 +833,7 @@ VKAPI_ATTR void VKAPI_CALL vkFreeCommandBuffers(
     {
         if (pCommandBuffers[i] != VK_NULL_HANDLE)
         {
-            ApiCmdBuffer::ObjectFromHandle(pCommandBuffers[i])->Destroy();
+            ApiCmdBuffer::ObjectFromHandle(pCommandBuffers[i])->Free();
         }
     }
 }
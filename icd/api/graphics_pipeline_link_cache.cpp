@@ -0,0 +1,431 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2014-2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  graphics_pipeline_link_cache.cpp
+ * @brief Implementation of the device-level cache of fast-linked graphics pipeline PAL objects.
+ ***********************************************************************************************************************
+ */
+
+#include "include/khronos/vulkan.h"
+
+#include "include/vk_device.h"
+#include "include/vk_instance.h"
+#include "include/graphics_pipeline_link_cache.h"
+
+#include "palHashMapImpl.h"
+#include "palVectorImpl.h"
+
+namespace vk
+{
+
+// =====================================================================================================================
+GraphicsPipelineLinkCache::GraphicsPipelineLinkCache(
+    Device* pDevice)
+    :
+    m_pDevice(pDevice),
+    m_maxEntries(pDevice->GetRuntimeSettings().gplLinkCacheMaxEntries),
+    m_linkMap(NumLinkBuckets, pDevice->VkInstance()->Allocator()),
+    m_refMap(NumLinkBuckets, pDevice->VkInstance()->Allocator())
+{
+
+}
+
+// =====================================================================================================================
+// Initializes the link cache.  Should be called during device create.
+VkResult GraphicsPipelineLinkCache::Init()
+{
+    Pal::Result result = m_linkMap.Init();
+
+    if (result == Pal::Result::Success)
+    {
+        result = m_refMap.Init();
+    }
+
+    return PalToVkResult(result);
+}
+
+// =====================================================================================================================
+// Builds the key identifying a fast-linked pipeline.  The shader libraries are identified both by object (the cache
+// drops entries when their libraries are destroyed) and by library hash.  Only the state fields the driver sets for a
+// fast-linked pipeline are hashed, field by field, so neither structure padding nor pointers such as the pipeline
+// binary (which fast-link does not provide) can make otherwise identical links miss.
+void GraphicsPipelineLinkCache::BuildKey(
+    const Pal::GraphicsPipelineCreateInfo& createInfo,
+    const uint64_t*                        pLibraryHashes,
+    VkPipelineCreateFlags2KHR              flags,
+    Util::MetroHash::Hash*                 pKey)
+{
+    Util::MetroHash128 hasher;
+
+    hasher.Update(static_cast<uint32_t>(createInfo.flags.clientInternal));
+    hasher.Update(static_cast<uint32_t>(createInfo.flags.reverseWorkgroupOrder));
+    hasher.Update(createInfo.groupLaunchGuarantee);
+
+    hasher.Update(createInfo.iaState.topologyInfo.primitiveType);
+    hasher.Update(static_cast<uint32_t>(createInfo.iaState.vertexBufferCount));
+
+    hasher.Update(createInfo.rsState.pointCoordOrigin);
+    hasher.Update(createInfo.rsState.shadeMode);
+    hasher.Update(createInfo.rsState.binningOverride);
+    hasher.Update(createInfo.rsState.depthClampMode);
+    hasher.Update(static_cast<uint32_t>(createInfo.rsState.rasterizeLastLinePixel));
+    hasher.Update(static_cast<uint32_t>(createInfo.rsState.outOfOrderPrimsEnable));
+    hasher.Update(static_cast<uint32_t>(createInfo.rsState.perpLineEndCapsEnable));
+    hasher.Update(static_cast<uint32_t>(createInfo.rsState.dx10DiamondTestDisable));
+
+    hasher.Update(static_cast<uint32_t>(createInfo.cbState.alphaToCoverageEnable));
+    hasher.Update(static_cast<uint32_t>(createInfo.cbState.dualSourceBlendEnable));
+    hasher.Update(createInfo.cbState.logicOp);
+
+    for (uint32_t i = 0; i < Pal::MaxColorTargets; ++i)
+    {
+        hasher.Update(createInfo.cbState.target[i].swizzledFormat.format);
+        hasher.Update(createInfo.cbState.target[i].swizzledFormat.swizzle);
+        hasher.Update(static_cast<uint32_t>(createInfo.cbState.target[i].channelWriteMask));
+        hasher.Update(static_cast<uint32_t>(createInfo.cbState.target[i].forceAlphaToOne));
+    }
+
+    hasher.Update(static_cast<uint32_t>(createInfo.viewportInfo.depthClipNearEnable));
+    hasher.Update(static_cast<uint32_t>(createInfo.viewportInfo.depthClipFarEnable));
+    hasher.Update(createInfo.viewportInfo.depthRange);
+
+    hasher.Update(static_cast<uint32_t>(createInfo.viewInstancingDesc.viewInstanceCount));
+    hasher.Update(static_cast<uint32_t>(createInfo.viewInstancingDesc.enableMasking));
+
+    for (uint32_t i = 0; i < createInfo.viewInstancingDesc.viewInstanceCount; ++i)
+    {
+        hasher.Update(static_cast<uint32_t>(createInfo.viewInstancingDesc.viewId[i]));
+    }
+
+    hasher.Update(createInfo.numShaderLibraries);
+
+    for (uint32_t i = 0; i < createInfo.numShaderLibraries; ++i)
+    {
+        hasher.Update(createInfo.ppShaderLibraries[i]);
+    }
+
+    hasher.Update(reinterpret_cast<const uint8_t*>(pLibraryHashes), sizeof(uint64_t) * GraphicsLibraryCount);
+    hasher.Update(flags);
+
+    hasher.Finalize(pKey->bytes);
+}
+
+// =====================================================================================================================
+// Returns the PAL pipelines linked for the given key, creating them on a miss.  The caller owns one reference to the
+// returned pipelines and must return it through ReleasePalPipelines().
+VkResult GraphicsPipelineLinkCache::AcquirePalPipelines(
+    const Util::MetroHash::Hash&           key,
+    const Pal::GraphicsPipelineCreateInfo& createInfo,
+    Pal::IPipeline*                        pPalPipelines[MaxPalDevices],
+    bool*                                  pCacheHit)
+{
+    VK_ASSERT(createInfo.numShaderLibraries <= GraphicsLibraryCount);
+
+    LinkedPipeline* pEntry = nullptr;
+
+    {
+        Util::MutexAuto lock(&m_mutex);
+
+        LinkedPipeline** ppEntry = m_linkMap.FindKey(key);
+
+        if (ppEntry != nullptr)
+        {
+            pEntry = *ppEntry;
+            pEntry->refCount++;
+        }
+    }
+
+    *pCacheHit = (pEntry != nullptr);
+
+    VkResult result = VK_SUCCESS;
+
+    if (pEntry == nullptr)
+    {
+        // Create the PAL pipelines without holding the lock; a racing link of the same key is resolved below.
+        const uint32_t numPalDevices = m_pDevice->NumPalDevices();
+        Pal::Result    palResult     = Pal::Result::Success;
+        const size_t   palSize       =
+            m_pDevice->PalDevice(DefaultDeviceIndex)->GetGraphicsPipelineSize(createInfo, &palResult);
+
+        LinkedPipeline* pNewEntry = nullptr;
+
+        if (palResult == Pal::Result::Success)
+        {
+            pNewEntry = static_cast<LinkedPipeline*>(m_pDevice->VkInstance()->AllocMem(
+                sizeof(LinkedPipeline) + (palSize * numPalDevices),
+                VK_DEFAULT_MEM_ALIGN,
+                VK_SYSTEM_ALLOCATION_SCOPE_DEVICE));
+
+            palResult = (pNewEntry != nullptr) ? Pal::Result::Success : Pal::Result::ErrorOutOfMemory;
+        }
+
+        if (pNewEntry != nullptr)
+        {
+            memset(pNewEntry, 0, sizeof(LinkedPipeline));
+
+            pNewEntry->key                = key;
+            pNewEntry->numShaderLibraries = createInfo.numShaderLibraries;
+            pNewEntry->refCount           = 1;
+
+            for (uint32_t i = 0; i < createInfo.numShaderLibraries; ++i)
+            {
+                pNewEntry->pShaderLibraries[i] = createInfo.ppShaderLibraries[i];
+            }
+
+            void* pPalMem = Util::VoidPtrInc(pNewEntry, sizeof(LinkedPipeline));
+
+            for (uint32_t deviceIdx = 0;
+                 (deviceIdx < numPalDevices) && (palResult == Pal::Result::Success);
+                 ++deviceIdx)
+            {
+                palResult = m_pDevice->PalDevice(deviceIdx)->CreateGraphicsPipeline(
+                    createInfo,
+                    Util::VoidPtrInc(pPalMem, palSize * deviceIdx),
+                    &pNewEntry->pPalPipelines[deviceIdx]);
+            }
+        }
+
+        if (palResult == Pal::Result::Success)
+        {
+            Util::MutexAuto lock(&m_mutex);
+
+            LinkedPipeline** ppEntry = m_linkMap.FindKey(key);
+
+            if (ppEntry != nullptr)
+            {
+                // Another thread linked the same pipeline first; share its objects and drop ours.
+                pEntry = *ppEntry;
+                pEntry->refCount++;
+            }
+            else
+            {
+                palResult = m_refMap.Insert(pNewEntry->pPalPipelines[DefaultDeviceIndex], pNewEntry);
+
+                if (palResult == Pal::Result::Success)
+                {
+                    pEntry    = pNewEntry;
+                    pNewEntry = nullptr;
+
+                    // Once the cache is full, an entry no pipeline uses makes room for the new one.  If every entry
+                    // is in use, the new link is still created but is not shared.
+                    if (m_linkMap.GetNumEntries() >= m_maxEntries)
+                    {
+                        EvictUnusedEntry();
+                    }
+
+                    if ((m_linkMap.GetNumEntries() < m_maxEntries) &&
+                        (m_linkMap.Insert(key, pEntry) == Pal::Result::Success))
+                    {
+                        pEntry->cached = true;
+                        pEntry->refCount++;
+                    }
+                }
+            }
+        }
+
+        if (pNewEntry != nullptr)
+        {
+            FreeEntry(pNewEntry);
+        }
+
+        result = PalToVkResult(palResult);
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        for (uint32_t deviceIdx = 0; deviceIdx < MaxPalDevices; ++deviceIdx)
+        {
+            pPalPipelines[deviceIdx] = pEntry->pPalPipelines[deviceIdx];
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Drops a pipeline's reference to PAL pipelines returned by AcquirePalPipelines().
+void GraphicsPipelineLinkCache::ReleasePalPipelines(
+    Pal::IPipeline** ppPalPipelines)
+{
+    Util::MutexAuto lock(&m_mutex);
+
+    LinkedPipeline** ppEntry = m_refMap.FindKey(ppPalPipelines[DefaultDeviceIndex]);
+
+    VK_ASSERT(ppEntry != nullptr);
+
+    if (ppEntry != nullptr)
+    {
+        ReleaseEntry(*ppEntry);
+    }
+}
+
+// =====================================================================================================================
+// Evicts every cached link that uses one of the given shader libraries.  Called when a pipeline library is destroyed
+// so its shader library objects can no longer be matched by address; pipelines still using an evicted entry keep it
+// alive until they are destroyed.
+void GraphicsPipelineLinkCache::EvictShaderLibraries(
+    uint32_t                          libraryCount,
+    const Pal::IShaderLibrary* const* ppShaderLibraries)
+{
+    Util::MutexAuto lock(&m_mutex);
+
+    if (m_linkMap.GetNumEntries() > 0)
+    {
+        Util::Vector<LinkedPipeline*, 8, PalAllocator> evicted(m_pDevice->VkInstance()->Allocator());
+        bool evictAll = false;
+
+        for (auto it = m_linkMap.Begin(); (it.Get() != nullptr) && (evictAll == false); it.Next())
+        {
+            LinkedPipeline* pEntry  = it.Get()->value;
+            bool            matches = false;
+
+            for (uint32_t i = 0; (i < pEntry->numShaderLibraries) && (matches == false); ++i)
+            {
+                for (uint32_t j = 0; (j < libraryCount) && (matches == false); ++j)
+                {
+                    matches = (ppShaderLibraries[j] != nullptr) &&
+                              (pEntry->pShaderLibraries[i] == ppShaderLibraries[j]);
+                }
+            }
+
+            // If the eviction list cannot grow, flush the whole cache rather than keep a stale library address.
+            if (matches && (evicted.PushBack(pEntry) != Pal::Result::Success))
+            {
+                evictAll = true;
+            }
+        }
+
+        if (evictAll)
+        {
+            evicted.Clear();
+
+            for (auto it = m_linkMap.Begin(); it.Get() != nullptr; it.Next())
+            {
+                it.Get()->value->cached = false;
+                ReleaseEntry(it.Get()->value);
+            }
+
+            m_linkMap.Reset();
+        }
+
+        for (uint32_t i = 0; i < evicted.NumElements(); ++i)
+        {
+            LinkedPipeline* pEntry = evicted.At(i);
+
+            m_linkMap.Erase(pEntry->key);
+            pEntry->cached = false;
+            ReleaseEntry(pEntry);
+        }
+    }
+}
+
+// =====================================================================================================================
+// Evicts one cached entry that is only referenced by the cache, if there is any.  The mutex must be held.
+void GraphicsPipelineLinkCache::EvictUnusedEntry()
+{
+    LinkedPipeline* pUnused = nullptr;
+
+    for (auto it = m_linkMap.Begin(); (it.Get() != nullptr) && (pUnused == nullptr); it.Next())
+    {
+        if (it.Get()->value->refCount == 1)
+        {
+            pUnused = it.Get()->value;
+        }
+    }
+
+    if (pUnused != nullptr)
+    {
+        m_linkMap.Erase(pUnused->key);
+        pUnused->cached = false;
+        ReleaseEntry(pUnused);
+    }
+}
+
+// =====================================================================================================================
+// Drops one reference to the given entry and frees it when the last one is gone.  The mutex must be held.
+void GraphicsPipelineLinkCache::ReleaseEntry(
+    LinkedPipeline* pEntry)
+{
+    VK_ASSERT(pEntry->refCount > 0);
+
+    pEntry->refCount--;
+
+    if (pEntry->refCount == 0)
+    {
+        VK_ASSERT(pEntry->cached == false);
+
+        m_refMap.Erase(pEntry->pPalPipelines[DefaultDeviceIndex]);
+
+        FreeEntry(pEntry);
+    }
+}
+
+// =====================================================================================================================
+// Destroys the PAL pipelines of an entry and frees its memory.
+void GraphicsPipelineLinkCache::FreeEntry(
+    LinkedPipeline* pEntry)
+{
+    for (uint32_t deviceIdx = 0; deviceIdx < MaxPalDevices; ++deviceIdx)
+    {
+        if (pEntry->pPalPipelines[deviceIdx] != nullptr)
+        {
+            pEntry->pPalPipelines[deviceIdx]->Destroy();
+        }
+    }
+
+    m_pDevice->VkInstance()->FreeMem(pEntry);
+}
+
+// =====================================================================================================================
+// Destroys the link cache.  Should be called during device destroy, before the shader libraries used by cached links
+// are destroyed.  Not necessary to take the mutex in this function because the application must not be creating or
+// destroying pipelines on the device at this point.  All pipelines must have been destroyed, so dropping the cache's
+// reference frees every entry; entries still referenced by a pipeline are left alone rather than freed under it.
+void GraphicsPipelineLinkCache::Destroy()
+{
+    for (auto it = m_refMap.Begin(); it.Get() != nullptr; it.Next())
+    {
+        LinkedPipeline* pEntry = it.Get()->value;
+
+        if (pEntry->cached)
+        {
+            pEntry->cached = false;
+            pEntry->refCount--;
+        }
+
+        VK_ASSERT(pEntry->refCount == 0);
+
+        if (pEntry->refCount == 0)
+        {
+            FreeEntry(pEntry);
+        }
+    }
+
+    m_refMap.Reset();
+    m_linkMap.Reset();
+}
+
+} // namespace vk
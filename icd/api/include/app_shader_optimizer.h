@@ -34,11 +34,16 @@
 #pragma once
 #include "include/khronos/vulkan.h"
 
+#include "include/vk_alloccb.h"
 #include "include/vk_shader_code.h"
 #include "appopt/g_shader_profile.h"
 
 #include "vkgcDefs.h"
 
+#include "palHashMap.h"
+#include "palMetroHash.h"
+#include "palVector.h"
+
 #if PAL_ENABLE_PRINTS_ASSERTS
 #include "palMutex.h"
 #endif
@@ -99,6 +104,88 @@ struct PipelineShaderOptionsPtr
 constexpr uint32_t CompilerTemporalHintOffset = 7;
 #endif
 
+// =====================================================================================================================
+// Hash index over the entries of a PipelineProfile.  Entries whose pattern can only match a pipeline containing a
+// shader with a specific code hash are looked up by that shader's stage and code hash; the remaining (wildcard) entries
+// are candidates for every pipeline.
+class PipelineProfileIndex
+{
+public:
+    typedef Util::Vector<uint32_t, 64, PalAllocator> EntryList;
+
+    PipelineProfileIndex(
+        uint32_t      numBuckets,
+        PalAllocator* pAllocator);
+
+    void Build(
+        const PipelineProfile&       profile,
+        const VkAllocationCallbacks* pAllocCB);
+
+    void Destroy(const VkAllocationCallbacks* pAllocCB);
+
+    bool GetCandidateEntries(
+        const PipelineOptimizerKey& pipelineKey,
+        EntryList*                  pEntries,
+        uint32_t*                   pEntryCount) const;
+
+private:
+    PAL_DISALLOW_COPY_AND_ASSIGN(PipelineProfileIndex);
+
+    struct ShaderKey
+    {
+        Pal::ShaderHash codeHash;
+        uint32_t        stage;
+        uint32_t        reserved;
+    };
+
+    // Range of m_pEntryIndices
+    struct EntryRange
+    {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    Util::HashMap<ShaderKey, EntryRange, PalAllocator, Util::JenkinsHashFunc> m_shaderMap;
+
+    uint32_t*  m_pEntryIndices;  // Wildcard entries followed by the entries of each shader key, each in profile order
+    EntryRange m_wildcards;
+    bool       m_valid;          // False if the index could not be built and all entries must be tested
+};
+
+// =====================================================================================================================
+// The entries of a PipelineProfile that may match a given pipeline, in profile order.  Every candidate must still be
+// tested with ShaderOptimizer::GetFirstMatchingShader().
+class PipelineProfileCandidates
+{
+public:
+    PipelineProfileCandidates(
+        const PipelineProfile&      profile,
+        const PipelineProfileIndex& index,
+        const PipelineOptimizerKey& pipelineKey,
+        PalAllocator*               pAllocator)
+        :
+        m_entries(pAllocator),
+        m_count(0)
+    {
+        m_useIndex = index.GetCandidateEntries(pipelineKey, &m_entries, &m_count);
+
+        if (m_useIndex == false)
+        {
+            m_count = profile.entryCount;
+        }
+    }
+
+    uint32_t Count() const { return m_count; }
+    uint32_t Entry(uint32_t idx) const { return m_useIndex ? m_entries.At(idx) : idx; }
+
+private:
+    PAL_DISALLOW_COPY_AND_ASSIGN(PipelineProfileCandidates);
+
+    PipelineProfileIndex::EntryList m_entries;
+    uint32_t                        m_count;
+    bool                            m_useIndex;
+};
+
 // =====================================================================================================================
 // This class can tune pre-compile SC parameters based on known shader hashes in order to improve SC code generation
 // output.
@@ -178,12 +265,14 @@ private:
 
     void ApplyProfileToShaderCreateInfo(
         const PipelineProfile&           profile,
+        const PipelineProfileIndex&      index,
         const PipelineOptimizerKey&      pipelineKey,
         uint32_t                         shaderIndex,
         PipelineShaderOptionsPtr         options) const;
 
     void ApplyProfileToGraphicsPipelineCreateInfo(
         const PipelineProfile&            profile,
+        const PipelineProfileIndex&       index,
         const PipelineOptimizerKey&       pipelineKey,
         VkShaderStageFlagBits             shaderStages,
         Pal::GraphicsPipelineCreateInfo*  pPalCreateInfo,
@@ -191,6 +280,7 @@ private:
 
     void ApplyProfileToComputePipelineCreateInfo(
         const PipelineProfile&           profile,
+        const PipelineProfileIndex&      index,
         const PipelineOptimizerKey&      pipelineKey,
         Pal::DynamicComputeShaderInfo*   pDynamicComputeShaderInfo) const;
 
@@ -209,10 +299,12 @@ private:
 
     bool HasMatchingProfileEntry(
         const PipelineProfile&      profile,
+        const PipelineProfileIndex& index,
         const PipelineOptimizerKey& pipelineKey) const;
 
     void CalculateMatchingProfileEntriesHash(
         const PipelineProfile&      profile,
+        const PipelineProfileIndex& index,
         const PipelineOptimizerKey& pipelineKey,
         Util::MetroHash128*         pHasher) const;
 
@@ -225,6 +317,14 @@ private:
 #if VKI_RUNTIME_APP_PROFILE
     void BuildRuntimeProfile();
     void RuntimeProfileParseError();
+
+    bool LoadRuntimeProfileBinary(
+        const char*                  pBinaryPath,
+        const Util::MetroHash::Hash& jsonHash);
+
+    void StoreRuntimeProfileBinary(
+        const char*                  pBinaryPath,
+        const Util::MetroHash::Hash& jsonHash) const;
 #endif
 
 #if PAL_ENABLE_PRINTS_ASSERTS
@@ -240,10 +340,17 @@ private:
     PipelineProfile        m_tuningProfile;
     PipelineProfile        m_appProfile;
 
+    PipelineProfileIndex   m_tuningProfileIndex;
+    PipelineProfileIndex   m_appProfileIndex;
+
     ShaderProfile          m_appShaderProfile;
 
 #if VKI_RUNTIME_APP_PROFILE
     PipelineProfile        m_runtimeProfile;
+    PipelineProfileIndex   m_runtimeProfileIndex;
+    void*                  m_pRuntimeProfileMapping;     // Read-only mapping of the runtime profile binary the
+                                                         // runtime profile entries point into, if it was loaded
+    size_t                 m_runtimeProfileMappingSize;
 #endif
 
 #if PAL_ENABLE_PRINTS_ASSERTS
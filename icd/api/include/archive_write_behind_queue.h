@@ -0,0 +1,115 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  archive_write_behind_queue.h
+* @brief Declaration of the queue writing pipeline binaries to the archive file layers in the background.
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/vk_utils.h"
+
+#include "palCacheLayer.h"
+#include "palDequeImpl.h"
+#include "palEvent.h"
+#include "palMetroHash.h"
+#include "palMutex.h"
+#include "palThread.h"
+#include "palVectorImpl.h"
+
+namespace vk
+{
+
+class PipelineBinaryCache;
+struct PipelineBinaryCacheWriteBehindStats;
+
+// Writes pipeline binaries to the archive file layers of a PipelineBinaryCache on a dedicated thread, so that slow file
+// systems don't hold up the thread that compiled the pipeline. Stores are copied into the queue up to a byte budget;
+// once the budget is used up, stores are written on the calling thread instead. All queued writes are flushed before
+// the queue is destroyed.
+class ArchiveWriteBehindQueue final : public Util::Thread
+{
+public:
+    static ArchiveWriteBehindQueue* Create(
+        PipelineBinaryCache* pPipelineBinaryCache,
+        Util::ICacheLayer*   pTargetLayer,
+        uint64_t             budget);
+
+    void Destroy();
+
+    Util::Result Store(
+        const Util::MetroHash::Hash* pCacheId,
+        const void*                  pData,
+        size_t                       dataSize);
+
+    void GetStats(PipelineBinaryCacheWriteBehindStats* pStats) const;
+
+private:
+    PAL_DISALLOW_COPY_AND_ASSIGN(ArchiveWriteBehindQueue);
+
+    struct PendingWrite
+    {
+        Util::MetroHash::Hash cacheId;
+        void*                 pData;    // Copy of the binary owned by the queue
+        size_t                dataSize;
+    };
+
+    ArchiveWriteBehindQueue(
+        PipelineBinaryCache* pPipelineBinaryCache,
+        Util::ICacheLayer*   pTargetLayer,
+        uint64_t             budget);
+
+    ~ArchiveWriteBehindQueue();
+
+    static void ThreadFunc(void* pParam)
+        { static_cast<ArchiveWriteBehindQueue*>(pParam)->FlushThreadFunc(); }
+
+    using WriteBatch = Util::Vector<PendingWrite, 16, PalAllocator>;
+
+    void FlushThreadFunc();
+    void FlushBatch(WriteBatch* pBatch);
+
+    Util::Result Write(const Util::MetroHash::Hash* pCacheId, const void* pData, size_t dataSize) const;
+
+    using WriteQueue = Util::Deque<PendingWrite, PalAllocator>;
+
+    PipelineBinaryCache* const m_pPipelineBinaryCache;
+    Util::ICacheLayer* const   m_pTargetLayer;      // Layer the queued binaries are stored to
+    const uint64_t             m_budget;            // Maximum number of bytes held by the queue
+    WriteQueue                 m_queue;
+    mutable Util::Mutex        m_lock;              // Protects m_queue and the counters below
+    Util::Event                m_event;             // Signaled when writes are queued or the thread should stop
+    volatile bool              m_stop;              // Set once the thread should exit after flushing the queue
+
+    uint64_t                   m_pendingBytes;      // Bytes queued or being written, counted against m_budget
+    uint64_t                   m_queuedEntries;
+    uint64_t                   m_queuedBytes;
+    uint64_t                   m_flushedEntries;
+    uint64_t                   m_flushedBytes;
+    uint64_t                   m_synchronousWrites; // Stores written on the calling thread because of the budget
+};
+
+} // namespace vk
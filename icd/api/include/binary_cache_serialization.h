@@ -68,6 +68,7 @@ struct VkAllocationCallbacks;
 
 namespace Util
 {
+class IHashContext;
 class IPlatformKey;
 }
 
@@ -96,13 +97,40 @@ Util::Result WriteVkPipelineCacheHeaderData(
     size_t*  pBytesWritten
 );
 
+// Version of the pipeline binary cache blob layout, must be bumped whenever the layout of the headers below changes.
+constexpr uint32_t PipelineBinaryCacheBlobVersion = 2;
+
 // Layout for pipeline binary cache entry header, all fields are written with LSB first.
 struct BinaryCacheEntry
 {
     Util::MetroHash::Hash hashId;
     size_t                dataSize;
+    uint64_t              checksum; // Checksum of the entry data (see CalculateBinaryCacheEntryChecksum), 0 if absent.
 };
 
+// Returns the checksum stored in BinaryCacheEntry::checksum for the given entry data. Never returns 0, which marks
+// entries without a checksum.
+inline uint64_t CalculateBinaryCacheEntryChecksum(
+    const void* pData,
+    size_t      dataSize)
+{
+    uint64_t checksum = 0;
+    Util::MetroHash64::Hash(static_cast<const uint8_t*>(pData), dataSize, reinterpret_cast<uint8_t*>(&checksum));
+
+    return (checksum != 0) ? checksum : 1;
+}
+
+// Returns whether the entry data matches the checksum of its header. Entries without a checksum only match if
+// allowMissing is set.
+inline bool IsValidBinaryCacheEntry(
+    const BinaryCacheEntry& entry,
+    const void*             pData,
+    bool                    allowMissing)
+{
+    return (entry.checksum == 0) ? allowMissing
+                                 : (entry.checksum == CalculateBinaryCacheEntryChecksum(pData, entry.dataSize));
+}
+
 // Layout for pipeline binary cache header, all fields are written with LSB first.
 constexpr size_t SHA_DIGEST_LENGTH = 20;
 struct PipelineBinaryCachePrivateHeader
@@ -110,6 +138,65 @@ struct PipelineBinaryCachePrivateHeader
     uint8_t  hashId[SHA_DIGEST_LENGTH];
 };
 
+// Layout for the delta chunk header which directly follows the private header in blobs produced by incremental
+// serialization. A delta chunk only carries the entries inserted within [baseGeneration, generation), so a sequence of
+// chunks can be folded back into a single cache in order. All fields are written with LSB first.
+constexpr uint64_t PipelineBinaryCacheDeltaMagic = 0x41544c4544435058ull; // "XPCDELTA"
+struct PipelineBinaryCacheDeltaHeader
+{
+    uint64_t magic;          // Must be PipelineBinaryCacheDeltaMagic.
+    uint64_t baseGeneration; // Generation of the first entry that may be contained in this chunk.
+    uint64_t generation;     // Generation following the last entry that may be contained in this chunk.
+};
+
+bool ReadPipelineBinaryCacheDeltaHeader(
+    const void*                     pCacheData,
+    size_t                          dataSize,
+    PipelineBinaryCacheDeltaHeader* pDeltaHeader);
+
+// Layout for read-only pipeline binary archives which are meant to be memory-mapped. A hash index of the entries
+// directly follows the header, so a lookup only touches the index slots it probes and the requested binary:
+// ```
+// | MappedPipelineArchiveHeader | MappedPipelineArchiveIndexEntry[indexSize] | Blob (n) | Blob (n) | ...
+// ```
+// The index uses open addressing with linear probing, starting at the slot selected by the low bits of the cache ID.
+// All fields are written with LSB first.
+constexpr uint64_t MappedPipelineArchiveMagic   = 0x52414d4150435058ull; // "XPCPAMAR"
+constexpr uint32_t MappedPipelineArchiveVersion = 2;
+
+struct MappedPipelineArchiveHeader
+{
+    uint64_t magic;        // Must be MappedPipelineArchiveMagic.
+    uint32_t version;      // Must be MappedPipelineArchiveVersion.
+    uint32_t indexSize;    // Number of index slots, a power of two larger than entryCount.
+    uint64_t platformKey;  // 64-bit platform key of the device the binaries were built for.
+    uint64_t entryCount;   // Number of valid index slots.
+    uint64_t fileSize;     // Size of the whole archive in bytes.
+};
+
+struct MappedPipelineArchiveIndexEntry
+{
+    Util::MetroHash::Hash hashId;     // Cache ID of the entry.
+    uint64_t              dataOffset; // Offset of the binary from the start of the archive, 0 for an empty slot.
+    uint64_t              dataSize;   // Size of the binary in bytes.
+    uint64_t              checksum;   // BinaryCacheEntry::checksum of the binary, 0 if absent.
+};
+
+// Returns the index slot a lookup for the given cache ID starts probing at.
+inline uint32_t GetMappedPipelineArchiveSlot(
+    const Util::MetroHash::Hash& hashId,
+    uint32_t                     indexSize)
+{
+    return static_cast<uint32_t>(hashId.qwords[0]) & (indexSize - 1);
+}
+
+Util::Result WriteMappedPipelineArchive(
+    VkAllocationCallbacks*    pAllocationCallbacks,
+    const Util::IPlatformKey* pPlatformKey,
+    const void*               pCacheBlob,
+    size_t                    cacheBlobSize,
+    const char*               pFilePath);
+
 Util::Result CalculatePipelineBinaryCacheHashId(
     VkAllocationCallbacks*    pAllocationCallbacks,
     const Util::IPlatformKey* pPlatformKey,
@@ -118,7 +205,8 @@ Util::Result CalculatePipelineBinaryCacheHashId(
     uint8_t*                  pHashId);
 
 // =====================================================================================================================
-// Class for serializing in-memory cache data into valid pipeline binary cache blobs.
+// Class for serializing in-memory cache data into valid pipeline binary cache blobs. The blob digest is computed as the
+// entries are added, so finalizing the blob does not need another pass over the data.
 class PipelineBinaryCacheSerializer
 {
 public:
@@ -132,32 +220,48 @@ public:
         return HeaderSize + (numEntries * EntryHeaderSize) + totalPipelineBinariesSize;
     }
 
+    // Returns an upper bound for the size of a delta chunk blob, see CalculateAnticipatedCacheBlobSize.
+    static size_t CalculateAnticipatedDeltaBlobSize(
+        size_t numEntries,
+        size_t totalPipelineBinariesSize)
+    {
+        return CalculateAnticipatedCacheBlobSize(numEntries, totalPipelineBinariesSize) + DeltaHeaderSize;
+    }
+
     PipelineBinaryCacheSerializer() = default;
+    ~PipelineBinaryCacheSerializer();
 
     Util::Result Initialize(
-        size_t bufferCapacity,
-        void*  pOutputBuffer);
+        VkAllocationCallbacks*                pAllocationCallbacks,
+        const Util::IPlatformKey*             pKey,
+        size_t                                bufferCapacity,
+        void*                                 pOutputBuffer,
+        const PipelineBinaryCacheDeltaHeader* pDeltaHeader = nullptr);
 
     Util::Result AddPipelineBinary(
         const BinaryCacheEntry* pEntry,
         const void*             pData);
 
     Util::Result Finalize(
-        VkAllocationCallbacks*    pAllocationCallbacks,
-        const Util::IPlatformKey* pKey,
-        size_t*                   pCacheEntriesWritten,
-        size_t*                   pBytesWritten);
+        size_t* pCacheEntriesWritten,
+        size_t* pBytesWritten);
 
 private:
     PAL_DISALLOW_COPY_AND_ASSIGN(PipelineBinaryCacheSerializer);
 
     static constexpr size_t HeaderSize      = sizeof(PipelineBinaryCachePrivateHeader);
     static constexpr size_t EntryHeaderSize = sizeof(BinaryCacheEntry);
+    static constexpr size_t DeltaHeaderSize = sizeof(PipelineBinaryCacheDeltaHeader);
+
+    void DestroyHashContext();
 
-    size_t m_numEntries     = 0;
-    void*  m_pOutputBuffer  = nullptr;
-    size_t m_bufferCapacity = 0;
-    size_t m_bytesUsed      = 0;
+    size_t                 m_numEntries           = 0;
+    void*                  m_pOutputBuffer        = nullptr;
+    size_t                 m_bufferCapacity       = 0;
+    size_t                 m_bytesUsed            = 0;
+    VkAllocationCallbacks* m_pAllocationCallbacks = nullptr;
+    Util::IHashContext*    m_pHashContext         = nullptr; // Running digest of everything after the private header
+    void*                  m_pHashContextMem      = nullptr;
 };
 
 }
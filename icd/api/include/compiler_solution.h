@@ -90,6 +90,24 @@ struct LlpcShaderLibraryBlobHeader
     uint32_t fragMetaLength;  // Fragment shader metadata length
     bool     requireFullPipeline; // Whether require full pipeline
 };
+// =====================================================================================================================
+// Phases of pipeline creation whose CPU time is tracked in PipelineCreationFeedback::phaseDuration.  The phases are
+// disjoint: Upload runs inside another phase, and its time is taken out of that phase.  VkPipelineCreationFeedback
+// only has room for the total duration, so the breakdown is reported through the pipeline compiler telemetry dump
+// ("creationPhases", totaled per pipeline type) rather than to the application.
+enum PipelineCreationPhase : uint32_t
+{
+    PipelineCreationPhaseApiHash = 0,           // BuildApiHash
+    PipelineCreationPhaseCacheId,               // Shader stage infos, optimizer keys and cache IDs
+    PipelineCreationPhaseConvertInfo,           // Conversion of the Vulkan create info to the compiler's build info
+    PipelineCreationPhaseAppCacheLookup,        // Lookup in the application's VkPipelineCache
+    PipelineCreationPhaseInternalCacheLookup,   // Lookup in the driver's internal pipeline binary cache
+    PipelineCreationPhaseCompile,               // Pipeline compilation (LLPC)
+    PipelineCreationPhaseUpload,                // Upload of the internal buffer data (UploadInternalBufferData)
+    PipelineCreationPhasePalCreate,             // Creation of the PAL pipeline objects
+    PipelineCreationPhaseCount
+};
+
 // =====================================================================================================================
 // Pipeline Creation feedback info.
 struct PipelineCreationFeedback
@@ -97,6 +115,8 @@ struct PipelineCreationFeedback
     bool        feedbackValid;
     bool        hitApplicationCache;
     uint64_t    duration;
+    uint64_t    phaseDuration[PipelineCreationPhaseCount];  // In nanoseconds
+    uint64_t    nestedDuration;                             // Upload time not yet taken out of its enclosing phase
 };
 
 // =====================================================================================================================
@@ -36,8 +36,9 @@
 #include "include/vk_alloccb.h"
 #include "palThread.h"
 #include "palMutex.h"
-#include "palList.h"
+#include "palDequeImpl.h"
 #include "palEvent.h"
+#include "palSysUtil.h"
 
 namespace vk
 {
@@ -45,23 +46,125 @@ namespace vk
 class DeferCompileManager;
 class PalAllocator;
 
+// Scheduling priority of a deferred compile task. High priority tasks are executed before any normal priority task,
+// which is meant for work some thread is blocked waiting on.
+enum class DeferCompilePriority : uint32_t
+{
+    Normal = 0,
+    High,
+    Count
+};
+
+// =====================================================================================================================
+// Completion count of a group of deferred compile tasks.  A thread waiting on the group only waits for the tasks of
+// that group, not for unrelated work queued on the thread pool.  The count is only changed under the lock, so once
+// Wait() has returned no worker touches the group anymore and the owner may destroy it.
+class DeferCompileTaskGroup
+{
+public:
+    DeferCompileTaskGroup()
+        :
+        m_pendingTasks(0)
+    {
+    }
+
+    Util::Result Init()
+    {
+        Util::EventCreateFlags flags = {};
+        flags.manualReset       = true;
+        flags.initiallySignaled = true;
+
+        return m_event.Init(flags);
+    }
+
+    // Adds tasks to the group.  Must be called before the tasks are queued.
+    void AddTasks(uint32_t count)
+    {
+        if (count > 0)
+        {
+            Util::MutexAuto lock(&m_lock);
+
+            // None of the new tasks can complete before they are queued, so the count can't drop to zero in between.
+            m_pendingTasks += count;
+            m_event.Reset();
+        }
+    }
+
+    // Called once for every task of the group after it was executed.  This is the last access of the group on behalf
+    // of the task.
+    void CompleteTask()
+    {
+        Util::MutexAuto lock(&m_lock);
+
+        VK_ASSERT(m_pendingTasks > 0);
+
+        if (--m_pendingTasks == 0)
+        {
+            m_event.Set();
+        }
+    }
+
+    // Returns once all tasks added to the group were executed.  Tasks which have not started yet should be claimed
+    // by DeferCompileManager::RunGroupTasks() instead, as otherwise this waits for a worker to pick them up.
+    void Wait()
+    {
+        while (IsIdle() == false)
+        {
+            m_event.Wait(Util::fseconds{ 1.0f });
+        }
+    }
+
+private:
+    PAL_DISALLOW_COPY_AND_ASSIGN(DeferCompileTaskGroup);
+
+    bool IsIdle()
+    {
+        Util::MutexAuto lock(&m_lock);
+
+        return (m_pendingTasks == 0);
+    }
+
+    uint32_t    m_pendingTasks; // Tasks added to the group and not executed yet
+    Util::Mutex m_lock;         // Serializes m_pendingTasks and m_event against a group destroyed after Wait()
+    Util::Event m_event;        // Signaled while m_pendingTasks is zero
+};
+
 struct DeferredCompileWorkload
 {
-    void*       pPayloads;
-    void        (*Execute)(void*); // Function pointer to the call used to execute the workload
-    Util::Event* pEvent;
+    void*                  pPayloads;
+    void                   (*Execute)(void*); // Function pointer to the call used to execute the workload
+    Util::Event*           pEvent;
+    DeferCompileTaskGroup* pGroup;            // Optional group the workload counts towards
+    DeferCompilePriority   priority;
+};
+
+// Counters of the deferred compile thread pool, for profiling.
+struct DeferCompileStats
+{
+    uint32_t queuedTasks;    // Tasks submitted so far
+    uint32_t executedTasks;  // Tasks executed so far
+    uint32_t stolenTasks;    // Tasks executed by a thread other than the one they were queued on
+    uint32_t queueDepth;     // Tasks currently waiting in the queues
+    uint32_t maxQueueDepth;  // Highest queue depth seen so far
 };
 
 // =====================================================================================================================
-// Represents the general thread for async shader/pipeline compiler.
+// Represents the general thread for async shader/pipeline compiler. Each thread owns a deque per priority; the owner
+// takes tasks from the front while idle threads steal from the back.
 class DeferCompileThread final : public Util::Thread
 {
 public:
-    DeferCompileThread(PalAllocator* pAllocator)
+    DeferCompileThread(DeferCompileManager* pManager, uint32_t threadIndex, PalAllocator* pAllocator)
         :
-        m_taskList(pAllocator),
-        m_stop(false)
+        m_pManager(pManager),
+        m_threadIndex(threadIndex),
+        m_taskQueues{ TaskQueue(pAllocator), TaskQueue(pAllocator) },
+        m_queueDepth(0),
+        m_stop(false),
+        m_idle(false)
     {
+        static_assert(static_cast<uint32_t>(DeferCompilePriority::Count) == 2, "Update m_taskQueues initializer!");
+
         Util::EventCreateFlags flags = {};
         flags.manualReset = true;
         flags.initiallySignaled = false;
@@ -74,31 +177,99 @@ public:
         Util::Thread::Begin(ThreadFunc, this);
     }
 
-    // Adds task to list.
-    void AddTask(DeferredCompileWorkload* pTask)
+    // Adds task to the queue of its priority.
+    Util::Result AddTask(const DeferredCompileWorkload& task)
     {
-        Util::MutexAuto mutexAuto(&m_lock);
-        m_taskList.PushBack(*pTask);
-        m_event.Set();
+        Util::Result result = Util::Result::Success;
+        {
+            Util::MutexAuto mutexAuto(&m_lock);
+            result = m_taskQueues[static_cast<uint32_t>(task.priority)].PushBack(task);
+        }
+
+        if (result == Util::Result::Success)
+        {
+            Util::AtomicIncrement(&m_queueDepth);
+            Wake();
+        }
+
+        return result;
     }
 
-    // Set flag stop and trig event.
-    void SetStop()
+    // Fetches the oldest task of the highest non-empty priority, return false if all queues are empty.
+    bool FetchTask(DeferredCompileWorkload* pTask)
     {
-        m_event.Set();
-        m_stop = true;
+        return FetchTask(DeferCompilePriority::High, false, pTask) ||
+               FetchTask(DeferCompilePriority::Normal, false, pTask);
     }
 
-    // Returns until all tasks are executed.
-    void SyncAll()
+    // Steals the newest task of the given priority, return false if the queue is empty.
+    bool StealTask(DeferCompilePriority priority, DeferredCompileWorkload* pTask)
     {
-        m_event.Set();
-        while (m_taskList.Begin() != m_taskList.End())
+        return FetchTask(priority, true, pTask);
+    }
+
+    // Takes the oldest queued task of the given group out of the queues, highest priority first.  The tasks queued
+    // before it are shifted back by one slot in place, so the order of the other tasks is kept.
+    bool ClaimTask(const DeferCompileTaskGroup* pGroup, DeferredCompileWorkload* pTask)
+    {
+        bool found = false;
+
+        if (m_queueDepth > 0)
+        {
+            Util::MutexAuto mutexAuto(&m_lock);
+
+            for (uint32_t p = static_cast<uint32_t>(DeferCompilePriority::Count); (found == false) && (p > 0); --p)
+            {
+                TaskQueue* pQueue    = &m_taskQueues[p - 1];
+                uint32_t   taskIndex = 0;
+
+                for (auto it = pQueue->Begin(); (it.Get() != nullptr) && (it.Get()->pGroup != pGroup); it.Next())
+                {
+                    ++taskIndex;
+                }
+
+                if (taskIndex < pQueue->NumElements())
+                {
+                    // Carry every task one slot towards the back until the claimed one ends up in the carry.
+                    auto                    it    = pQueue->Begin();
+                    DeferredCompileWorkload carry = *it.Get();
+
+                    for (uint32_t i = 0; i < taskIndex; ++i)
+                    {
+                        it.Next();
+
+                        const DeferredCompileWorkload next = *it.Get();
+                        *it.Get() = carry;
+                        carry     = next;
+                    }
+
+                    *pTask = carry;
+                    found  = (pQueue->PopFront(&carry) == Util::Result::Success);
+                }
+            }
+        }
+
+        if (found)
         {
-            Util::YieldThread();
+            Util::AtomicDecrement(&m_queueDepth);
         }
+
+        return found;
     }
 
+    // Set flag stop and trig event.
+    void SetStop()
+    {
+        m_stop = true;
+        m_event.Set();
+    }
+
+    // Wakes up the thread if it is waiting for work.
+    void Wake() { m_event.Set(); }
+
+    uint32_t QueueDepth() const { return m_queueDepth; }
+    bool     IsIdle() const { return m_idle; }
+
 protected:
     // Async thread function
     static void ThreadFunc(
@@ -109,48 +280,46 @@ protected:
     }
 
     // The implementation of async thread function
-    void TaskThreadFunc()
+    void TaskThreadFunc();
+
+    bool FetchTask(DeferCompilePriority priority, bool fromBack, DeferredCompileWorkload* pTask)
     {
-        while (m_stop == false)
+        bool found = false;
+
+        if (m_queueDepth > 0)
         {
-            // Waits for new signal.
-            m_event.Wait(Util::fseconds{ 1.0f });
-            m_event.Reset();
+            Util::MutexAuto mutexAuto(&m_lock);
+            TaskQueue*      pQueue = &m_taskQueues[static_cast<uint32_t>(priority)];
 
-            DeferredCompileWorkload task;
-            while (FetchTask(&task))
+            if (pQueue->NumElements() > 0)
             {
-                task.Execute(task.pPayloads);
-                if (task.pEvent != nullptr)
-                {
-                    task.pEvent->Set();
-                }
+                found = ((fromBack ? pQueue->PopBack(pTask) : pQueue->PopFront(pTask)) == Util::Result::Success);
             }
         }
-    }
 
-    // Fetches task in list, return false if task list is empty.
-    bool FetchTask(DeferredCompileWorkload* pTask)
-    {
-        Util::MutexAuto mutexAuto(&m_lock);
-        auto beginIt = m_taskList.Begin();
-        if (beginIt != m_taskList.End())
+        if (found)
         {
-            *pTask = *(beginIt.Get());
-            m_taskList.Erase(&beginIt);
-            return true;
+            Util::AtomicDecrement(&m_queueDepth);
         }
-        return false;
+
+        return found;
     }
 
-    Util::List<DeferredCompileWorkload, vk::PalAllocator> m_taskList;      // Deferred compile task list
-    volatile bool                                         m_stop;          // Flag to stop the thread
-    Util::Mutex                                           m_lock;          // Lock for accessing task list
-    Util::Event                                           m_event;         // Event to notify async thread
+    using TaskQueue = Util::Deque<DeferredCompileWorkload, vk::PalAllocator>;
+
+    DeferCompileManager* const m_pManager;    // Owning thread pool
+    const uint32_t             m_threadIndex; // Index of this thread in the pool
+    TaskQueue                  m_taskQueues[static_cast<uint32_t>(DeferCompilePriority::Count)]; // Queue per priority
+    volatile uint32_t          m_queueDepth;  // Number of tasks in m_taskQueues
+    volatile bool              m_stop;        // Flag to stop the thread
+    volatile bool              m_idle;        // Thread is waiting for work
+    Util::Mutex                m_lock;        // Lock for accessing task queues
+    Util::Event                m_event;       // Event to notify async thread
 };
 
 // =====================================================================================================================
-// Class that manage DeferCompileThread instance.
+// Class that manage DeferCompileThread instance. Tasks are queued on the least loaded thread; threads which run out of
+// work steal from the others, high priority tasks first.
 class DeferCompileManager
 {
 public:
@@ -158,7 +327,8 @@ public:
         :
         m_pCompileThreads{},
         m_taskId(0),
-        m_activeThreadCount(0)
+        m_activeThreadCount(0),
+        m_stats{}
     {
     }
 
@@ -172,7 +342,7 @@ public:
         {
             Util::SystemInfo sysInfo = {};
             Util::QuerySystemInfo(&sysInfo);
-            m_activeThreadCount = Util::Min(MaxThreads, sysInfo.cpuLogicalCoreCount / 2);
+            m_activeThreadCount = Util::Max(1u, Util::Min(MaxThreads, sysInfo.cpuLogicalCoreCount / 2));
         }
         else
         {
@@ -182,7 +352,12 @@ public:
         for (uint32_t i = 0; i < m_activeThreadCount; ++i)
         {
             m_pCompileThreads[i] = VK_PLACEMENT_NEW(m_compileThreadBuffer[i])
-                DeferCompileThread(pAllocator);
+                DeferCompileThread(this, i, pAllocator);
+        }
+
+        // Only start the threads once all of them exist, as they look at each other's queues.
+        for (uint32_t i = 0; i < m_activeThreadCount; ++i)
+        {
             m_pCompileThreads[i]->Begin();
         }
     }
@@ -192,6 +367,10 @@ public:
         for (uint32_t i = 0; i < m_activeThreadCount; ++i)
         {
             m_pCompileThreads[i]->SetStop();
+        }
+
+        for (uint32_t i = 0; i < m_activeThreadCount; ++i)
+        {
             m_pCompileThreads[i]->Join();
             Util::Destructor(m_pCompileThreads[i]);
             m_pCompileThreads[i] = nullptr;
@@ -199,26 +378,139 @@ public:
         m_activeThreadCount = 0;
     }
 
-    void SyncAll()
+    // Queues a task on the least loaded thread. Returns false if the task could not be queued, in which case the caller
+    // is expected to execute it.
+    bool AddTask(const DeferredCompileWorkload& task)
+    {
+        bool queued = false;
+
+        if (m_activeThreadCount > 0)
+        {
+            // Start the search at a rotating position so that ties don't always land on the same thread.
+            const uint32_t firstIdx  = Util::AtomicIncrement(&m_taskId) % m_activeThreadCount;
+            uint32_t       targetIdx = firstIdx;
+
+            for (uint32_t i = 1; (i < m_activeThreadCount) && (m_pCompileThreads[targetIdx]->QueueDepth() > 0); ++i)
+            {
+                const uint32_t idx = (firstIdx + i) % m_activeThreadCount;
+
+                if (m_pCompileThreads[idx]->QueueDepth() < m_pCompileThreads[targetIdx]->QueueDepth())
+                {
+                    targetIdx = idx;
+                }
+            }
+
+            queued = (m_pCompileThreads[targetIdx]->AddTask(task) == Util::Result::Success);
+
+            if (queued)
+            {
+                Util::AtomicIncrement(&m_stats.queuedTasks);
+
+                const uint32_t queueDepth = Util::AtomicIncrement(&m_stats.queueDepth);
+                uint32_t       maxDepth   = m_stats.maxQueueDepth;
+
+                while (queueDepth > maxDepth)
+                {
+                    const uint32_t oldDepth = Util::AtomicCompareAndSwap(&m_stats.maxQueueDepth, maxDepth, queueDepth);
+
+                    maxDepth = (oldDepth == maxDepth) ? queueDepth : oldDepth;
+                }
+
+                // If the chosen thread is busy, wake an idle one to steal the task.
+                if (m_pCompileThreads[targetIdx]->IsIdle() == false)
+                {
+                    for (uint32_t i = 0; i < m_activeThreadCount; ++i)
+                    {
+                        if (m_pCompileThreads[i]->IsIdle())
+                        {
+                            m_pCompileThreads[i]->Wake();
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        return queued;
+    }
+
+    // Finds a task for the given thread, first in its own queues, then in the queues of the other threads.
+    bool FetchTask(uint32_t threadIndex, DeferredCompileWorkload* pTask)
     {
+        bool found = m_pCompileThreads[threadIndex]->FetchTask(pTask);
+
+        for (uint32_t p = static_cast<uint32_t>(DeferCompilePriority::Count); (found == false) && (p > 0); --p)
+        {
+            const auto priority = static_cast<DeferCompilePriority>(p - 1);
+
+            for (uint32_t i = 1; (found == false) && (i < m_activeThreadCount); ++i)
+            {
+                found = m_pCompileThreads[(threadIndex + i) % m_activeThreadCount]->StealTask(priority, pTask);
+            }
+
+            if (found)
+            {
+                Util::AtomicIncrement(&m_stats.stolenTasks);
+            }
+        }
+
+        if (found)
+        {
+            Util::AtomicDecrement(&m_stats.queueDepth);
+        }
+
+        return found;
+    }
+
+    // Runs a fetched task and signals whoever waits for it.
+    void ExecuteTask(const DeferredCompileWorkload& task)
+    {
+        task.Execute(task.pPayloads);
+        if (task.pEvent != nullptr)
+        {
+            task.pEvent->Set();
+        }
+
+        Util::AtomicIncrement(&m_stats.executedTasks);
+
+        if (task.pGroup != nullptr)
+        {
+            task.pGroup->CompleteTask();
+        }
+    }
+
+    // Executes the tasks of the group which have not been picked up by a worker yet on the calling thread, then waits
+    // for the ones already running.  Lets the owner of the group make progress while the workers are busy.
+    void RunGroupTasks(DeferCompileTaskGroup* pGroup)
+    {
+        DeferredCompileWorkload task = {};
+
         for (uint32_t i = 0; i < m_activeThreadCount; ++i)
         {
-            m_pCompileThreads[i]->SyncAll();
+            while (m_pCompileThreads[i]->ClaimTask(pGroup, &task))
+            {
+                Util::AtomicDecrement(&m_stats.queueDepth);
+                ExecuteTask(task);
+            }
         }
+
+        pGroup->Wait();
     }
 
-    DeferCompileThread* GetCompileThread()
+    void GetStats(DeferCompileStats* pStats) const
     {
-        return (m_activeThreadCount > 0) ?
-            m_pCompileThreads[(m_taskId++) % m_activeThreadCount] :
-            nullptr;
+        *pStats = m_stats;
     }
 
+    uint32_t GetActiveThreadCount() const { return m_activeThreadCount; }
+
+    static constexpr uint32_t        MaxThreads = 32; // Max thread count for shader module compile
+
 protected:
-    static constexpr uint32_t        MaxThreads = 8;  // Max thread count for shader module compile
     DeferCompileThread*              m_pCompileThreads[MaxThreads]; // Async compiler threads
-    uint32_t                         m_taskId;                      // Hint to select compile thread
+    volatile uint32_t                m_taskId;                      // Hint to select compile thread
     uint32_t                         m_activeThreadCount;           // Active thread count
+    DeferCompileStats                m_stats;                       // Profiling counters
 
     // Internal buffer for m_pCompileThreads
     uint8_t                          m_compileThreadBuffer[MaxThreads][sizeof(DeferCompileThread)];
@@ -226,6 +518,30 @@ private:
     PAL_DISALLOW_COPY_AND_ASSIGN(DeferCompileManager);
 };
 
+// =====================================================================================================================
+// The implementation of async thread function
+inline void DeferCompileThread::TaskThreadFunc()
+{
+    while (m_stop == false)
+    {
+        DeferredCompileWorkload task;
+
+        if (m_pManager->FetchTask(m_threadIndex, &task))
+        {
+            m_pManager->ExecuteTask(task);
+        }
+        else
+        {
+            // Waits for new signal. The queues are checked again after the reset, so a task added in between is
+            // not missed.
+            m_idle = true;
+            m_event.Wait(Util::fseconds{ 1.0f });
+            m_event.Reset();
+            m_idle = false;
+        }
+    }
+}
+
 } // namespace vk
 
 #endif
@@ -124,11 +124,12 @@ union GraphicsPipelineObjectFlags
         uint32_t   shadingRateUsedInShader   : 1;
         uint32_t   fragmentShadingRateEnable : 1;
         uint32_t   viewIndexFromDeviceIndex  : 2;
+        uint32_t   sharedPalPipeline         : 1; // PAL pipelines are owned by the device's GPL link cache
 #if VKI_RAY_TRACING
         uint32_t   hasRayTracing             : 1;
-        uint32_t   reserved                  : 14;
+        uint32_t   reserved                  : 13;
 #else
-        uint32_t   reserved                  : 15;
+        uint32_t   reserved                  : 14;
 #endif
     };
     uint32_t value;
@@ -0,0 +1,138 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2014-2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  graphics_pipeline_link_cache.h
+ * @brief Device-level cache of PAL pipeline objects produced by graphics pipeline library fast-link.
+ ***********************************************************************************************************************
+ */
+
+#ifndef __GRAPHICS_PIPELINE_LINK_CACHE_H__
+#define __GRAPHICS_PIPELINE_LINK_CACHE_H__
+
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/compiler_solution.h"
+#include "include/vk_alloccb.h"
+#include "include/vk_defines.h"
+
+#include "palHashMap.h"
+#include "palMetroHash.h"
+#include "palMutex.h"
+#include "palPipeline.h"
+
+// Forward declare Vulkan classes used in this file
+namespace vk
+{
+class Device;
+};
+
+namespace vk
+{
+
+// =====================================================================================================================
+// Fast-linking a graphics pipeline from pipeline libraries does no compilation, but each link still creates new PAL
+// pipeline objects from the shader libraries.  Applications that relink the same set of libraries with the same state
+// (e.g. once per material, or after recreating a pipeline they have just destroyed) pay that cost every time.
+//
+// This cache maps a hash of the PAL pipeline create info, the linked shader libraries and their library hashes to the
+// PAL pipeline objects created for them, so a repeated link only takes a reference.  Every Vulkan pipeline using an
+// entry holds one reference and the cache holds one more while the entry is cached.  When a pipeline library is
+// destroyed, entries linked against its shader libraries are evicted and are freed once the last pipeline using them
+// is destroyed.  When the cache is full, an entry no pipeline uses is evicted to make room for a new link.
+//
+// This object is owned by the Vulkan Device.
+class GraphicsPipelineLinkCache
+{
+public:
+    GraphicsPipelineLinkCache(Device* pDevice);
+
+    VkResult Init();
+
+    bool IsEnabled() const
+        { return m_maxEntries != 0; }
+
+    static void BuildKey(
+        const Pal::GraphicsPipelineCreateInfo& createInfo,
+        const uint64_t*                        pLibraryHashes,
+        VkPipelineCreateFlags2KHR              flags,
+        Util::MetroHash::Hash*                 pKey);
+
+    VkResult AcquirePalPipelines(
+        const Util::MetroHash::Hash&           key,
+        const Pal::GraphicsPipelineCreateInfo& createInfo,
+        Pal::IPipeline*                        pPalPipelines[MaxPalDevices],
+        bool*                                  pCacheHit);
+
+    void ReleasePalPipelines(
+        Pal::IPipeline** ppPalPipelines);
+
+    void EvictShaderLibraries(
+        uint32_t                          libraryCount,
+        const Pal::IShaderLibrary* const* ppShaderLibraries);
+
+    void Destroy();
+
+private:
+    PAL_DISALLOW_COPY_AND_ASSIGN(GraphicsPipelineLinkCache);
+
+    static const uint32_t NumLinkBuckets = 32;
+
+    // A set of PAL pipeline objects shared by all Vulkan pipelines linked from the same libraries and state.  The PAL
+    // pipeline objects are placed directly after this structure in the same allocation.
+    struct LinkedPipeline
+    {
+        Util::MetroHash::Hash      key;                                    // Link key (see BuildKey())
+        const Pal::IShaderLibrary* pShaderLibraries[GraphicsLibraryCount]; // Libraries the pipeline was linked from
+        uint32_t                   numShaderLibraries;
+        Pal::IPipeline*            pPalPipelines[MaxPalDevices];           // Per-device PAL pipelines
+        uint32_t                   refCount;                               // Pipelines plus cache holding this entry
+        bool                       cached;                                 // Entry is reachable through m_linkMap
+    };
+
+    void EvictUnusedEntry();
+    void ReleaseEntry(LinkedPipeline* pEntry);
+    void FreeEntry(LinkedPipeline* pEntry);
+
+    Device* const  m_pDevice;
+    const uint32_t m_maxEntries;
+    Util::Mutex    m_mutex;
+
+    // Maps a link key to the cached entry
+    Util::HashMap<Util::MetroHash::Hash,
+                  LinkedPipeline*,
+                  PalAllocator,
+                  Util::JenkinsHashFunc>  m_linkMap;
+
+    // Maps the default device's PAL pipeline back to its entry so pipelines can release it on destroy
+    Util::HashMap<const Pal::IPipeline*,
+                  LinkedPipeline*,
+                  PalAllocator>           m_refMap;
+};
+
+} // namespace vk
+
+#endif /* __GRAPHICS_PIPELINE_LINK_CACHE_H__ */
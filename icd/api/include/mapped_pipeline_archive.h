@@ -0,0 +1,94 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  mapped_pipeline_archive.h
+* @brief Declaration of a read-only pipeline binary archive that is accessed through a memory mapping.
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/binary_cache_serialization.h"
+#include "include/vk_utils.h"
+
+namespace vk
+{
+
+class PipelineBinaryCache;
+
+// Read-only view of a pipeline binary archive written by WriteMappedPipelineArchive(). The file is mapped into the
+// address space instead of being read up front, so opening a large archive is cheap and only the pages of the index
+// slots and binaries that are actually looked up are ever touched. The mapping is private, but its clean pages still
+// come from the page cache shared by all processes that open the same archive; WriteMappedPipelineArchive() replaces
+// the file by renaming it so existing mappings stay intact. Binaries are checked against their checksum the first time
+// they are looked up rather than when the archive is opened.
+class MappedPipelineArchive
+{
+public:
+    static MappedPipelineArchive* Create(
+        PipelineBinaryCache* pPipelineBinaryCache,
+        const char*          pFilePath,
+        const char*          pFileName,
+        uint64_t             platformKey);
+
+    void Destroy();
+
+    bool Find(
+        const Util::MetroHash::Hash* pCacheId,
+        const void**                 ppData,
+        size_t*                      pDataSize) const;
+
+    uint64_t GetEntryCount() const { return m_pHeader->entryCount; }
+
+private:
+    PAL_DISALLOW_COPY_AND_ASSIGN(MappedPipelineArchive);
+
+    // Result of checking the binary of an index slot against its checksum
+    enum SlotState : uint8_t
+    {
+        SlotUnchecked = 0,
+        SlotValid,
+        SlotCorrupted
+    };
+
+    MappedPipelineArchive(
+        PipelineBinaryCache* pPipelineBinaryCache,
+        const void*          pMappedData,
+        size_t               mappedSize,
+        volatile uint8_t*    pSlotStates);
+
+    ~MappedPipelineArchive();
+
+    static bool Validate(const void* pMappedData, size_t mappedSize, uint64_t platformKey);
+
+    PipelineBinaryCache*                   m_pPipelineBinaryCache;
+    const void*                            m_pMappedData;  // Start of the read-only mapping of the archive
+    size_t                                 m_mappedSize;   // Size of the mapping in bytes
+    const MappedPipelineArchiveHeader*     m_pHeader;
+    const MappedPipelineArchiveIndexEntry* m_pIndex;       // Hash index of MappedPipelineArchiveHeader::indexSize slots
+    volatile uint8_t*                      m_pSlotStates;  // SlotState of every index slot
+};
+
+} // namespace vk
@@ -40,6 +40,7 @@
 namespace Util
 {
 class IPlatformKey;
+class JsonWriter;
 
 class IDevMode;
 } // namespace Util
@@ -47,7 +48,64 @@ class IDevMode;
 namespace vk
 {
 
+class ArchiveWriteBehindQueue;
 class CacheAdapter;
+class PipelineBinaryCacheSerializer;
+class MappedPipelineArchive;
+struct BinaryCacheEntry;
+
+// Lookup statistics of a single layer of the cache chain
+struct PipelineBinaryCacheLayerStats
+{
+    uint64_t hits;      // Queries answered by this layer
+    uint64_t misses;    // Queries that reached this layer but were not answered by it
+    uint64_t evictions; // Entries evicted to stay within the byte budget
+};
+
+// Outcome of merging source caches into a pipeline binary cache
+struct PipelineBinaryCacheMergeStats
+{
+    uint64_t mergedCount;    // Entries copied into the destination cache
+    uint64_t duplicateCount; // Entries skipped because the destination already had them
+};
+
+// Cache IDs of the source caches of a merge, bucketed by the partition of the hash space they belong to
+struct PipelineBinaryCacheMergeList
+{
+    struct Entry
+    {
+        uint32_t              srcIndex; // Index of the source cache holding the entry
+        Util::MetroHash::Hash cacheId;
+    };
+
+    Entry*    pEntries;        // Entries grouped by partition, in source order within each partition
+    uint32_t* pPartitionStart; // Index of the first entry of each partition, followed by the total entry count
+    uint32_t  partitionCount;
+};
+
+// Counters of the background writes to the archive file layers
+struct PipelineBinaryCacheWriteBehindStats
+{
+    uint64_t queuedEntries;     // Binaries handed to the flush thread
+    uint64_t queuedBytes;       // Bytes handed to the flush thread
+    uint64_t flushedEntries;    // Binaries written by the flush thread
+    uint64_t flushedBytes;      // Bytes written by the flush thread
+    uint64_t pendingBytes;      // Bytes queued or being written right now
+    uint64_t synchronousWrites; // Binaries written on the storing thread because the queue was over budget
+};
+
+struct PipelineBinaryCacheStats
+{
+    PipelineBinaryCacheLayerStats memoryLayer;
+    PipelineBinaryCacheLayerStats compressingLayer; // Queries passing through the compressing layer, if present
+    PipelineBinaryCacheLayerStats archiveLayer;     // Archive file layers and the mapped archive combined
+
+    uint64_t memoryBudget;     // Byte budget of the memory layer, 0 if only the layer's own limit applies
+    uint64_t memoryDataSize;   // Uncompressed bytes of the entries tracked against the budget
+    uint64_t memoryEntryCount; // Number of entries tracked against the budget
+
+    PipelineBinaryCacheWriteBehindStats writeBehind; // All zero unless archive writes are done in the background
+};
 
 // Unified pipeline cache interface
 class PipelineBinaryCache
@@ -120,9 +178,36 @@ public:
         void*   pBlob,
         size_t* pSize);
 
+    VkResult SerializeDelta(
+        void*   pBlob,
+        size_t* pSize);
+
+    VkResult ExportMappedArchive(
+        const char* pFilePath);
+
+    void EnableGenerationTracking();
+
+    bool IsTrackingGenerations() const { return m_trackGenerations; }
+
     VkResult Merge(
-        uint32_t                    srcCacheCount,
-        const PipelineBinaryCache** ppSrcCaches);
+        uint32_t                       srcCacheCount,
+        const PipelineBinaryCache**    ppSrcCaches,
+        PipelineBinaryCacheMergeStats* pStats = nullptr);
+
+    VkResult BuildMergeList(
+        uint32_t                      srcCacheCount,
+        const PipelineBinaryCache**   ppSrcCaches,
+        uint32_t                      partitionCount,
+        PipelineBinaryCacheMergeList* pList);
+
+    void FreeMergeList(
+        PipelineBinaryCacheMergeList* pList) const;
+
+    VkResult MergePartition(
+        const PipelineBinaryCache**         ppSrcCaches,
+        const PipelineBinaryCacheMergeList* pList,
+        uint32_t                            partitionIndex,
+        PipelineBinaryCacheMergeStats*      pStats);
 
     Util::Result LoadReinjectionBinary(
         const CacheId*           pInternalPipelineHash,
@@ -157,10 +242,16 @@ public:
     void FreeMem(
         void* pMem) const;
 
+    PalAllocator* GetPalAllocator() { return &m_palAllocator; }
+
     void Destroy();
 
     CacheAdapter* GetCacheAdapter() { return m_pCacheAdapter; }
 
+    void GetStats(PipelineBinaryCacheStats* pStats) const;
+
+    void DumpStats(Util::JsonWriter* pWriter) const;
+
     // Override the driver's default location
     static constexpr char     EnvVarPath[] = "AMD_VK_PIPELINE_CACHE_PATH";
 
@@ -180,6 +271,9 @@ private:
         const PhysicalDevice*  pPhysicalDevice,
         const RuntimeSettings& settings);
 
+    void InitWriteBehindQueue(
+        const RuntimeSettings& settings);
+
     VkResult OrderLayers(
         const RuntimeSettings& settings);
 
@@ -208,6 +302,39 @@ private:
         const char*            pDefaultCacheFilePath,
         const RuntimeSettings& settings);
 
+    Util::Result SerializeEntry(
+        BinaryCacheEntry*              pEntry,
+        PipelineBinaryCacheSerializer* pSerializer) const;
+
+    Util::Result SerializeEntryZeroCopy(
+        BinaryCacheEntry*              pEntry,
+        PipelineBinaryCacheSerializer* pSerializer) const;
+
+    bool PromoteMappedEntry(const CacheId* pCacheId);
+
+    Util::Result StoreUncheckedEntry(const BinaryCacheEntry& entry, const void* pData);
+    void VerifyUncheckedEntry(const CacheId* pCacheId) const;
+
+    Util::Result MergeEntry(
+        const PipelineBinaryCache*     pSrcCache,
+        const CacheId*                 pCacheId,
+        PipelineBinaryCacheMergeStats* pStats);
+
+    void RecordQuery(
+        const CacheId* pCacheId,
+        Util::Result   result,
+        size_t         dataSize,
+        bool           loadedIntoMemory,
+        bool           acquiredRef) const;
+
+    void TrackMemoryEntry(const CacheId* pCacheId, size_t dataSize, uint32_t refCount) const;
+    void UntrackMemoryEntry(const CacheId* pCacheId) const;
+    void PinMemoryEntry(const CacheId* pCacheId) const;
+    void UnpinMemoryEntry(const CacheId* pCacheId) const;
+    uint32_t FindMemoryEntry(const CacheId* pCacheId) const;
+    void RemoveMemoryEntry(uint32_t index) const;
+    void EnforceMemoryBudget() const;
+
     Util::ICacheLayer*  GetMemoryLayer() const { return m_pMemoryLayer; }
     Util::IArchiveFile* OpenReadOnlyArchive(const char* path, const char* fileName, size_t bufferSize);
     Util::IArchiveFile* OpenWritableArchive(const char* path, const char* fileName, size_t bufferSize);
@@ -239,6 +366,36 @@ private:
 
     Util::ICacheLayer*        m_pCompressingLayer;
 
+    bool                      m_memoryLayerCompressed;    // Memory layer entries are stored compressed
+
+    // CLOCK replacement state for keeping the memory layer within m_memoryBudget. Entries are tracked with their
+    // uncompressed size; a set referenced flag gives an entry a second chance when the clock hand passes it, and
+    // entries with references acquired through the cache are never evicted.
+    struct MemoryLayerEntry
+    {
+        CacheId  cacheId;
+        size_t   dataSize;
+        uint32_t refCount;
+        bool     referenced;
+    };
+
+    using MemoryEntryVector = Util::Vector<MemoryLayerEntry, 8, PalAllocator>;
+    using MemoryEntryIndex  = Util::HashMap<CacheId, uint32_t, PalAllocator, Util::JenkinsHashFunc>;
+
+    uint64_t                  m_memoryBudget;             // Zero if the memory layer only evicts on its own
+    bool                      m_trackMemoryEntries;       // Set if there is a budget or hits need attribution
+    mutable MemoryEntryVector m_memoryEntries;
+    mutable MemoryEntryIndex  m_memoryEntryIndex;         // Maps a cache ID to its index in m_memoryEntries
+    mutable uint64_t          m_memoryDataSize;
+    mutable uint32_t          m_clockHand;
+    mutable Util::Mutex       m_memoryLruLock;            // Protects the CLOCK replacement state
+
+    // Lookup counters, updated atomically
+    mutable volatile uint64_t m_memoryHits;
+    mutable volatile uint64_t m_archiveHits;
+    mutable volatile uint64_t m_misses;
+    mutable volatile uint64_t m_memoryEvictions;
+
     uint32_t                  m_expectedEntries;
 
     // Archive based cache layers
@@ -248,9 +405,29 @@ private:
     FileVector          m_openFiles;
     LayerVector         m_archiveLayers;
 
+    MappedPipelineArchive* m_pMappedArchive; // Memory-mapped read-only archive, consulted after the layer chain
+
+    bool                     m_archiveWritable;   // One of the archive layers was opened for writing
+    ArchiveWriteBehindQueue* m_pWriteBehindQueue; // Writes stores to the archive layers in the background, if enabled
+
     CacheAdapter*       m_pCacheAdapter;
 
     Util::Mutex         m_entriesMutex;      // Mutex that will be used to get cache state by Query
+
+    // Generation tracking for incremental serialization
+    using CacheIdVector = Util::Vector<CacheId, 8, PalAllocator>;
+    bool                m_trackGenerations;     // Record stored entries in m_insertionLog
+    CacheIdVector       m_insertionLog;         // Cache IDs of the unserialized entries in insertion order
+    uint64_t            m_insertionLogBase;     // Generation of the first entry in m_insertionLog
+    uint64_t            m_serializedGeneration; // First generation not yet written out by SerializeDelta
+    uint64_t            m_snapshotGeneration;   // End of the delta SerializeDelta covers until it is written out
+    Util::Mutex         m_insertionLogLock;     // Protects the insertion log and m_serializedGeneration
+
+    // Initial data entries stored without validation, mapped to the checksum they are verified against on first lookup
+    using UncheckedEntryMap = Util::HashMap<CacheId, uint64_t, PalAllocator, Util::JenkinsHashFunc>;
+    mutable UncheckedEntryMap m_uncheckedEntries;
+    mutable volatile uint32_t m_uncheckedEntryCount;  // Number of entries in m_uncheckedEntries, read without the lock
+    mutable Util::Mutex       m_uncheckedEntriesLock; // Protects m_uncheckedEntries
 };
 
 } // namespace vk
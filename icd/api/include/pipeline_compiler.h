@@ -43,6 +43,7 @@
 #include "include/vk_shader_code.h"
 #include "include/vk_conv.h"
 #include "include/defer_compile_thread.h"
+#include "include/pipeline_compiler_telemetry.h"
 
 namespace vk
 {
@@ -63,6 +64,7 @@ struct UserDataLayout;
 struct PipelineResourceLayout;
 
 class PipelineBinaryCache;
+class ShaderModuleCache;
 
 // =====================================================================================================================
 // The shader stages of Pre-Rasterization Shaders section
@@ -166,7 +168,8 @@ public:
         const Device*                   pDevice,
         const ShaderModuleFlags         flags,
         const Vkgc::BinaryData&         shaderBinary,
-        ShaderModuleHandle*             pShaderModule);
+        ShaderModuleHandle*             pShaderModule,
+        const Pal::ShaderHash*          pCodeHash = nullptr);
 
     bool IsValidShaderModule(
         const ShaderModuleHandle* pShaderModule) const;
@@ -196,6 +199,12 @@ public:
         const VkAllocationCallbacks*      pAllocator,
         Pal::IShaderLibrary**             ppColExpLib);
 
+    void PrewarmColorExportShaderLibraries(
+        const Device*                     pDevice);
+
+    void WaitForColorExportShaderPrewarm(
+        const Device*                     pDevice);
+
     VkResult CreateGraphicsShaderLibrary(
         const Device*                     pDevice,
         const Vkgc::BinaryData            shaderBinary,
@@ -220,6 +229,11 @@ public:
         VkPipelineCreationFeedbackEXT*  pPipelineCreationFeedback,
         const PipelineCreationFeedback* pFeedbackFromCompiler);
 
+    static int64_t RecordPipelineCreationPhase(
+        PipelineCreationFeedback* pPipelineFeedback,
+        PipelineCreationPhase     phase,
+        int64_t                   startTime);
+
     static VkResult SetPipelineCreationFeedbackInfo(
         const VkPipelineCreationFeedbackCreateInfoEXT* pPipelineCreationFeedbackCreateInfo,
         uint32_t                                       stageCount,
@@ -364,6 +378,16 @@ public:
 
     void DestroyPipelineBinaryCache();
 
+    void DumpBinaryCacheStats() const;
+
+    PipelineCompilerTelemetry* GetTelemetry() { return &m_telemetry; }
+
+    void DumpTelemetry();
+
+    void RequestTelemetryDump();
+
+    void RecordPipelineCompile(PipelineTelemetryType type, int64_t compileTime);
+
     void BuildPipelineInternalBufferData(
         const UserDataLayout*             pUserDataLayout,
         bool                              needCache,
@@ -392,6 +416,12 @@ public:
     void ExecuteDeferCompile(
         DeferredCompileWorkload* pWorkload);
 
+    void WaitDeferCompileGroup(DeferCompileTaskGroup* pGroup) { m_deferCompileMgr.RunGroupTasks(pGroup); }
+
+    uint32_t GetDeferCompileThreadCount() const { return m_deferCompileMgr.GetActiveThreadCount(); }
+
+    void GetDeferCompileStats(DeferCompileStats* pStats) const { m_deferCompileMgr.GetStats(pStats); }
+
     Util::Result GetCachedPipelineBinary(
         const Util::MetroHash::Hash* pCacheId,
         const PipelineBinaryCache*   pPipelineBinaryCache,
@@ -544,6 +574,10 @@ private:
         const uint32_t                  compilerMask,
         const Util::MetroHash::Hash&    uniqueHash);
 
+    static void DumpTelemetryTask(void* pPayload);
+
+    void DumpTelemetryIfDue();
+
     template<class VertexInputBinding, class VertexInputAttribute, class VertexInputDivisor>
     uint32_t BuildUberFetchShaderInternalDataImp(
         uint32_t                    vertexBindingDescriptionCount,
@@ -557,12 +591,57 @@ private:
         void*                       pUberFetchShaderInternalData) const;
     // -----------------------------------------------------------------------------------------------------------------
 
-    typedef Util::HashMap<Util::MetroHash::Hash, ShaderModuleHandle, PalAllocator, Util::JenkinsHashFunc>
-        ShaderModuleHandleMap;
+    // A color export shader library and how often pipelines linked it during this run
+    struct ColorExportShaderEntry
+    {
+        Pal::IShaderLibrary* pShaderLibrary;
+        volatile uint32_t    useCount;
+    };
 
-    typedef Util::HashMap<Util::MetroHash::Hash, Pal::IShaderLibrary*, PalAllocator, Util::JenkinsHashFunc>
+    typedef Util::HashMap<Util::MetroHash::Hash, ColorExportShaderEntry, PalAllocator, Util::JenkinsHashFunc>
         ColorExportShaderMap;
 
+    // Header of the list of color export shader cache IDs recorded in the internal pipeline binary cache.  The list
+    // is followed by count cache IDs, most used first.
+    struct ColorExportPrewarmListHeader
+    {
+        uint32_t version;
+        uint32_t count;
+    };
+
+    static constexpr uint32_t ColorExportPrewarmListVersion = 3;
+
+    // Bounds the cache entries an application can accumulate if its set of color export shaders keeps changing
+    static constexpr uint32_t MaxColorExportPrewarmListGenerations = 1024;
+
+    // State shared by the worker threads loading recorded color export shader libraries
+    struct ColorExportPrewarmState
+    {
+        PipelineCompiler*            pCompiler;
+        const Device*                pDevice;
+        const Util::MetroHash::Hash* pCacheIds;
+        uint32_t                     count;
+        volatile uint32_t            nextIndex;
+    };
+
+    static void GetColorExportPrewarmListId(
+        uint32_t               generation,
+        Util::MetroHash::Hash* pListId);
+
+    bool HasColorExportPrewarmList(
+        uint32_t generation) const;
+
+    uint32_t GetColorExportPrewarmListGenerationCount() const;
+
+    static void PrewarmColorExportShaderLibraryTask(
+        void* pPayload);
+
+    void LoadColorExportShaderLibrary(
+        const Device*                pDevice,
+        const Util::MetroHash::Hash& cacheId);
+
+    void StoreColorExportPrewarmList();
+
     PhysicalDevice*    m_pPhysicalDevice;      // Vulkan physical device object
     Vkgc::GfxIpVersion m_gfxIp;                // Graphics IP version info, used by Vkgcf
     DeferCompileManager m_deferCompileMgr;     // Defer compile thread manager
@@ -572,15 +651,30 @@ private:
 
     // Compile statistic metrics
     PipelineCompileCacheMatrix     m_pipelineCacheMatrix;
+    PipelineCompilerTelemetry      m_telemetry;
+    DeferCompileTaskGroup          m_telemetryDumpGroup;      // Periodic telemetry dump queued on a worker thread
+    bool                           m_telemetryDumpGroupReady; // Periodic dumps are only done if the group is set up
+    volatile uint32_t              m_telemetryDumpPending;    // Nonzero while a requested dump is queued or running
+    Util::Mutex                    m_telemetryDumpLock;       // Serializes writing the telemetry file
 
-    Util::Mutex                    m_cacheLock;
+    Util::RWLock                   m_colorExportShaderLock;  // Protects m_colorExportShaderMap
 
     UberFetchShaderFormatInfoMap   m_uberFetchShaderInfoFormatMap;  // Uber fetch shader format info map
 
-    ShaderModuleHandleMap          m_shaderModuleHandleMap;
+    ShaderModuleCache*             m_pShaderModuleCache;     // Runtime shader module cache, owned or instance-wide
+    bool                           m_ownsShaderModuleCache;
 
     ColorExportShaderMap           m_colorExportShaderMap;
 
+    Util::Mutex                    m_colorExportPrewarmLock;  // Serializes starting and waiting for the prewarm
+    ColorExportPrewarmState        m_colorExportPrewarm;      // Prewarm started by the first device, if any
+    DeferCompileTaskGroup          m_colorExportPrewarmGroup; // Worker tasks of the prewarm
+    bool                           m_colorExportPrewarmActive; // Prewarm tasks still to be waited for
+    void*                          m_pColorExportPrewarmList; // Recorded list, owned by the binary cache allocator
+    size_t                         m_colorExportPrewarmListSize;
+    uint32_t                       m_colorExportPrewarmListGenerations; // Generations of the list in the binary cache
+    bool                           m_colorExportPrewarmStarted;
+
 }; // class PipelineCompiler
 
 } // namespce vk
@@ -0,0 +1,116 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_compiler_telemetry.h
+* @brief Declaration of the pipeline compiler telemetry counters.
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/compiler_solution.h"
+#include "include/vk_utils.h"
+
+namespace Util
+{
+class JsonWriter;
+}
+
+namespace vk
+{
+
+class PipelineBinaryCache;
+struct DeferCompileStats;
+
+// Pipeline kinds the compile time of which is tracked separately
+enum class PipelineTelemetryType : uint32_t
+{
+    Graphics = 0,
+    GraphicsLibrary,
+    Compute,
+    RayTracing,
+    Count
+};
+
+// =====================================================================================================================
+// Counters describing how well the pipeline compiler of a device is served by its caches. All counters are updated
+// with atomics so that recording is cheap enough for the pipeline creation path; a snapshot can be written out as JSON
+// at any time.
+class PipelineCompilerTelemetry
+{
+public:
+    // Compile times are bucketed by powers of two: bucket 0 counts compiles below 1us, bucket i compiles taking
+    // [2^(i-1), 2^i) us. The last bucket is open ended.
+    static constexpr uint32_t CompileTimeBucketCount = 28;
+
+    PipelineCompilerTelemetry();
+
+    void RecordPipelineCacheLookup(bool appCacheHit, bool internalCacheHit);
+    void RecordPipelineCompile(PipelineTelemetryType type, int64_t cpuTicks);
+    void RecordPipelineCreation(PipelineTelemetryType type, const PipelineCreationFeedback& feedback);
+    void RecordPipelineStore(size_t dataSize);
+    void RecordShaderModuleLookup(bool hit);
+
+    bool ShouldDump(uint32_t intervalMs);
+
+    void Write(
+        Util::JsonWriter*          pWriter,
+        const PipelineBinaryCache* pBinaryCache,
+        const DeferCompileStats&   deferCompileStats) const;
+
+private:
+    PAL_DISALLOW_COPY_AND_ASSIGN(PipelineCompilerTelemetry);
+
+    struct CompileCounters
+    {
+        volatile uint64_t count;
+        volatile uint64_t totalUs;
+        volatile uint64_t histogram[CompileTimeBucketCount];
+    };
+
+    struct CreationCounters
+    {
+        volatile uint64_t count;
+        volatile uint64_t totalNs;
+        volatile uint64_t phaseNs[PipelineCreationPhaseCount];
+    };
+
+    const int64_t     m_perfFrequency;
+    const int64_t     m_startTime;             // CPU timestamp the counters were created at
+
+    volatile uint64_t m_pipelineLookups;
+    volatile uint64_t m_appCacheHits;          // Lookups served by the application's VkPipelineCache
+    volatile uint64_t m_internalCacheHits;     // Lookups served by the driver's internal cache only
+    volatile uint64_t m_pipelineStores;
+    volatile uint64_t m_pipelineStoredBytes;
+    volatile uint64_t m_shaderModuleLookups;
+    volatile uint64_t m_shaderModuleHits;
+    volatile uint32_t m_lastDumpMs;            // Milliseconds since m_startTime of the last periodic dump
+
+    CompileCounters   m_compiles[static_cast<uint32_t>(PipelineTelemetryType::Count)];
+    CreationCounters  m_creations[static_cast<uint32_t>(PipelineTelemetryType::Count)];
+};
+
+} // namespace vk
@@ -39,6 +39,7 @@
 #include "include/vk_alloccb.h"
 
 #include "palHashMap.h"
+#include "palMutex.h"
 #include "palColorBlendState.h"
 #include "palDepthStencilState.h"
 #include "palMsaaState.h"
@@ -74,6 +75,10 @@ constexpr uint32_t FirstStaticRenderStateToken = DynamicRenderStateToken + 1;
 // Redundancy checking for such state is not tracked by this object -- command buffers are responsible for handling
 // such conditions internally.
 //
+// Each kind of state is guarded by its own reader/writer lock.  Looking up state that is already cached only takes the
+// lock for reading and updates the reference count atomically, so recording threads and pipeline creation only
+// serialize when an entry has to be added or its last reference is dropped.
+//
 // This object is owned by the Vulkan Device.
 class RenderStateCache
 {
@@ -181,6 +186,7 @@ private:
         VkSystemAllocationScope                  parentScope,
         InfoMap*                                 pStateMap,
         RefMap*                                  pRefMap,
+        Util::RWLock*                            pLock,
         typename StateObject::PalObject*         pStates[MaxPalDevices]);
 
     template<class StateObject, typename InfoMap, typename RefMap>
@@ -189,7 +195,8 @@ private:
         typename StateObject::PalObject**  ppStates,
         const VkAllocationCallbacks*       pAllocator,
         InfoMap*                           pInfoMap,
-        RefMap*                            pRefMap);
+        RefMap*                            pRefMap,
+        Util::RWLock*                      pLock);
 
     template<typename StateObject, typename InfoMap, typename RefMap>
     void EraseFromMaps(
@@ -202,6 +209,7 @@ private:
         uint32_t         enabledType,
         const ParamInfo& params,
         ParamHashMap*    pMap,
+        Util::RWLock*    pLock,
         uint32_t*        pNextId);
 
     template<typename ParamInfo, typename ParamHashMap>
@@ -209,7 +217,11 @@ private:
         uint32_t         enabledType,
         const ParamInfo& params,
         uint32_t         token,
-        ParamHashMap*    pMap);
+        ParamHashMap*    pMap,
+        Util::RWLock*    pLock);
+
+    static bool TryAddRef(uint32_t* pRefCount);
+    static bool TryReleaseRef(uint32_t* pRefCount);
 
     bool IsEnabled(uint32_t staticStateFlag) const;
 
@@ -254,7 +266,6 @@ private:
         const VkAllocationCallbacks* pAllocator);
 
     Device* const                                 m_pDevice;
-    Util::Mutex                                   m_mutex;
 
     // These hash tables map static graphics pipeline state to a unique token i.e. a perfect hash.
     Util::HashMap<Pal::InputAssemblyStateParams,
@@ -262,40 +273,47 @@ private:
                   PalAllocator,
                   Util::JenkinsHashFunc>          m_inputAssemblyState;
     uint32_t                                      m_inputAssemblyStateNextId;
+    Util::RWLock                                  m_inputAssemblyStateLock;
 
     Util::HashMap<Pal::TriangleRasterStateParams,
                   StaticParamState,
                   PalAllocator,
                   Util::JenkinsHashFunc>          m_triangleRasterState;
     uint32_t                                      m_triangleRasterStateNextId;
+    Util::RWLock                                  m_triangleRasterStateLock;
 
     Util::HashMap<Pal::PointLineRasterStateParams,
                   StaticParamState,
                   PalAllocator,
                   Util::JenkinsHashFunc>          m_pointLineRasterState;
     uint32_t                                      m_pointLineRasterStateNextId;
+    Util::RWLock                                  m_pointLineRasterStateLock;
 
     Util::HashMap<Pal::LineStippleStateParams,
                   StaticParamState,
                   PalAllocator>                   m_lineStippleState;
     uint32_t                                      m_lineStippleStateNextId;
+    Util::RWLock                                  m_lineStippleStateLock;
 
     Util::HashMap<Pal::DepthBiasParams,
                   StaticParamState,
                   PalAllocator,
                   Util::JenkinsHashFunc>          m_depthBias;
     uint32_t                                      m_depthBiasNextId;
+    Util::RWLock                                  m_depthBiasLock;
 
     Util::HashMap<Pal::BlendConstParams,
                   StaticParamState,
                   PalAllocator,
                   Util::JenkinsHashFunc>          m_blendConst;
     uint32_t                                      m_blendConstNextId;
+    Util::RWLock                                  m_blendConstLock;
 
     Util::HashMap<Pal::DepthBoundsParams,
                   StaticParamState,
                   PalAllocator>                   m_depthBounds;
     uint32_t                                      m_depthBoundsNextId;
+    Util::RWLock                                  m_depthBoundsLock;
 
     static const size_t ViewportHashGroupSize = (sizeof(Pal::ViewportParams) + sizeof(StaticParamState)) * 8;
 
@@ -307,6 +325,7 @@ private:
                   Util::HashAllocator<PalAllocator>,
                   ViewportHashGroupSize>          m_viewport;
     uint32_t                                      m_viewportNextId;
+    Util::RWLock                                  m_viewportLock;
 
     static const size_t ScissorRectHashGroupSize = (sizeof(Pal::ScissorRectParams) + sizeof(StaticParamState)) * 8;
 
@@ -318,6 +337,7 @@ private:
                   Util::HashAllocator<PalAllocator>,
                   ScissorRectHashGroupSize>       m_scissorRect;
     uint32_t                                      m_scissorRectNextId;
+    Util::RWLock                                  m_scissorRectLock;
 
     // These hash tables do the same for certain PAL state objects that are owned by graphics pipelines.  Because
     // they are objects, the pointer address acts as an implicit unique ID.
@@ -332,6 +352,7 @@ private:
     Util::HashMap<Pal::IMsaaState*,
                   StaticMsaaState*,
                   PalAllocator>                      m_msaaRefs;
+    Util::RWLock                                     m_msaaLock;         // Guards m_msaaStates and m_msaaRefs
 
     Util::HashMap<Pal::ColorBlendStateCreateInfo,
         StaticColorBlendState*,
@@ -344,6 +365,7 @@ private:
     Util::HashMap<Pal::IColorBlendState*,
         StaticColorBlendState*,
         PalAllocator>                                 m_colorBlendRefs;
+    Util::RWLock                                      m_colorBlendLock;   // Guards the two color blend maps
 
     Util::HashMap<Pal::DepthStencilStateCreateInfo,
         StaticDepthStencilState*,
@@ -356,6 +378,7 @@ private:
     Util::HashMap<Pal::IDepthStencilState*,
         StaticDepthStencilState*,
         PalAllocator>                                 m_depthStencilRefs;
+    Util::RWLock                                      m_depthStencilLock; // Guards the two depth stencil maps
 
     Util::HashMap<Pal::VrsRateParams,
         StaticParamState,
@@ -365,6 +388,7 @@ private:
         Util::HashAllocator<PalAllocator>,
         1024>                                         m_fragmentShadingRate;
     uint32_t                                          m_fragmentShadingRateNextId;
+    Util::RWLock                                      m_fragmentShadingRateLock;
 };
 
 };
@@ -0,0 +1,108 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  shader_module_cache.h
+* @brief Runtime cache of built shader modules, keyed by module cache hash.
+***********************************************************************************************************************
+*/
+#pragma once
+
+#include "include/compiler_solution.h"
+#include "include/vk_alloccb.h"
+#include "include/vk_utils.h"
+
+#include "palHashMap.h"
+#include "palMetroHash.h"
+#include "palMutex.h"
+
+namespace vk
+{
+
+class Instance;
+
+// =====================================================================================================================
+// Reference counted store of built shader modules. Each PipelineCompiler owns one by default; with
+// EnableInstanceShaderModuleCache set, all compilers of an instance share the instance's store so that identical SPIR-V
+// is only built and kept once across physical devices and their VkDevices.
+//
+// The store holds one reference to every module it contains. Each shard holds a bounded number of modules; when a full
+// shard gets a new one, a module only referenced by the store is released to make room. The entries are striped over
+// independently locked shards, selected by the low bits of the module cache hash, so that concurrent lookups of
+// different modules rarely contend. Reference counts are updated atomically.
+class ShaderModuleCache
+{
+public:
+    static VkResult Create(
+        Instance*           pInstance,
+        uint32_t            maxEntries,
+        ShaderModuleCache** ppCache);
+
+    void Destroy();
+
+    bool Find(
+        const Util::MetroHash::Hash& shaderModuleCacheHash,
+        ShaderModuleHandle*          pShaderModule);
+
+    VkResult Insert(
+        const Util::MetroHash::Hash& shaderModuleCacheHash,
+        ShaderModuleHandle*          pShaderModule);
+
+private:
+    PAL_DISALLOW_COPY_AND_ASSIGN(ShaderModuleCache);
+
+    typedef Util::HashMap<Util::MetroHash::Hash, ShaderModuleHandle, PalAllocator, Util::JenkinsHashFunc>
+        ShaderModuleHandleMap;
+
+    static constexpr uint32_t ShardCount = 16;
+
+    static_assert((ShardCount & (ShardCount - 1)) == 0, "Shard count must be a power of two");
+
+    struct Shard
+    {
+        explicit Shard(PalAllocator* pAllocator) : handleMap(8, pAllocator) { }
+
+        Util::Mutex           lock;      // Protects handleMap
+        ShaderModuleHandleMap handleMap;
+    };
+
+    ShaderModuleCache(Instance* pInstance, uint32_t maxEntries);
+    ~ShaderModuleCache();
+
+    VkResult Init();
+
+    bool EvictUnreferencedModule(Shard* pShard);
+
+    void FreeModule(ShaderModuleHandle* pHandle);
+
+    Shard* GetShard(const Util::MetroHash::Hash& shaderModuleCacheHash)
+        { return &m_shards[shaderModuleCacheHash.dwords[0] & (ShardCount - 1)]; }
+
+    Instance*      m_pInstance;
+    const uint32_t m_maxShardEntries; // Maximum number of modules per shard, 0 for unlimited
+    Shard*         m_shards;          // ShardCount shards, allocated along with this object
+};
+
+} // namespace vk
@@ -0,0 +1,128 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2014-2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  uber_fetch_shader_cache.h
+ * @brief Device-level cache of uber-fetch shader internal data built for dynamic vertex input state.
+ ***********************************************************************************************************************
+ */
+
+#ifndef __UBER_FETCH_SHADER_CACHE_H__
+#define __UBER_FETCH_SHADER_CACHE_H__
+
+#pragma once
+
+#include "include/khronos/vulkan.h"
+#include "include/vk_alloccb.h"
+#include "include/vk_defines.h"
+
+#include "palHashMap.h"
+#include "palMetroHash.h"
+#include "palMutex.h"
+#include "palVector.h"
+
+// Forward declare Vulkan classes used in this file
+namespace vk
+{
+class Device;
+class InternalMemory;
+};
+
+namespace vk
+{
+
+// Internal buffer for dynamic vertex input
+struct DynamicVertexInputInternalData
+{
+    Pal::gpusize gpuAddress[MaxPalDevices];
+};
+
+// =====================================================================================================================
+// Command buffers using VK_EXT_vertex_input_dynamic_state translate each vertex input state into uber-fetch shader
+// internal data.  This cache builds that data once per device and publishes it in GPU memory that lives as long as
+// the device, so command buffers only look up its GPU address instead of building and uploading it as embedded data.
+//
+// Published entries are never modified or freed before the device is destroyed, so the returned pointers stay valid
+// for the lifetime of the device and lookups only take the lock for reading.
+//
+// This object is owned by the Vulkan Device.
+class UberFetchShaderInternalDataCache
+{
+public:
+    UberFetchShaderInternalDataCache(Device* pDevice);
+
+    VkResult Init();
+
+    bool IsEnabled() const
+        { return m_maxMemSize != 0; }
+
+    static void BuildKey(
+        uint32_t                                     vertexBindingDescriptionCount,
+        const VkVertexInputBindingDescription2EXT*   pVertexBindingDescriptions,
+        uint32_t                                     vertexAttributeDescriptionCount,
+        const VkVertexInputAttributeDescription2EXT* pVertexAttributeDescriptions,
+        bool                                         isOffsetMode,
+        Util::MetroHash::Hash*                       pKey);
+
+    const DynamicVertexInputInternalData* GetInternalData(
+        const Util::MetroHash::Hash&                 key,
+        uint32_t                                     vertexBindingDescriptionCount,
+        const VkVertexInputBindingDescription2EXT*   pVertexBindingDescriptions,
+        uint32_t                                     vertexAttributeDescriptionCount,
+        const VkVertexInputAttributeDescription2EXT* pVertexAttributeDescriptions,
+        bool                                         isOffsetMode,
+        bool*                                        pCacheFull);
+
+    void Destroy();
+
+private:
+    PAL_DISALLOW_COPY_AND_ASSIGN(UberFetchShaderInternalDataCache);
+
+    static const uint32_t     NumDataBuckets = 64;
+    static const Pal::gpusize ChunkSize      = 64 * 1024;  // Size of each GPU memory chunk entries are placed in
+
+    Pal::Result AllocChunkSpace(
+        Pal::gpusize     size,
+        InternalMemory** ppChunk,
+        Pal::gpusize*    pOffset);
+
+    Device* const      m_pDevice;
+    const Pal::gpusize m_maxMemSize;     // Upper bound of the GPU memory used by published entries
+    Util::RWLock       m_lock;           // Read for lookups, write for publishing
+
+    Util::HashMap<Util::MetroHash::Hash,
+                  DynamicVertexInputInternalData,
+                  PalAllocator,
+                  Util::JenkinsHashFunc>          m_dataMap;
+
+    Util::Vector<InternalMemory*, 8, PalAllocator> m_chunks;
+    Pal::gpusize                                   m_chunkOffset;  // Next free byte of the last chunk
+    void*                                          m_pTempBuffer;  // CPU staging for building entries
+    bool                                           m_full;         // Publishing failed, guarded by m_lock
+};
+
+} // namespace vk
+
+#endif /* __UBER_FETCH_SHADER_CACHE_H__ */
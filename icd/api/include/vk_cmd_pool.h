@@ -45,6 +45,7 @@
 
 #include "palCmdAllocator.h"
 #include "palHashSet.h"
+#include "palVector.h"
 
 namespace vk
 {
@@ -52,6 +53,15 @@ namespace vk
 class Device;
 class CmdBuffer;
 
+// Counters describing how command buffer allocations from a pool were served
+struct CmdPoolRecycleStats
+{
+    uint64_t allocHits;     // Allocations served by a command buffer from the pool's free lists
+    uint64_t allocMisses;   // Allocations that had to construct a new command buffer
+    uint64_t recycled;      // Freed command buffers kept in the pool's free lists
+    uint64_t trimmed;       // Command buffers destroyed from the free lists by vkTrimCommandPool or pool destruction
+};
+
 // =====================================================================================================================
 // A Vulkan command buffer pool
 class CmdPool final : public NonDispatchable<VkCommandPool, CmdPool>
@@ -83,6 +93,15 @@ public:
 
     void UnregisterCmdBuffer(CmdBuffer* pCmdBuffer);
 
+    CmdBuffer* AcquireRecycledCmdBuffer(bool secondaryLevel);
+
+    bool CanRecycleCmdBuffer(bool secondaryLevel) const
+        { return (GetFreeList(secondaryLevel)->NumElements() < m_maxRecycledCmdBuffers); }
+
+    Pal::Result RecycleCmdBuffer(CmdBuffer* pCmdBuffer);
+
+    const CmdPoolRecycleStats& GetRecycleStats() const { return m_recycleStats; }
+
     uint32_t GetQueueFamilyIndex() const { return m_queueFamilyIndex; }
 
     const VkAllocationCallbacks* GetCmdPoolAllocator() const { return m_pAllocator; }
@@ -108,6 +127,16 @@ private:
 
     VkResult ResetCmdAllocator(bool releaseResources);
 
+    typedef Util::Vector<CmdBuffer*, 8, PalAllocator> CmdBufferFreeList;
+
+    CmdBufferFreeList* GetFreeList(bool secondaryLevel)
+        { return secondaryLevel ? &m_freeSecondaryCmdBuffers : &m_freePrimaryCmdBuffers; }
+
+    const CmdBufferFreeList* GetFreeList(bool secondaryLevel) const
+        { return secondaryLevel ? &m_freeSecondaryCmdBuffers : &m_freePrimaryCmdBuffers; }
+
+    void DestroyRecycledCmdBuffers();
+
     Device*                      m_pDevice;
     Pal::ICmdAllocator*          m_pPalCmdAllocators[MaxPalDevices];
     const VkAllocationCallbacks* m_pAllocator;
@@ -133,6 +162,14 @@ private:
     // in m_cmdBuffersAlreadyBegun during reset as it is more efficient to reset the entire HashSet all at once after
     // all individual command buffer resets of the command buffers in m_cmdBuffersAlreadyBegun are completed.
     bool m_cmdPoolResetInProgress = false;
+
+    // Command buffers freed by the application that are kept fully constructed (including their PAL command buffers)
+    // so that vkAllocateCommandBuffers can hand them out again.  Command pools are externally synchronized, so these
+    // need no locking.
+    const uint32_t      m_maxRecycledCmdBuffers;
+    CmdBufferFreeList   m_freePrimaryCmdBuffers;
+    CmdBufferFreeList   m_freeSecondaryCmdBuffers;
+    CmdPoolRecycleStats m_recycleStats;
 };
 
 namespace entry
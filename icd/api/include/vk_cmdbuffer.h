@@ -135,14 +135,28 @@ union PipelineDynamicBindInfo
     Pal::DynamicGraphicsState       gfxDynState;
 };
 
-// Internal buffer for dynamic vertex input
-struct DynamicVertexInputInternalData
+typedef Util::HashMap<uint64_t, DynamicVertexInputInternalData, PalAllocator, Util::JenkinsHashFunc>
+    UberFetchShaderInternalDataMap;
+
+// Maps from the create info of a dynamic PAL state object to its index in the command buffer's list of referenced
+// objects.  Lets repeated dynamic state skip the device-wide render state cache and its lock.
+typedef Util::HashMap<Pal::DepthStencilStateCreateInfo, uint32_t, PalAllocator, Util::JenkinsHashFunc>
+    DynamicDepthStencilMap;
+typedef Util::HashMap<Pal::ColorBlendStateCreateInfo, uint32_t, PalAllocator, Util::JenkinsHashFunc>
+    DynamicColorBlendMap;
+typedef Util::HashMap<Pal::MsaaStateCreateInfo, uint32_t, PalAllocator, Util::JenkinsHashFunc>
+    DynamicMsaaMap;
+
+// A descriptor set whose user data is known to be current in the set binding data shadow, used to skip redundant
+// rebinds of the same set.
+struct BoundDescriptorSet
 {
-    Pal::gpusize gpuAddress[MaxPalDevices];
+    VkDescriptorSet                   handle;            // Bound descriptor set
+    uint32_t                          setBindingRegBase; // Set binding base register of the layout it was bound with
+    PipelineLayout::SetUserDataLayout userData;          // User data layout of the set in that pipeline layout
 };
 
-typedef Util::HashMap<uint64_t, DynamicVertexInputInternalData, PalAllocator, Util::JenkinsHashFunc>
-    UberFetchShaderInternalDataMap;
+static_assert(MaxDescriptorSets <= 32, "PipelineBindState::boundSetValidMask has one bit per set");
 
 // This structure contains information about currently written user data entries within the command buffer
 struct PipelineBindState
@@ -151,6 +165,9 @@ struct PipelineBindState
     UserDataLayout userDataLayout;
     // High-water mark of the largest number of bound sets
     uint32_t boundSetCount;
+    // Descriptor sets whose user data is current in the set binding data shadow, valid for set indices in the mask
+    BoundDescriptorSet boundSets[MaxDescriptorSets];
+    uint32_t           boundSetValidMask;
     // High-water mark of the largest number of pushed constants
     uint32_t pushedConstCount;
     // Currently pushed constant values (relative to an base = 0)
@@ -163,7 +180,7 @@ struct PipelineBindState
     size_t          pushDescriptorSetMaxSize;
 
     // Internal data of dynamic vertex input
-    DynamicVertexInputInternalData* pVertexInputInternalData;
+    const DynamicVertexInputInternalData* pVertexInputInternalData;
     // Whether dynamic vertex input is enabled in current pipeline
     bool            hasDynamicVertexInput;
 };
@@ -291,7 +308,8 @@ struct AllGpuRenderState
     DynamicRenderingInstance         dynamicRenderingInstance;
 
 // =====================================================================================================================
-// The first part of the structure will be cleared with a memset in CmdBuffer::ResetState().
+// The first part of the structure will be cleared with a memset in CmdBuffer::ResetState().  dynamicRenderingInstance
+// is the last member of this part and is only cleared if it was written since the previous reset.
 // The second part of the structure contains the larger members that are selectively reset in CmdBuffer::ResetState().
 // =====================================================================================================================
     // Keep pipelineState as the first member of the section that is selectively reset.  It is used to compute how large
@@ -1090,6 +1108,8 @@ public:
 
     VkResult Destroy(void);
 
+    VkResult Free(void);
+
     VK_FORCEINLINE Device* VkDevice(void) const
         { return m_pDevice; }
 
@@ -1388,6 +1408,12 @@ public:
     // Get local dispatch call counter
     uint32_t GetDispatchCallCount() const { return m_perCmdBufDispatchCallCounter; }
 
+    // Get local descriptor set bind counter
+    uint32_t GetDescriptorSetBindCount() const { return m_perCmdBufSetBindCounter; }
+
+    // Get local counter of descriptor set binds skipped because the same set was already bound
+    uint32_t GetSkippedDescriptorSetBindCount() const { return m_perCmdBufSkippedSetBindCounter; }
+
     static bool IsStaticStateDifferent(
         uint32_t currentToken,
         uint32_t newToken)
@@ -1582,6 +1608,10 @@ private:
         void*                           pPalMem,
         const Pal::CmdBufferCreateInfo& createInfo);
 
+    void InitializeDefaultState();
+
+    VkResult Reuse();
+
     void SyncIndirectCopy(
         Pal::ICmdBuffer*                pCmdBuffer);
 
@@ -1783,6 +1813,25 @@ private:
         const Pal::PipelineBindPoint                palBindPoint,
         const PipelineBindPoint                     apiBindPoint);
 
+    bool IsDescriptorSetBound(
+        PipelineBindPoint                           apiBindPoint,
+        uint32_t                                    setBindIdx,
+        VkDescriptorSet                             descriptorSet,
+        uint32_t                                    setBindingRegBase,
+        const PipelineLayout::SetUserDataLayout&    setLayoutInfo) const;
+
+    void TrackBoundDescriptorSet(
+        PipelineBindPoint                           apiBindPoint,
+        uint32_t                                    setBindIdx,
+        VkDescriptorSet                             descriptorSet,
+        uint32_t                                    setBindingRegBase,
+        const PipelineLayout::SetUserDataLayout&    setLayoutInfo);
+
+    void InvalidateBoundDescriptorSets(
+        PipelineBindPoint                           apiBindPoint,
+        uint32_t                                    regOffset,
+        uint32_t                                    regCount);
+
     template<uint32_t numPalDevices, bool useCompactDescriptor>
     static VKAPI_ATTR void VKAPI_CALL CmdBindDescriptorSets(
         VkCommandBuffer                             cmdBuffer,
@@ -1889,12 +1938,19 @@ private:
 
     void BindAlternatingThreadGroupConstant();
 
-    DynamicVertexInputInternalData* BuildUberFetchShaderInternalData(
+    const DynamicVertexInputInternalData* BuildUberFetchShaderInternalData(
         uint32_t                                     vertexBindingDescriptionCount,
         const VkVertexInputBindingDescription2EXT*   pVertexBindingDescriptions,
         uint32_t                                     vertexAttributeDescriptionCount,
         const VkVertexInputAttributeDescription2EXT* pVertexAttributeDescriptions);
 
+    bool BuildEmbeddedUberFetchShaderInternalData(
+        uint32_t                                     vertexBindingDescriptionCount,
+        const VkVertexInputBindingDescription2EXT*   pVertexBindingDescriptions,
+        uint32_t                                     vertexAttributeDescriptionCount,
+        const VkVertexInputAttributeDescription2EXT* pVertexAttributeDescriptions,
+        DynamicVertexInputInternalData*              pVertexInputData);
+
 #if VKI_RAY_TRACING
     void BuildAccelerationStructuresPerDevice(
         const uint32_t                                          deviceIndex,
@@ -2033,7 +2089,8 @@ private:
 #endif
             uint32_t offsetMode                          :  1;
             uint32_t protectFlippableImages              :  1;
-            uint32_t reserved                            : 15;
+            uint32_t dynamicRenderingStateDirty          :  1;
+            uint32_t reserved                            : 14;
         };
     };
 
@@ -2067,6 +2124,8 @@ private:
 
     uint32_t                      m_perCmdBufDrawCallCounter;     // Local per command buffer draw call counter
     uint32_t                      m_perCmdBufDispatchCallCounter; // Local per command buffer draw call counter
+    uint32_t                      m_perCmdBufSetBindCounter;        // Local per command buffer descriptor set binds
+    uint32_t                      m_perCmdBufSkippedSetBindCounter; // Descriptor set binds found to be redundant
 
 #if VKI_ENABLE_DEBUG_BARRIERS
     uint64_t                      m_dbgBarrierPreCmdMask;
@@ -2076,12 +2135,16 @@ private:
     Util::Vector<DynamicDepthStencil, 16, PalAllocator> m_palDepthStencilState;
     Util::Vector<DynamicColorBlend, 16, PalAllocator>   m_palColorBlendState;
     Util::Vector<DynamicMsaa, 16, PalAllocator>         m_palMsaaState;
+    DynamicDepthStencilMap                              m_palDepthStencilStateMap;
+    DynamicColorBlendMap                                m_palColorBlendStateMap;
+    DynamicMsaaMap                                      m_palMsaaStateMap;
     Util::Vector<const Image*, 4, PalAllocator>         m_writtenFlippableImages;
 
     UberFetchShaderInternalDataMap m_uberFetchShaderInternalDataMap;// Uber fetch shader internal data cache
     void* m_pUberFetchShaderTempBuffer;
 
     uint32                        m_vbWatermark;  // tracks how many vb entries need to be reset
+    uint32                        m_descBufBindingWatermark; // tracks how many descriptor buffer entries need reset
     DebugPrintf                   m_debugPrintf;
     bool                          m_reverseThreadGroupState;
 #if VKI_RAY_TRACING
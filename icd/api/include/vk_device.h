@@ -49,8 +49,10 @@
 #include "include/app_resource_optimizer.h"
 
 #include "include/internal_mem_mgr.h"
+#include "include/graphics_pipeline_link_cache.h"
 #include "include/log.h"
 #include "include/render_state_cache.h"
+#include "include/uber_fetch_shader_cache.h"
 #include "include/virtual_stack_mgr.h"
 #include "include/barrier_policy.h"
 
@@ -331,6 +333,10 @@ public:
         const VkAllocationCallbacks*                pAllocator,
         VkPipeline*                                 pPipelines);
 
+    uint32_t GetPipelineCreateHelperCount(
+        uint32_t                                    count,
+        const VkAllocationCallbacks*                pAllocator) const;
+
     VkResult CreateSampler(
         const VkSamplerCreateInfo*                  pCreateInfo,
         const VkAllocationCallbacks*                pAllocator,
@@ -646,6 +652,12 @@ public:
     RenderStateCache* GetRenderStateCache()
         { return &m_renderStateCache; }
 
+    GraphicsPipelineLinkCache* GetGplLinkCache()
+        { return &m_gplLinkCache; }
+
+    UberFetchShaderInternalDataCache* GetUberFetchShaderCache()
+        { return &m_uberFetchShaderCache; }
+
     uint32_t GetPinnedSystemMemoryTypes() const;
 
     uint32_t GetPinnedHostMappedForeignMemoryTypes() const;
@@ -948,6 +960,10 @@ protected:
 
     RenderStateCache                    m_renderStateCache;
 
+    GraphicsPipelineLinkCache           m_gplLinkCache;
+
+    UberFetchShaderInternalDataCache    m_uberFetchShaderCache;
+
     ApiQueue*                           m_pQueues[Queue::MaxQueueFamilies][Queue::MaxQueuesPerFamily];
 
     InternalPipeline                    m_timestampQueryCopyPipeline;
@@ -294,6 +294,7 @@ protected:
         const Util::MetroHash::Hash*        pCacheIds,
         uint64_t                            apiPsoHash,
         const PipelineBinaryStorage&        binaryStorage,
+        const uint64_t*                     pFastLinkLibraryHashes,
         GraphicsPipelineObjectCreateInfo*   pObjectCreateInfo,
         VkPipeline*                         pPipeline);
 
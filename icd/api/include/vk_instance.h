@@ -65,6 +65,7 @@ class ApiInstance;
 class DisplayManager;
 class GpuMemoryEventHandler;
 class PhysicalDeviceManager;
+class ShaderModuleCache;
 class VirtualStackMgr;
 class VulkanSettingsLoader;
 
@@ -237,6 +238,8 @@ public:
     GpuMemoryEventHandler* GetGpuMemoryEventHandler() const
         { return m_pGpuMemoryEventHandler; }
 
+    ShaderModuleCache* GetShaderModuleCache(uint32_t maxEntries);
+
     const char* GetApplicationName() const
         { return m_applicationName; }
 
@@ -383,6 +386,10 @@ private:
 
     GpuMemoryEventHandler* m_pGpuMemoryEventHandler; // Handler of Pal GPU memory events for VK_EXT_device_memory_report
                                                      // and VK_EXT_device_address_binding_report extensions
+
+    ShaderModuleCache*     m_pShaderModuleCache;     // Shader module cache shared by all physical devices, created on
+                                                     // first use
+    Util::Mutex            m_shaderModuleCacheMutex; // Serializes creation of m_pShaderModuleCache
 };
 
 // =====================================================================================================================
@@ -0,0 +1,259 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  mapped_pipeline_archive.cpp
+* @brief Implementation of a read-only pipeline binary archive that is accessed through a memory mapping.
+***********************************************************************************************************************
+*/
+
+#include "include/mapped_pipeline_archive.h"
+#include "include/pipeline_binary_cache.h"
+
+#include "palInlineFuncs.h"
+#include "palSysUtil.h"
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+
+namespace vk
+{
+
+// =====================================================================================================================
+// Maps the archive at pFilePath/pFileName. Returns nullptr if the file does not exist, is not a mapped archive or was
+// built for a different platform key, in which case the caller may fall back to other archive formats.
+MappedPipelineArchive* MappedPipelineArchive::Create(
+    PipelineBinaryCache* pPipelineBinaryCache,
+    const char*          pFilePath,
+    const char*          pFileName,
+    uint64_t             platformKey)
+{
+    VK_ASSERT(pPipelineBinaryCache != nullptr);
+    VK_ASSERT(pFileName != nullptr);
+
+    MappedPipelineArchive* pObj = nullptr;
+
+#if defined(__unix__)
+    char fullPath[Util::PathBufferLen] = {};
+
+    if (pFilePath != nullptr)
+    {
+        Util::Snprintf(fullPath, sizeof(fullPath), "%s/%s", pFilePath, pFileName);
+    }
+    else
+    {
+        Util::Strncpy(fullPath, pFileName, sizeof(fullPath));
+    }
+
+    const int fd = open(fullPath, O_RDONLY | O_CLOEXEC);
+
+    if (fd >= 0)
+    {
+        struct stat fileStat = {};
+        void*       pMapped  = MAP_FAILED;
+        size_t      fileSize = 0;
+
+        if ((fstat(fd, &fileStat) == 0) &&
+            (static_cast<size_t>(fileStat.st_size) >= sizeof(MappedPipelineArchiveHeader)))
+        {
+            fileSize = static_cast<size_t>(fileStat.st_size);
+            pMapped  = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+
+        // The mapping stays valid after the descriptor is closed.
+        close(fd);
+
+        if (pMapped != MAP_FAILED)
+        {
+            void*  pMem          = nullptr;
+            size_t slotStateSize = 0;
+
+            if (Validate(pMapped, fileSize, platformKey))
+            {
+                slotStateSize = static_cast<const MappedPipelineArchiveHeader*>(pMapped)->indexSize;
+                pMem          = pPipelineBinaryCache->AllocMem(sizeof(MappedPipelineArchive) + slotStateSize);
+            }
+
+            if (pMem != nullptr)
+            {
+                // Lookups hit the index and the binaries in no particular order, so read-ahead would be wasted.
+                madvise(pMapped, fileSize, MADV_RANDOM);
+
+                void* pSlotStates = Util::VoidPtrInc(pMem, sizeof(MappedPipelineArchive));
+                memset(pSlotStates, SlotUnchecked, slotStateSize);
+
+                pObj = VK_PLACEMENT_NEW(pMem) MappedPipelineArchive(pPipelineBinaryCache,
+                                                                    pMapped,
+                                                                    fileSize,
+                                                                    static_cast<volatile uint8_t*>(pSlotStates));
+            }
+            else
+            {
+                munmap(pMapped, fileSize);
+            }
+        }
+    }
+#endif
+
+    return pObj;
+}
+
+// =====================================================================================================================
+void MappedPipelineArchive::Destroy()
+{
+    PipelineBinaryCache* pCache = m_pPipelineBinaryCache;
+    void*                pMem   = this;
+    Util::Destructor(this);
+    pCache->FreeMem(pMem);
+}
+
+// =====================================================================================================================
+MappedPipelineArchive::MappedPipelineArchive(
+    PipelineBinaryCache* pPipelineBinaryCache,
+    const void*          pMappedData,
+    size_t               mappedSize,
+    volatile uint8_t*    pSlotStates)
+    :
+    m_pPipelineBinaryCache { pPipelineBinaryCache },
+    m_pMappedData          { pMappedData },
+    m_mappedSize           { mappedSize },
+    m_pHeader              { static_cast<const MappedPipelineArchiveHeader*>(pMappedData) },
+    m_pIndex               { static_cast<const MappedPipelineArchiveIndexEntry*>(
+                                 Util::VoidPtrInc(pMappedData, sizeof(MappedPipelineArchiveHeader))) },
+    m_pSlotStates          { pSlotStates }
+{
+}
+
+// =====================================================================================================================
+MappedPipelineArchive::~MappedPipelineArchive()
+{
+#if defined(__unix__)
+    munmap(const_cast<void*>(m_pMappedData), m_mappedSize);
+#endif
+}
+
+// =====================================================================================================================
+// Checks the header of a freshly mapped archive. Individual index entries are bounds checked on lookup instead, so that
+// opening an archive does not fault in the whole index.
+bool MappedPipelineArchive::Validate(
+    const void* pMappedData,
+    size_t      mappedSize,
+    uint64_t    platformKey)
+{
+    const MappedPipelineArchiveHeader* pHeader = static_cast<const MappedPipelineArchiveHeader*>(pMappedData);
+
+    return (pHeader->magic       == MappedPipelineArchiveMagic)   &&
+           (pHeader->version     == MappedPipelineArchiveVersion) &&
+           (pHeader->platformKey == platformKey)                  &&
+           (pHeader->fileSize    == mappedSize)                   &&
+           (pHeader->indexSize   != 0)                            &&
+           Util::IsPowerOfTwo(pHeader->indexSize)                 &&
+           (pHeader->entryCount  <  pHeader->indexSize)           &&
+           ((sizeof(MappedPipelineArchiveHeader) +
+             (sizeof(MappedPipelineArchiveIndexEntry) * uint64_t(pHeader->indexSize))) <= mappedSize);
+}
+
+// =====================================================================================================================
+// Looks up a binary by cache ID. On success, ppData points directly into the mapping and stays valid for the lifetime
+// of this object. The binary is checked against its checksum on the first lookup only; threads racing on the first
+// lookup may both check it, which is harmless.
+bool MappedPipelineArchive::Find(
+    const Util::MetroHash::Hash* pCacheId,
+    const void**                 ppData,
+    size_t*                      pDataSize) const
+{
+    VK_ASSERT(pCacheId != nullptr);
+    VK_ASSERT(ppData != nullptr);
+    VK_ASSERT(pDataSize != nullptr);
+
+    const uint32_t indexSize = m_pHeader->indexSize;
+    const uint64_t dataStart = sizeof(MappedPipelineArchiveHeader) +
+                               (sizeof(MappedPipelineArchiveIndexEntry) * uint64_t(indexSize));
+
+    uint32_t slot  = GetMappedPipelineArchiveSlot(*pCacheId, indexSize);
+    bool     found = false;
+
+    // The index is never full, so the probe sequence always ends at an empty slot.
+    for (uint32_t probe = 0; probe < indexSize; ++probe)
+    {
+        const MappedPipelineArchiveIndexEntry& entry = m_pIndex[slot];
+
+        if (entry.dataOffset == 0)
+        {
+            break;
+        }
+
+        if (memcmp(&entry.hashId, pCacheId, sizeof(entry.hashId)) == 0)
+        {
+            uint8_t state = m_pSlotStates[slot];
+
+            if (state == SlotUnchecked)
+            {
+                state = SlotCorrupted;
+
+                if ((entry.dataOffset >= dataStart)                   &&
+                    (entry.dataSize   <= m_mappedSize)                &&
+                    (entry.dataOffset <= (m_mappedSize - entry.dataSize)))
+                {
+                    const void*  pData    = Util::VoidPtrInc(m_pMappedData, static_cast<size_t>(entry.dataOffset));
+                    const size_t dataSize = static_cast<size_t>(entry.dataSize);
+
+                    if ((entry.checksum == 0) || (entry.checksum == CalculateBinaryCacheEntryChecksum(pData, dataSize)))
+                    {
+                        state = SlotValid;
+                    }
+                }
+
+                if (state == SlotCorrupted)
+                {
+                    VK_ALERT_ALWAYS_MSG("Corrupted entry in mapped pipeline archive");
+                }
+
+                m_pSlotStates[slot] = state;
+            }
+
+            if (state == SlotValid)
+            {
+                *ppData    = Util::VoidPtrInc(m_pMappedData, static_cast<size_t>(entry.dataOffset));
+                *pDataSize = static_cast<size_t>(entry.dataSize);
+                found      = true;
+            }
+
+            break;
+        }
+
+        slot = (slot + 1) & (indexSize - 1);
+    }
+
+    return found;
+}
+
+} // namespace vk
@@ -29,15 +29,19 @@
 ***********************************************************************************************************************
 */
 #include "include/pipeline_binary_cache.h"
+#include "include/archive_write_behind_queue.h"
 #include "include/binary_cache_serialization.h"
+#include "include/mapped_pipeline_archive.h"
 
 #include "palArchiveFile.h"
 #include "palAutoBuffer.h"
 #include "palPlatformKey.h"
 #include "palSysMemory.h"
+#include "palSysUtil.h"
 #include "palVectorImpl.h"
 #include "palHashMapImpl.h"
 #include "palFile.h"
+#include "palJsonWriter.h"
 #include "palLiterals.h"
 #include "palPipelineAbiReader.h"
 #include "devmode/devmode_mgr.h"
@@ -132,15 +136,31 @@ PipelineBinaryCache* PipelineBinaryCache::Create(
         {
             // The pipeline binary cache data format is as follows:
             // ```
-            // | Public Header | Private Header (20B) | BinaryCacheEntry (24B) | Blob (n) | BinaryCacheEntry (24B) | ...
+            // | Public Header | Private Header (20B) | BinaryCacheEntry (32B) | Blob (n) | BinaryCacheEntry (32B) | ...
             // ```
             //
+            // With lazy validation the blob digest has not been checked, so each entry is checked against its own
+            // checksum instead the first time it is looked up.  Until then it is kept out of the archive layers.
+            const bool lazyValidation   = settings.pipelineCacheLazyValidation &&
+                                          (pObj->m_uncheckedEntries.Init() == Util::Result::Success);
             const void* pBlob           = pInitData;
             size_t   blobSize           = initDataSize;
             constexpr size_t EntrySize  = sizeof(BinaryCacheEntry);
 
             pBlob         = Util::VoidPtrInc(pBlob, sizeof(PipelineBinaryCachePrivateHeader));
             blobSize     -= sizeof(PipelineBinaryCachePrivateHeader);
+
+            // Delta chunks carry an extra header between the private header and the first entry:
+            // ```
+            // | Public Header | Private Header (20B) | Delta Header (24B) | BinaryCacheEntry (32B) | Blob (n) | ...
+            // ```
+            PipelineBinaryCacheDeltaHeader deltaHeader;
+            if (ReadPipelineBinaryCacheDeltaHeader(pBlob, blobSize, &deltaHeader))
+            {
+                pBlob     = Util::VoidPtrInc(pBlob, sizeof(PipelineBinaryCacheDeltaHeader));
+                blobSize -= sizeof(PipelineBinaryCacheDeltaHeader);
+            }
+
             while (blobSize > EntrySize)
             {
                 // `BinaryCacheEntry` headers require the alignment of 8 bytes, which is not guaranteed with this data
@@ -153,11 +173,24 @@ PipelineBinaryCache* PipelineBinaryCache::Create(
 
                 if (blobSize >= entryAndDataSize)
                 {
-                    //add to cache
-                    Util::Result result = pObj->StorePipelineBinary(&entry.hashId, entry.dataSize, pData);
-                    if (result != Util::Result::Success)
+                    // Entries without a checksum are dropped right away.  If the map of unchecked entries could not be
+                    // set up, the checksum is verified now.
+                    if ((settings.pipelineCacheLazyValidation == false) ||
+                        (lazyValidation && (entry.checksum != 0)) ||
+                        IsValidBinaryCacheEntry(entry, pData, false))
+                    {
+                        //add to cache
+                        Util::Result result = lazyValidation ?
+                            pObj->StoreUncheckedEntry(entry, pData) :
+                            pObj->StorePipelineBinary(&entry.hashId, entry.dataSize, pData);
+                        if (result != Util::Result::Success)
+                        {
+                            break;
+                        }
+                    }
+                    else
                     {
-                        break;
+                        VK_ALERT_ALWAYS_MSG("Dropping corrupted pipeline cache entry");
                     }
                     pBlob = Util::VoidPtrInc(pBlob, entryAndDataSize);
                     blobSize -= entryAndDataSize;
@@ -187,11 +220,32 @@ PipelineBinaryCache::PipelineBinaryCache(
     m_hashMapping          { 32, &m_palAllocator },
     m_pMemoryLayer         { nullptr },
     m_pCompressingLayer    { nullptr },
+    m_memoryLayerCompressed{ false },
+    m_memoryBudget         { 0 },
+    m_trackMemoryEntries   { false },
+    m_memoryEntries        { &m_palAllocator },
+    m_memoryEntryIndex     { 256, &m_palAllocator },
+    m_memoryDataSize       { 0 },
+    m_clockHand            { 0 },
+    m_memoryHits           { 0 },
+    m_archiveHits          { 0 },
+    m_misses               { 0 },
+    m_memoryEvictions      { 0 },
     m_expectedEntries      { expectedEntries },
     m_pArchiveLayer        { nullptr },
     m_openFiles            { &m_palAllocator },
     m_archiveLayers        { &m_palAllocator },
-    m_pCacheAdapter        { nullptr }
+    m_pMappedArchive       { nullptr },
+    m_archiveWritable      { false },
+    m_pWriteBehindQueue    { nullptr },
+    m_pCacheAdapter        { nullptr },
+    m_trackGenerations     { false },
+    m_insertionLog         { &m_palAllocator },
+    m_insertionLogBase     { 0 },
+    m_serializedGeneration { 0 },
+    m_snapshotGeneration   { 0 },
+    m_uncheckedEntries     { 32, &m_palAllocator },
+    m_uncheckedEntryCount  { 0 }
 {
     // Without copy constructor, a class type variable can't be initialized in initialization list with gcc 4.8.5.
     // Initialize m_gfxIp here instead to make gcc 4.8.5 work.
@@ -201,6 +255,13 @@ PipelineBinaryCache::PipelineBinaryCache(
 // =====================================================================================================================
 PipelineBinaryCache::~PipelineBinaryCache()
 {
+    // Flush any queued archive writes while the layers are still alive.
+    if (m_pWriteBehindQueue != nullptr)
+    {
+        m_pWriteBehindQueue->Destroy();
+        m_pWriteBehindQueue = nullptr;
+    }
+
     if (m_pCacheAdapter != nullptr)
     {
         m_pCacheAdapter->Destroy();
@@ -223,6 +284,12 @@ PipelineBinaryCache::~PipelineBinaryCache()
 
     m_archiveLayers.Clear();
 
+    if (m_pMappedArchive != nullptr)
+    {
+        m_pMappedArchive->Destroy();
+        m_pMappedArchive = nullptr;
+    }
+
     if (m_pMemoryLayer != nullptr)
     {
         m_pMemoryLayer->Destroy();
@@ -276,16 +343,106 @@ Util::Result PipelineBinaryCache::QueryPipelineBinary(
 {
     VK_ASSERT(m_pTopLayer != nullptr);
 
+    VerifyUncheckedEntry(pCacheId);
+
     uint32_t policy = Util::ICacheLayer::LinkPolicy::LoadOnQuery;
     // We have to make sure the Query is atomic, otherwise we could get unexpected result while running multi-thread
     // test case.
     m_entriesMutex.Lock();
+
     Util::Result result = m_pTopLayer->Query(pCacheId, policy, flags, pQuery);
+
+    if ((result == Util::Result::NotFound) && (m_pMappedArchive != nullptr) && PromoteMappedEntry(pCacheId))
+    {
+        result = m_pTopLayer->Query(pCacheId, policy, flags, pQuery);
+    }
     m_entriesMutex.Unlock();
 
+    RecordQuery(pCacheId, result, pQuery->dataSize, true,
+                (flags & Util::ICacheLayer::QueryFlags::AcquireEntryRef) != 0);
+
     return result;
 }
 
+// =====================================================================================================================
+// Copies an entry of the mapped archive into the layer chain after the chain missed it, so that callers can reference
+// it through the regular QueryResult based interfaces. Returns true if the mapped archive had the entry. Must be called
+// with m_entriesMutex held.
+bool PipelineBinaryCache::PromoteMappedEntry(
+    const CacheId* pCacheId)
+{
+    const void* pData    = nullptr;
+    size_t      dataSize = 0;
+
+    const bool found = m_pMappedArchive->Find(pCacheId, &pData, &dataSize);
+
+    if (found)
+    {
+        // The entry already lives on disk, so keep it out of any writable archive.
+        Util::StoreFlags storeFlags  = {};
+        storeFlags.enableFileCache   = false;
+        storeFlags.enableCompression = true;
+
+        m_pTopLayer->Store(storeFlags, pCacheId, pData, dataSize);
+    }
+
+    return found;
+}
+
+// =====================================================================================================================
+// Updates the lookup counters for a query submitted to the top layer. A hit on an entry that is not tracked by the
+// memory layer's replacement state was answered by an archive; if the query policy copied it into the memory layer,
+// it is tracked from now on. A reference acquired by the query pins the entry until ReleaseCacheRef().
+//
+// Without archive layers or a memory budget nothing is tracked, as every hit is a memory layer hit.
+void PipelineBinaryCache::RecordQuery(
+    const CacheId* pCacheId,
+    Util::Result   result,
+    size_t         dataSize,
+    bool           loadedIntoMemory,
+    bool           acquiredRef) const
+{
+    if (m_pMemoryLayer != nullptr)
+    {
+        if (result == Util::Result::Success)
+        {
+            bool memoryHit = (m_trackMemoryEntries == false);
+
+            if (m_trackMemoryEntries)
+            {
+                Util::MutexAuto lock(&m_memoryLruLock);
+
+                const uint32_t index = FindMemoryEntry(pCacheId);
+
+                if (index != UINT32_MAX)
+                {
+                    m_memoryEntries[index].referenced = true;
+                    m_memoryEntries[index].refCount  += acquiredRef ? 1 : 0;
+                    memoryHit = true;
+                }
+            }
+
+            if (memoryHit)
+            {
+                Util::AtomicIncrement64(&m_memoryHits);
+            }
+            else
+            {
+                Util::AtomicIncrement64(&m_archiveHits);
+            }
+
+            if ((memoryHit == false) && loadedIntoMemory)
+            {
+                TrackMemoryEntry(pCacheId, dataSize, acquiredRef ? 1 : 0);
+            }
+        }
+        else if ((result == Util::Result::NotFound) || (result == Util::Result::Reserved))
+        {
+            Util::AtomicIncrement64(&m_misses);
+        }
+    }
+}
+
 // =====================================================================================================================
 // Query if a pipeline binary exists in cache
 // Must call ReleaseCacheRef() when the flags contains AcquireEntryRef
@@ -305,9 +462,13 @@ Util::Result PipelineBinaryCache::LoadPipelineBinary(
 {
     VK_ASSERT(m_pTopLayer != nullptr);
 
+    VerifyUncheckedEntry(pCacheId);
+
     Util::QueryResult query  = {};
     Util::Result      result = m_pTopLayer->Query(pCacheId, 0, 0, &query);
 
+    RecordQuery(pCacheId, result, query.dataSize, false, false);
+
     if (result == Util::Result::Success)
     {
         void* pOutputMem = AllocMem(query.dataSize);
@@ -326,6 +487,29 @@ Util::Result PipelineBinaryCache::LoadPipelineBinary(
             }
         }
     }
+    else if ((result == Util::Result::NotFound) && (m_pMappedArchive != nullptr))
+    {
+        const void* pData    = nullptr;
+        size_t      dataSize = 0;
+
+        if (m_pMappedArchive->Find(pCacheId, &pData, &dataSize))
+        {
+            void* pOutputMem = AllocMem(dataSize);
+
+            if (pOutputMem != nullptr)
+            {
+                memcpy(pOutputMem, pData, dataSize);
+
+                *pPipelineBinarySize = dataSize;
+                *ppPipelineBinary    = pOutputMem;
+                result               = Util::Result::Success;
+            }
+            else
+            {
+                result = Util::Result::ErrorOutOfMemory;
+            }
+        }
+    }
 
     return result;
 }
@@ -343,7 +527,136 @@ Util::Result PipelineBinaryCache::StorePipelineBinary(
     storeFlags.enableFileCache   = true;
     storeFlags.enableCompression = true;
 
-    return m_pTopLayer->Store(storeFlags, pCacheId, pPipelineBinary, pipelineBinarySize);
+    if (m_pWriteBehindQueue != nullptr)
+    {
+        // The archive layers are written by the flush thread, which also takes care of on-disk compression.
+        storeFlags.enableFileCache   = false;
+        storeFlags.enableCompression = false;
+    }
+
+    Util::Result result = m_pTopLayer->Store(storeFlags, pCacheId, pPipelineBinary, pipelineBinarySize);
+
+    if ((result == Util::Result::Success) && (m_pWriteBehindQueue != nullptr))
+    {
+        // A failed archive write only costs a recompile in a later run, so it is not reported to the caller.
+        Util::Result writeResult = m_pWriteBehindQueue->Store(pCacheId, pPipelineBinary, pipelineBinarySize);
+        VK_ALERT(writeResult != Util::Result::Success);
+    }
+
+    if ((result == Util::Result::Success) && (m_pMemoryLayer != nullptr))
+    {
+        TrackMemoryEntry(pCacheId, pipelineBinarySize, 0);
+    }
+
+    if ((result == Util::Result::Success) && m_trackGenerations)
+    {
+        Util::MutexAuto lock(&m_insertionLogLock);
+
+        // The entry's generation is m_insertionLogBase plus its position in the log.
+        m_insertionLog.PushBack(*pCacheId);
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Stores an entry of the initial data whose checksum has not been verified yet.  The entry only goes into the memory
+// layer and is verified by VerifyUncheckedEntry() the first time it is looked up.
+Util::Result PipelineBinaryCache::StoreUncheckedEntry(
+    const BinaryCacheEntry& entry,
+    const void*             pData)
+{
+    VK_ASSERT(m_pTopLayer != nullptr);
+    VK_ASSERT(entry.checksum != 0);
+
+    Util::StoreFlags storeFlags  = {};
+    storeFlags.enableFileCache   = false;
+    storeFlags.enableCompression = true;
+
+    Util::Result result = m_pTopLayer->Store(storeFlags, &entry.hashId, pData, entry.dataSize);
+
+    if (result == Util::Result::Success)
+    {
+        {
+            Util::MutexAuto lock(&m_uncheckedEntriesLock);
+
+            result = m_uncheckedEntries.Insert(entry.hashId, entry.checksum);
+        }
+
+        if (result == Util::Result::Success)
+        {
+            Util::AtomicIncrement(&m_uncheckedEntryCount);
+
+            if (m_pMemoryLayer != nullptr)
+            {
+                TrackMemoryEntry(&entry.hashId, entry.dataSize, 0);
+            }
+        }
+        else
+        {
+            // An entry that cannot be verified later must not stay in the cache.
+            m_pTopLayer->Evict(&entry.hashId);
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Verifies an entry stored by StoreUncheckedEntry() against its checksum if it has not been looked up before.  A
+// corrupted entry is evicted, so the lookup that follows misses.
+void PipelineBinaryCache::VerifyUncheckedEntry(
+    const CacheId* pCacheId) const
+{
+    if (m_uncheckedEntryCount > 0)
+    {
+        Util::MutexAuto lock(&m_uncheckedEntriesLock);
+
+        const uint64_t* pChecksum = m_uncheckedEntries.FindKey(*pCacheId);
+
+        if (pChecksum != nullptr)
+        {
+            BinaryCacheEntry entry = {};
+            entry.hashId   = *pCacheId;
+            entry.checksum = *pChecksum;
+
+            Util::QueryResult query  = {};
+            void*             pData  = nullptr;
+            Util::Result      result = m_pTopLayer->Query(pCacheId, 0, 0, &query);
+
+            if (result == Util::Result::Success)
+            {
+                pData  = AllocMem(query.dataSize);
+                result = (pData != nullptr) ? m_pTopLayer->Load(&query, pData) : Util::Result::ErrorOutOfMemory;
+            }
+
+            if (result == Util::Result::Success)
+            {
+                entry.dataSize = query.dataSize;
+
+                if (IsValidBinaryCacheEntry(entry, pData, false) == false)
+                {
+                    VK_ALERT_ALWAYS_MSG("Dropping corrupted pipeline cache entry");
+
+                    if (m_pMemoryLayer != nullptr)
+                    {
+                        UntrackMemoryEntry(pCacheId);
+                    }
+
+                    m_pTopLayer->Evict(pCacheId);
+                }
+            }
+
+            FreeMem(pData);
+
+            // Out of memory leaves the entry unchecked for the next lookup; an entry that is gone needs no check.
+            if (result != Util::Result::ErrorOutOfMemory)
+            {
+                m_uncheckedEntries.Erase(*pCacheId);
+                Util::AtomicDecrement(&m_uncheckedEntryCount);
+            }
+        }
+    }
 }
 
 // =====================================================================================================================
@@ -351,6 +664,12 @@ Util::Result PipelineBinaryCache::ReleaseCacheRef(
     const Util::QueryResult* pQuery) const
 {
     VK_ASSERT(m_pTopLayer != nullptr);
+
+    if (m_pMemoryLayer != nullptr)
+    {
+        UnpinMemoryEntry(&pQuery->hashId);
+    }
+
     return m_pTopLayer->ReleaseCacheRef(pQuery);
 }
 
@@ -369,6 +688,11 @@ Util::Result PipelineBinaryCache::EvictEntry(
 {
     VK_ASSERT(m_pTopLayer != nullptr);
 
+    if (m_pMemoryLayer != nullptr)
+    {
+        UntrackMemoryEntry(&pQuery->hashId);
+    }
+
     return m_pTopLayer->Evict(&pQuery->hashId);
 }
 
@@ -378,6 +702,11 @@ Util::Result PipelineBinaryCache::MarkEntryBad(
 {
     VK_ASSERT(m_pTopLayer != nullptr);
 
+    if (m_pMemoryLayer != nullptr)
+    {
+        UntrackMemoryEntry(&pQuery->hashId);
+    }
+
     return m_pTopLayer->MarkEntryBad(&pQuery->hashId);
 }
 
@@ -392,126 +721,401 @@ Util::Result PipelineBinaryCache::GetPipelineBinary(
 }
 
 // =====================================================================================================================
-// Introduces a mapping from an internal pipeline hash to a cache ID
-void PipelineBinaryCache::RegisterHashMapping(
-    const Pal::PipelineHash* pInternalPipelineHash,
-    const CacheId*           pCacheId)
+// Returns the index of the tracked memory layer entry with the given cache ID, or UINT32_MAX if it is not tracked.
+// Must be called with m_memoryLruLock held.
+uint32_t PipelineBinaryCache::FindMemoryEntry(
+    const CacheId* pCacheId) const
 {
-    VK_ASSERT(pInternalPipelineHash != nullptr);
-    VK_ASSERT(pCacheId              != nullptr);
-
-    if (m_pReinjectionLayer != nullptr)
-    {
-        Util::RWLockAuto<Util::RWLock::LockType::ReadWrite> readWriteLock(&m_hashMappingLock);
+    const uint32_t* pIndex = m_memoryEntryIndex.FindKey(*pCacheId);
 
-        m_hashMapping.Insert(*pInternalPipelineHash, *pCacheId);
-    }
+    return (pIndex != nullptr) ? *pIndex : UINT32_MAX;
 }
 
 // =====================================================================================================================
-// Retrieves the cache ID that maps to the given internal pipeline hash, pCacheId is unchanged if no mapping found
-PipelineBinaryCache::CacheId* PipelineBinaryCache::GetCacheIdForPipeline(
-    const Pal::PipelineHash* pInternalPipelineHash)
+// Starts tracking an entry stored in the memory layer, or updates its size if it is already tracked, and evicts
+// entries until the memory layer is back within its budget, if it has one.
+void PipelineBinaryCache::TrackMemoryEntry(
+    const CacheId* pCacheId,
+    size_t         dataSize,
+    uint32_t       refCount) const
 {
-    VK_ASSERT(pInternalPipelineHash != nullptr);
-
-    CacheId* pCacheId = nullptr;
-
-    if (m_pReinjectionLayer != nullptr)
+    if (m_trackMemoryEntries)
     {
-        Util::RWLockAuto<Util::RWLock::LockType::ReadOnly> readWriteLock(&m_hashMappingLock);
-
-        pCacheId = m_hashMapping.FindKey(*pInternalPipelineHash);
-    }
-
-    return pCacheId;
-}
+        Util::MutexAuto lock(&m_memoryLruLock);
 
-// =====================================================================================================================
-// Attempt to load a binary from the reinjection cache layer
-Util::Result PipelineBinaryCache::LoadReinjectionBinary(
-    const CacheId* pInternalPipelineHash,
-    size_t*        pPipelineBinarySize,
-    const void**   ppPipelineBinary)
-{
-    Util::Result result = Util::Result::ErrorUnavailable;
+        const uint32_t index = FindMemoryEntry(pCacheId);
 
-    if (m_pReinjectionLayer != nullptr)
-    {
-        Util::QueryResult query = {};
-        result = m_pReinjectionLayer->Query(pInternalPipelineHash, 0, 0, &query);
+        if (index != UINT32_MAX)
+        {
+            MemoryLayerEntry& entry = m_memoryEntries[index];
 
-        if (result == Util::Result::Success)
+            m_memoryDataSize = m_memoryDataSize - entry.dataSize + dataSize;
+            entry.dataSize   = dataSize;
+            entry.referenced = true;
+            entry.refCount  += refCount;
+        }
+        else
         {
-            void* pOutputMem = AllocMem(query.dataSize);
+            bool      existed = false;
+            uint32_t* pIndex  = nullptr;
 
-            if (pOutputMem != nullptr)
+            if ((m_memoryEntryIndex.FindAllocate(*pCacheId, &existed, &pIndex) == Util::Result::Success) &&
+                (existed == false))
             {
-                result = m_pReinjectionLayer->Load(&query, pOutputMem);
+                const MemoryLayerEntry entry = { *pCacheId, dataSize, refCount, true };
 
-                if (result == Util::Result::Success)
+                if (m_memoryEntries.PushBack(entry) == Util::Result::Success)
                 {
-                    *pPipelineBinarySize = query.dataSize;
-                    *ppPipelineBinary = pOutputMem;
+                    *pIndex           = m_memoryEntries.NumElements() - 1;
+                    m_memoryDataSize += dataSize;
                 }
                 else
                 {
-                    FreeMem(pOutputMem);
+                    m_memoryEntryIndex.Erase(*pCacheId);
                 }
             }
         }
-    }
 
-    return result;
+        if (m_memoryBudget > 0)
+        {
+            EnforceMemoryBudget();
+        }
+    }
 }
 
 // =====================================================================================================================
-// Attempt to store a binary into the reinjection cache layer
-Util::Result PipelineBinaryCache::StoreReinjectionBinary(
-    const CacheId*  pInternalPipelineHash,
-    size_t          pipelineBinarySize,
-    const void*     pPipelineBinary)
+// Stops tracking an entry that is about to be removed from the memory layer by other means.
+void PipelineBinaryCache::UntrackMemoryEntry(
+    const CacheId* pCacheId) const
 {
-    Util::Result result = Util::Result::ErrorUnavailable;
-
-    if (m_pReinjectionLayer != nullptr)
+    if (m_trackMemoryEntries)
     {
-        uint32_t gfxIpMajor = 0u;
-        uint32_t gfxIpMinor = 0u;
-        uint32_t gfxIpStepping = 0u;
+        Util::MutexAuto lock(&m_memoryLruLock);
 
-        Util::Abi::PipelineAbiReader reader(&m_palAllocator,
-                                            Util::Span<const void>{ pPipelineBinary, pipelineBinarySize});
-        reader.GetGfxIpVersion(&gfxIpMajor, &gfxIpMinor, &gfxIpStepping);
+        const uint32_t index = FindMemoryEntry(pCacheId);
 
-        if (gfxIpMajor == m_gfxIp.major &&
-            gfxIpMinor == m_gfxIp.minor &&
-            gfxIpStepping == m_gfxIp.stepping)
-        {
-            Util::StoreFlags storeFlags  = {};
-            storeFlags.enableFileCache   = true;
-            storeFlags.enableCompression = true;
-            result = m_pReinjectionLayer->Store(storeFlags, pInternalPipelineHash, pPipelineBinary, pipelineBinarySize);
-        }
-        else
+        if (index != UINT32_MAX)
         {
-            result = Util::Result::ErrorIncompatibleDevice;
+            RemoveMemoryEntry(index);
         }
     }
-
-    return result;
 }
 
 // =====================================================================================================================
-// Free memory allocated by our allocator
-void PipelineBinaryCache::FreePipelineBinary(
-    const void* pPipelineBinary)
+// Keeps a tracked entry from being evicted while a reference to it is held outside of QueryPipelineBinary().
+void PipelineBinaryCache::PinMemoryEntry(
+    const CacheId* pCacheId) const
 {
-    FreeMem(const_cast<void*>(pPipelineBinary));
-}
+    if (m_trackMemoryEntries)
+    {
+        Util::MutexAuto lock(&m_memoryLruLock);
 
-// =====================================================================================================================
-// Destroy PipelineBinaryCache itself
+        const uint32_t index = FindMemoryEntry(pCacheId);
+
+        if (index != UINT32_MAX)
+        {
+            m_memoryEntries[index].refCount++;
+        }
+    }
+}
+
+// =====================================================================================================================
+// Drops a pin taken by PinMemoryEntry() or by a query acquiring an entry reference.
+void PipelineBinaryCache::UnpinMemoryEntry(
+    const CacheId* pCacheId) const
+{
+    if (m_trackMemoryEntries)
+    {
+        Util::MutexAuto lock(&m_memoryLruLock);
+
+        const uint32_t index = FindMemoryEntry(pCacheId);
+
+        // Entries reserved on a miss are only tracked once they are stored, so their reference was never counted.
+        if ((index != UINT32_MAX) && (m_memoryEntries[index].refCount > 0))
+        {
+            m_memoryEntries[index].refCount--;
+        }
+    }
+}
+
+// =====================================================================================================================
+// Removes a tracked entry by moving the last entry into its place. Must be called with m_memoryLruLock held.
+void PipelineBinaryCache::RemoveMemoryEntry(
+    uint32_t index) const
+{
+    m_memoryDataSize -= m_memoryEntries[index].dataSize;
+    m_memoryEntryIndex.Erase(m_memoryEntries[index].cacheId);
+
+    MemoryLayerEntry last = {};
+    m_memoryEntries.PopBack(&last);
+
+    if (index < m_memoryEntries.NumElements())
+    {
+        m_memoryEntries[index] = last;
+        *m_memoryEntryIndex.FindKey(last.cacheId) = index;
+    }
+}
+
+// =====================================================================================================================
+// Runs the clock hand over the tracked entries and evicts unreferenced ones from the memory layer until the tracked
+// size fits the budget. Pinned entries and entries that cannot be evicted right now are skipped, and the sweep gives
+// up after two full revolutions. Must be called with m_memoryLruLock held.
+void PipelineBinaryCache::EnforceMemoryBudget() const
+{
+    uint32_t sweepsLeft = m_memoryEntries.NumElements() * 2;
+
+    while ((m_memoryDataSize > m_memoryBudget) && (m_memoryEntries.NumElements() > 0) && (sweepsLeft > 0))
+    {
+        --sweepsLeft;
+
+        if (m_clockHand >= m_memoryEntries.NumElements())
+        {
+            m_clockHand = 0;
+        }
+
+        MemoryLayerEntry& entry = m_memoryEntries[m_clockHand];
+
+        if (entry.refCount > 0)
+        {
+            ++m_clockHand;
+        }
+        else if (entry.referenced)
+        {
+            entry.referenced = false;
+            ++m_clockHand;
+        }
+        else
+        {
+            const Util::Result result = m_pMemoryLayer->Evict(&entry.cacheId);
+
+            if ((result == Util::Result::Success) || (result == Util::Result::NotFound))
+            {
+                if (result == Util::Result::Success)
+                {
+                    Util::AtomicIncrement64(&m_memoryEvictions);
+                }
+
+                // The hand now points at the entry moved into this slot.
+                RemoveMemoryEntry(m_clockHand);
+            }
+            else
+            {
+                ++m_clockHand;
+            }
+        }
+    }
+}
+
+// =====================================================================================================================
+// Returns a snapshot of the lookup counters. The compressing layer sees every query if it sits on top of the memory
+// layer, otherwise only the ones the memory layer could not answer.
+void PipelineBinaryCache::GetStats(
+    PipelineBinaryCacheStats* pStats) const
+{
+    VK_ASSERT(pStats != nullptr);
+
+    memset(pStats, 0, sizeof(*pStats));
+
+    const uint64_t memoryHits  = m_memoryHits;
+    const uint64_t archiveHits = m_archiveHits;
+    const uint64_t misses      = m_misses;
+
+    pStats->memoryLayer.hits      = memoryHits;
+    pStats->memoryLayer.misses    = archiveHits + misses;
+    pStats->memoryLayer.evictions = m_memoryEvictions;
+
+    if ((m_pArchiveLayer != nullptr) || (m_pMappedArchive != nullptr))
+    {
+        pStats->archiveLayer.hits   = archiveHits;
+        pStats->archiveLayer.misses = misses;
+    }
+
+    if (m_pCompressingLayer != nullptr)
+    {
+        pStats->compressingLayer.hits   = m_memoryLayerCompressed ? (memoryHits + archiveHits) : archiveHits;
+        pStats->compressingLayer.misses = misses;
+    }
+
+    Util::MutexAuto lock(&m_memoryLruLock);
+
+    pStats->memoryBudget     = m_memoryBudget;
+    pStats->memoryDataSize   = m_memoryDataSize;
+    pStats->memoryEntryCount = m_memoryEntries.NumElements();
+
+    if (m_pWriteBehindQueue != nullptr)
+    {
+        m_pWriteBehindQueue->GetStats(&pStats->writeBehind);
+    }
+}
+
+// =====================================================================================================================
+// Writes the lookup counters as a JSON object.
+void PipelineBinaryCache::DumpStats(
+    Util::JsonWriter* pWriter) const
+{
+    VK_ASSERT(pWriter != nullptr);
+
+    PipelineBinaryCacheStats stats = {};
+    GetStats(&stats);
+
+    const struct
+    {
+        const char*                          pName;
+        const PipelineBinaryCacheLayerStats* pStats;
+    } layers[] =
+    {
+        { "memoryLayer",      &stats.memoryLayer },
+        { "compressingLayer", &stats.compressingLayer },
+        { "archiveLayer",     &stats.archiveLayer },
+    };
+
+    pWriter->BeginMap(false);
+    pWriter->KeyAndValue("memoryBudget",     stats.memoryBudget);
+    pWriter->KeyAndValue("memoryDataSize",   stats.memoryDataSize);
+    pWriter->KeyAndValue("memoryEntryCount", stats.memoryEntryCount);
+
+    for (const auto& layer : layers)
+    {
+        pWriter->KeyAndBeginMap(layer.pName, false);
+        pWriter->KeyAndValue("hits",      layer.pStats->hits);
+        pWriter->KeyAndValue("misses",    layer.pStats->misses);
+        pWriter->KeyAndValue("evictions", layer.pStats->evictions);
+        pWriter->EndMap();
+    }
+
+    pWriter->KeyAndBeginMap("writeBehind", false);
+    pWriter->KeyAndValue("queuedEntries",     stats.writeBehind.queuedEntries);
+    pWriter->KeyAndValue("queuedBytes",       stats.writeBehind.queuedBytes);
+    pWriter->KeyAndValue("flushedEntries",    stats.writeBehind.flushedEntries);
+    pWriter->KeyAndValue("flushedBytes",      stats.writeBehind.flushedBytes);
+    pWriter->KeyAndValue("pendingBytes",      stats.writeBehind.pendingBytes);
+    pWriter->KeyAndValue("synchronousWrites", stats.writeBehind.synchronousWrites);
+    pWriter->EndMap();
+
+    pWriter->EndMap();
+}
+
+// =====================================================================================================================
+// Introduces a mapping from an internal pipeline hash to a cache ID
+void PipelineBinaryCache::RegisterHashMapping(
+    const Pal::PipelineHash* pInternalPipelineHash,
+    const CacheId*           pCacheId)
+{
+    VK_ASSERT(pInternalPipelineHash != nullptr);
+    VK_ASSERT(pCacheId              != nullptr);
+
+    if (m_pReinjectionLayer != nullptr)
+    {
+        Util::RWLockAuto<Util::RWLock::LockType::ReadWrite> readWriteLock(&m_hashMappingLock);
+
+        m_hashMapping.Insert(*pInternalPipelineHash, *pCacheId);
+    }
+}
+
+// =====================================================================================================================
+// Retrieves the cache ID that maps to the given internal pipeline hash, pCacheId is unchanged if no mapping found
+PipelineBinaryCache::CacheId* PipelineBinaryCache::GetCacheIdForPipeline(
+    const Pal::PipelineHash* pInternalPipelineHash)
+{
+    VK_ASSERT(pInternalPipelineHash != nullptr);
+
+    CacheId* pCacheId = nullptr;
+
+    if (m_pReinjectionLayer != nullptr)
+    {
+        Util::RWLockAuto<Util::RWLock::LockType::ReadOnly> readWriteLock(&m_hashMappingLock);
+
+        pCacheId = m_hashMapping.FindKey(*pInternalPipelineHash);
+    }
+
+    return pCacheId;
+}
+
+// =====================================================================================================================
+// Attempt to load a binary from the reinjection cache layer
+Util::Result PipelineBinaryCache::LoadReinjectionBinary(
+    const CacheId* pInternalPipelineHash,
+    size_t*        pPipelineBinarySize,
+    const void**   ppPipelineBinary)
+{
+    Util::Result result = Util::Result::ErrorUnavailable;
+
+    if (m_pReinjectionLayer != nullptr)
+    {
+        Util::QueryResult query = {};
+        result = m_pReinjectionLayer->Query(pInternalPipelineHash, 0, 0, &query);
+
+        if (result == Util::Result::Success)
+        {
+            void* pOutputMem = AllocMem(query.dataSize);
+
+            if (pOutputMem != nullptr)
+            {
+                result = m_pReinjectionLayer->Load(&query, pOutputMem);
+
+                if (result == Util::Result::Success)
+                {
+                    *pPipelineBinarySize = query.dataSize;
+                    *ppPipelineBinary = pOutputMem;
+                }
+                else
+                {
+                    FreeMem(pOutputMem);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Attempt to store a binary into the reinjection cache layer
+Util::Result PipelineBinaryCache::StoreReinjectionBinary(
+    const CacheId*  pInternalPipelineHash,
+    size_t          pipelineBinarySize,
+    const void*     pPipelineBinary)
+{
+    Util::Result result = Util::Result::ErrorUnavailable;
+
+    if (m_pReinjectionLayer != nullptr)
+    {
+        uint32_t gfxIpMajor = 0u;
+        uint32_t gfxIpMinor = 0u;
+        uint32_t gfxIpStepping = 0u;
+
+        Util::Abi::PipelineAbiReader reader(&m_palAllocator,
+                                            Util::Span<const void>{ pPipelineBinary, pipelineBinarySize});
+        reader.GetGfxIpVersion(&gfxIpMajor, &gfxIpMinor, &gfxIpStepping);
+
+        if (gfxIpMajor == m_gfxIp.major &&
+            gfxIpMinor == m_gfxIp.minor &&
+            gfxIpStepping == m_gfxIp.stepping)
+        {
+            Util::StoreFlags storeFlags  = {};
+            storeFlags.enableFileCache   = true;
+            storeFlags.enableCompression = true;
+            result = m_pReinjectionLayer->Store(storeFlags, pInternalPipelineHash, pPipelineBinary, pipelineBinarySize);
+        }
+        else
+        {
+            result = Util::Result::ErrorIncompatibleDevice;
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Free memory allocated by our allocator
+void PipelineBinaryCache::FreePipelineBinary(
+    const void* pPipelineBinary)
+{
+    FreeMem(const_cast<void*>(pPipelineBinary));
+}
+
+// =====================================================================================================================
+// Destroy PipelineBinaryCache itself
 void PipelineBinaryCache::Destroy()
 {
     if (m_pDevMode != nullptr)
@@ -554,6 +1158,11 @@ VkResult PipelineBinaryCache::Initialize(
         result = OrderLayers(settings);
     }
 
+    if (result == VK_SUCCESS)
+    {
+        InitWriteBehindQueue(settings);
+    }
+
     if ((result == VK_SUCCESS) &&
         (m_pReinjectionLayer != nullptr))
     {
@@ -814,6 +1423,11 @@ VkResult PipelineBinaryCache::InitMemoryCacheLayer(
     createInfo.evictOnFull         = true;
     createInfo.evictDuplicates     = true;
 
+    // The layer's own limit stays in place as a backstop, the budget is enforced by EnforceMemoryBudget. Without a
+    // budget below that limit the layer evicts on its own and entries are not tracked at all.
+    m_memoryBudget = (settings.pipelineCacheMemoryBudget < createInfo.maxMemorySize) ?
+                     settings.pipelineCacheMemoryBudget : 0;
+
     size_t layerSize = Util::GetMemoryCacheLayerSize(&createInfo);
     void* pMem = AllocMem(layerSize);
 
@@ -825,7 +1439,12 @@ VkResult PipelineBinaryCache::InitMemoryCacheLayer(
     }
     else
     {
-        result = PalToVkResult(CreateMemoryCacheLayer(&createInfo, pMem, &m_pMemoryLayer));
+        result = PalToVkResult(m_memoryEntryIndex.Init());
+
+        if (result == VK_SUCCESS)
+        {
+            result = PalToVkResult(CreateMemoryCacheLayer(&createInfo, pMem, &m_pMemoryLayer));
+        }
         VK_ASSERT(result == VK_SUCCESS);
 
         if (result != VK_SUCCESS)
@@ -1072,6 +1691,15 @@ VkResult PipelineBinaryCache::InitArchiveLayers(
         Util::ICacheLayer* pThirdPartyLayer    = nullptr;
 
         if (pThirdPartyFileName != nullptr)
+        {
+            // Prefer mapping the file directly if it is in the mapped archive format.
+            m_pMappedArchive = MappedPipelineArchive::Create(this,
+                                                             pCachePath,
+                                                             pThirdPartyFileName,
+                                                             m_pPlatformKey->GetKey64());
+        }
+
+        if ((pThirdPartyFileName != nullptr) && (m_pMappedArchive == nullptr))
         {
             Util::IArchiveFile* pFile = OpenReadOnlyArchive(pCachePath, pThirdPartyFileName, PrimaryLayerBufferSize);
 
@@ -1228,6 +1856,8 @@ VkResult PipelineBinaryCache::InitArchiveLayers(
         }
 
         PAL_ALERT_MSG(pWriteLayer == nullptr, "No valid write layer for cache. No data will be written out.");
+
+        m_archiveWritable = (pWriteLayer != nullptr);
     }
 
     return result;
@@ -1246,6 +1876,12 @@ VkResult PipelineBinaryCache::InitLayers(
 
     bool archiveLayerOnline = createArchiveLayers && (InitArchiveLayers(pDefaultCacheFilePath, settings) >= VK_SUCCESS);
 
+    // Hits are attributed to the archives by looking for the entry in the tracked set, so entries are tracked if
+    // there is an archive even without a budget.  The memory layer then only evicts on its own once it is full, which
+    // the tracked set can't see, so hits on entries evicted that way are still counted as memory layer hits.
+    m_trackMemoryEntries = memoryLayerOnline &&
+                           ((m_memoryBudget > 0) || (m_pArchiveLayer != nullptr) || (m_pMappedArchive != nullptr));
+
     if (((settings.pipelineCacheCompression == PipelineCacheCompressInMemory) && memoryLayerOnline) ||
         ((settings.pipelineCacheCompression != PipelineCacheCompressDisabled) && archiveLayerOnline))
     {
@@ -1286,6 +1922,30 @@ VkResult PipelineBinaryCache::AddLayerToChain(
     return result;
 }
 
+// =====================================================================================================================
+// Moves writes to the archive layers onto a background thread. Only done if the memory layer sits on top of them, so
+// that binaries are visible to queries right away while their write is pending. With in-memory compression the archive
+// layers expect binaries compressed by the layer on top of the chain, so writes stay on the calling thread.
+void PipelineBinaryCache::InitWriteBehindQueue(
+    const RuntimeSettings& settings)
+{
+    if ((settings.pipelineCacheWriteBehindBudget > 0) &&
+        m_archiveWritable                            &&
+        (m_pMemoryLayer != nullptr)                  &&
+        (m_memoryLayerCompressed == false))
+    {
+        // With on-disk compression, the compressing layer sits between the memory layer and the archive layers.
+        Util::ICacheLayer* pTargetLayer = (m_pCompressingLayer != nullptr) ? m_pCompressingLayer : m_pArchiveLayer;
+
+        m_pWriteBehindQueue = ArchiveWriteBehindQueue::Create(this,
+                                                              pTargetLayer,
+                                                              settings.pipelineCacheWriteBehindBudget);
+
+        // Not fatal, stores are written through on the calling thread instead.
+        VK_ALERT(m_pWriteBehindQueue == nullptr);
+    }
+}
+
 // =====================================================================================================================
 // Order the layers for desired caching behaviour
 VkResult PipelineBinaryCache::OrderLayers(
@@ -1301,6 +1961,10 @@ VkResult PipelineBinaryCache::OrderLayers(
         result = AddLayerToChain(m_pCompressingLayer, &pBottomLayer);
     }
 
+    // Binaries that pass through the compressing layer before reaching the memory layer are stored compressed, which
+    // rules out handing out pointers to the memory layer's storage during serialization.
+    m_memoryLayerCompressed = (m_pTopLayer != nullptr);
+
     if (result == VK_SUCCESS)
     {
         result = AddLayerToChain(m_pMemoryLayer, &pBottomLayer);
@@ -1334,7 +1998,9 @@ VkResult PipelineBinaryCache::OrderLayers(
 VkResult PipelineBinaryCache::Serialize(
     void*   pBlob,    // [out] System memory pointer where the serialized data should be placed
     size_t* pSize)    // [in,out] Size of the memory pointed to by pBlob. If the value stored in pSize is zero then no
-                      // data will be copied and instead the size required for serialization will be returned in pSize
+                      // data will be copied and instead the size required for serialization will be returned in pSize.
+                      // Otherwise the number of bytes actually written is returned in pSize, and VK_INCOMPLETE if not
+                      // all entries fit.
 {
     VkResult result = VK_ERROR_INITIALIZATION_FAILED;
 
@@ -1358,30 +2024,40 @@ VkResult PipelineBinaryCache::Serialize(
             if (result == VK_SUCCESS)
             {
                 PipelineBinaryCacheSerializer serializer;
-                if (serializer.Initialize(*pSize, pBlob) == Util::Result::Success)
+                if (serializer.Initialize(m_pAllocationCallbacks, m_pPlatformKey, *pSize, pBlob) ==
+                    Util::Result::Success)
                 {
                     Util::AutoBuffer<Util::Hash128, 8, PalAllocator> cacheIds(curCount, &m_palAllocator);
                     result = PalToVkResult(Util::GetMemoryCacheLayerHashIds(m_pMemoryLayer, curCount, &cacheIds[0]));
-                    for (uint32_t i = 0; result == VK_SUCCESS && i < curCount; i++)
+
+                    bool incomplete = false;
+                    for (uint32_t i = 0; result == VK_SUCCESS && (incomplete == false) && i < curCount; i++)
                     {
-                        const void*      pBinaryCacheData = nullptr;
                         BinaryCacheEntry entry;
                         // We need to set BinaryCacheEntry padding to 0. Otherwise two caches of the same pipeline
                         // might not be bit-to-bit identical, causing CTS failures.
                         memset(&entry, 0, sizeof(entry));
                         entry.hashId = cacheIds[i];
 
-                        result = PalToVkResult(LoadPipelineBinary(&entry.hashId, &entry.dataSize, &pBinaryCacheData));
-                        if (result == VK_SUCCESS)
-                        {
-                            result = PalToVkResult(serializer.AddPipelineBinary(&entry, pBinaryCacheData));
-                            FreeMem(const_cast<void*>(pBinaryCacheData));
-                        }
+                        Util::Result palResult = SerializeEntry(&entry, &serializer);
+
+                        // Entries that no longer fit (e.g. stored after the size query) end a partial write.
+                        incomplete = (palResult == Util::Result::ErrorIncompleteResults);
+
+                        // Corrupted initial data entries are dropped when they are verified.
+                        result = ((palResult == Util::Result::NotFound) || incomplete) ? VK_SUCCESS :
+                                                                                         PalToVkResult(palResult);
+                    }
+
+                    if (result == VK_SUCCESS)
+                    {
+                        result = PalToVkResult(serializer.Finalize(nullptr, pSize));
+                    }
+
+                    if ((result == VK_SUCCESS) && incomplete)
+                    {
+                        result = VK_INCOMPLETE;
                     }
-                    result = PalToVkResult(serializer.Finalize(m_pAllocationCallbacks,
-                                                               m_pPlatformKey,
-                                                               nullptr,
-                                                               nullptr));
                 }
                 else
                 {
@@ -1394,56 +2070,547 @@ VkResult PipelineBinaryCache::Serialize(
 }
 
 // =====================================================================================================================
-// Merge the pipeline cache data into one
-//
-VkResult PipelineBinaryCache::Merge(
-    uint32_t                    srcCacheCount,
-    const PipelineBinaryCache** ppSrcCaches)
+// Writes the entries of the memory layer to the given file in the memory-mapped archive format, so that later runs can
+// map them through MappedPipelineArchive instead of loading them.
+VkResult PipelineBinaryCache::ExportMappedArchive(
+    const char* pFilePath)
 {
-    Pal::Result result = Pal::Result::ErrorInitializationFailed;
-
-    if (m_pMemoryLayer != nullptr)
-    {
-        for (uint32_t i = 0; i < srcCacheCount; i++)
-        {
-            Util::ICacheLayer* pMemoryLayer = ppSrcCaches[i]->GetMemoryLayer();
-            size_t curCount, curDataSize;
+    VK_ASSERT(pFilePath != nullptr);
 
-            result = Util::GetMemoryCacheLayerCurSize(pMemoryLayer, &curCount, &curDataSize);
+    size_t   blobSize = 0;
+    VkResult result   = Serialize(nullptr, &blobSize);
 
-            if ((result == Pal::Result::Success) && (curCount > 0))
-            {
-                Util::AutoBuffer<Util::Hash128, 8, PalAllocator> cacheIds(curCount, &m_palAllocator);
+    void* pBlob = nullptr;
 
-                result = Util::GetMemoryCacheLayerHashIds(pMemoryLayer, curCount, &cacheIds[0]);
-                if (result == Pal::Result::Success)
+    if (result == VK_SUCCESS)
+    {
+        pBlob  = AllocMem(blobSize);
+        result = (pBlob != nullptr) ? VK_SUCCESS : VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        // Serialize() reports the bytes it actually wrote, so no unused tail is mistaken for entries.
+        result = Serialize(pBlob, &blobSize);
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        result = PalToVkResult(WriteMappedPipelineArchive(m_pAllocationCallbacks,
+                                                          m_pPlatformKey,
+                                                          pBlob,
+                                                          blobSize,
+                                                          pFilePath));
+    }
+
+    if (pBlob != nullptr)
+    {
+        FreeMem(pBlob);
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Writes a single cache entry into the serializer, avoiding intermediate copies where the memory layer allows it.
+Util::Result PipelineBinaryCache::SerializeEntry(
+    BinaryCacheEntry*              pEntry,
+    PipelineBinaryCacheSerializer* pSerializer) const
+{
+    Util::Result result = Util::Result::Success;
+
+    VerifyUncheckedEntry(&pEntry->hashId);
+
+    if (m_memoryLayerCompressed == false)
+    {
+        result = SerializeEntryZeroCopy(pEntry, pSerializer);
+    }
+    else
+    {
+        const void* pBinaryCacheData = nullptr;
+
+        result = LoadPipelineBinary(&pEntry->hashId, &pEntry->dataSize, &pBinaryCacheData);
+        if (result == Util::Result::Success)
+        {
+            result = pSerializer->AddPipelineBinary(pEntry, pBinaryCacheData);
+            FreeMem(const_cast<void*>(pBinaryCacheData));
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Copies only the entries stored since the previous delta serialization to the memory blob provided by the calling
+// function, as a delta chunk. The first call after a delta was completely written snapshots the pending generations;
+// size queries and writes keep covering that snapshot until it is completely written, so a size query and the write
+// that follows see the same delta even if entries are stored in between.  Entries evicted from the memory layer in the
+// meantime are skipped. If the snapshot doesn't fit, the oldest entries that fit are written and VK_INCOMPLETE is
+// returned; the rest remain pending for the next call. Written generations are dropped from the insertion log.
+//
+// NOTE: Requires generation tracking to be enabled through EnableGenerationTracking.
+VkResult PipelineBinaryCache::SerializeDelta(
+    void*   pBlob,    // [out] System memory pointer where the serialized data should be placed
+    size_t* pSize)    // [in,out] Size of the memory pointed to by pBlob. If the value stored in pSize is zero then no
+                      // data will be copied and instead the size required for serialization will be returned in pSize.
+                      // Otherwise the number of bytes actually written is returned.
+{
+    VK_ASSERT(m_trackGenerations);
+
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+
+    if (m_pMemoryLayer != nullptr)
+    {
+        PipelineBinaryCacheDeltaHeader deltaHeader = {};
+        deltaHeader.magic = PipelineBinaryCacheDeltaMagic;
+
+        // Snapshot the cache IDs of the new entries, the log may be reallocated by concurrent stores.
+        m_insertionLogLock.Lock();
+
+        if (m_snapshotGeneration <= m_serializedGeneration)
+        {
+            m_snapshotGeneration = m_insertionLogBase + m_insertionLog.NumElements();
+        }
+
+        deltaHeader.baseGeneration = m_serializedGeneration;
+        deltaHeader.generation     = m_snapshotGeneration;
+
+        const uint32_t firstIndex = static_cast<uint32_t>(deltaHeader.baseGeneration - m_insertionLogBase);
+        size_t         newCount   = static_cast<size_t>(deltaHeader.generation - deltaHeader.baseGeneration);
+        Util::AutoBuffer<CacheId, 8, PalAllocator> cacheIds(newCount, &m_palAllocator);
+
+        for (size_t i = 0; i < newCount; i++)
+        {
+            cacheIds[i] = m_insertionLog.At(firstIndex + static_cast<uint32_t>(i));
+        }
+
+        m_insertionLogLock.Unlock();
+
+        result = VK_SUCCESS;
+
+        if (*pSize == 0)
+        {
+            size_t newDataSize = 0;
+
+            for (size_t i = 0; i < newCount; i++)
+            {
+                Util::QueryResult query = {};
+
+                if (m_pTopLayer->Query(&cacheIds[i], 0, 0, &query) == Util::Result::Success)
+                {
+                    newDataSize += query.dataSize;
+                }
+            }
+
+            *pSize = PipelineBinaryCacheSerializer::CalculateAnticipatedDeltaBlobSize(newCount, newDataSize);
+        }
+        else
+        {
+            size_t fitCount    = 0;
+            size_t fitDataSize = 0;
+
+            for (; fitCount < newCount; fitCount++)
+            {
+                Util::QueryResult query         = {};
+                size_t            entryDataSize = 0;
+
+                if (m_pTopLayer->Query(&cacheIds[fitCount], 0, 0, &query) == Util::Result::Success)
+                {
+                    entryDataSize = query.dataSize;
+                }
+
+                if (PipelineBinaryCacheSerializer::CalculateAnticipatedDeltaBlobSize(
+                        fitCount + 1, fitDataSize + entryDataSize) > *pSize)
+                {
+                    break;
+                }
+
+                fitDataSize += entryDataSize;
+            }
+
+            const bool incomplete = (fitCount < newCount);
+
+            newCount               = fitCount;
+            deltaHeader.generation = deltaHeader.baseGeneration + fitCount;
+
+            PipelineBinaryCacheSerializer serializer;
+            if (serializer.Initialize(m_pAllocationCallbacks, m_pPlatformKey, *pSize, pBlob, &deltaHeader) ==
+                Util::Result::Success)
+            {
+                Util::Result palResult = Util::Result::Success;
+
+                for (size_t i = 0; (palResult == Util::Result::Success) && (i < newCount); i++)
                 {
-                    for (uint32_t j = 0; j < curCount; j++)
+                    BinaryCacheEntry entry;
+                    // We need to set BinaryCacheEntry padding to 0 so that identical deltas are bit-to-bit identical.
+                    memset(&entry, 0, sizeof(entry));
+                    entry.hashId = cacheIds[i];
+
+                    palResult = SerializeEntry(&entry, &serializer);
+
+                    if (palResult == Util::Result::NotFound)
                     {
-                        size_t           dataSize;
-                        const void*      pBinaryCacheData;
+                        // The entry has been evicted since it was stored.
+                        palResult = Util::Result::Success;
+                    }
+                }
 
-                        result = ppSrcCaches[i]->LoadPipelineBinary(&cacheIds[j], &dataSize, &pBinaryCacheData);
-                        if (result == Pal::Result::Success)
-                        {
-                            result = StorePipelineBinary(&cacheIds[j], dataSize, pBinaryCacheData);
-                            FreeMem(const_cast<void*>(pBinaryCacheData));
+                result = PalToVkResult(palResult);
 
-                            // Do not break for success cases or an already existing cache entry
-                            if ((result != Pal::Result::Success) && (result != Pal::Result::AlreadyExists))
-                            {
-                                break;
-                            }
-                        }
+                if (result == VK_SUCCESS)
+                {
+                    result = PalToVkResult(serializer.Finalize(nullptr, pSize));
+                }
+
+                if (result == VK_SUCCESS)
+                {
+                    Util::MutexAuto lock(&m_insertionLogLock);
+
+                    m_serializedGeneration = Util::Max(m_serializedGeneration, deltaHeader.generation);
+
+                    // Drop the written generations, only the pending ones are ever read again.
+                    const uint32_t writtenCount = static_cast<uint32_t>(m_serializedGeneration - m_insertionLogBase);
+                    const uint32_t pendingCount = m_insertionLog.NumElements() - writtenCount;
+
+                    for (uint32_t i = 0; i < pendingCount; i++)
+                    {
+                        m_insertionLog.At(i) = m_insertionLog.At(writtenCount + i);
                     }
+
+                    CacheId droppedId;
+                    for (uint32_t i = 0; i < writtenCount; i++)
+                    {
+                        m_insertionLog.PopBack(&droppedId);
+                    }
+
+                    m_insertionLogBase = m_serializedGeneration;
+
+                    result = incomplete ? VK_INCOMPLETE : VK_SUCCESS;
                 }
             }
+            else
+            {
+                result = VK_ERROR_INITIALIZATION_FAILED;
+            }
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Starts recording the generation of every entry stored from now on, so that SerializeDelta can emit just the entries
+// added since the last serialization. Entries stored before this call (e.g. from initial data) are never part of a
+// delta.
+void PipelineBinaryCache::EnableGenerationTracking()
+{
+    Util::MutexAuto lock(&m_insertionLogLock);
+
+    m_trackGenerations     = true;
+    m_serializedGeneration = m_insertionLogBase + m_insertionLog.NumElements();
+}
+
+// =====================================================================================================================
+// Writes a single memory layer entry into the serializer straight from the layer's storage. The entry is pinned with a
+// cache reference for the duration of the copy, so the only copy made is the one into the output blob.
+//
+// NOTE: Only valid when the memory layer holds uncompressed binaries (i.e. compression is not done in memory).
+Util::Result PipelineBinaryCache::SerializeEntryZeroCopy(
+    BinaryCacheEntry*              pEntry,
+    PipelineBinaryCacheSerializer* pSerializer) const
+{
+    VK_ASSERT(m_pMemoryLayer != nullptr);
+    VK_ASSERT(m_memoryLayerCompressed == false);
+
+    Util::QueryResult query  = {};
+    Util::Result      result = m_pMemoryLayer->Query(&pEntry->hashId,
+                                                     0,
+                                                     Util::ICacheLayer::QueryFlags::AcquireEntryRef,
+                                                     &query);
+
+    if (result == Util::Result::Success)
+    {
+        const void* pBinaryCacheData = nullptr;
+
+        PinMemoryEntry(&pEntry->hashId);
+
+        result = m_pMemoryLayer->GetCacheData(&query, &pBinaryCacheData);
+
+        if (result == Util::Result::Success)
+        {
+            pEntry->dataSize = query.dataSize;
+            result           = pSerializer->AddPipelineBinary(pEntry, pBinaryCacheData);
         }
+
+        UnpinMemoryEntry(&pEntry->hashId);
+        m_pMemoryLayer->ReleaseCacheRef(&query);
     }
 
-    return (((result == Pal::Result::Success) ||
-             (result == Pal::Result::AlreadyExists))?
-            VK_SUCCESS : PalToVkResult(result));
+    return result;
+}
+
+// =====================================================================================================================
+// Merge the pipeline cache data into one
+//
+VkResult PipelineBinaryCache::Merge(
+    uint32_t                       srcCacheCount,
+    const PipelineBinaryCache**    ppSrcCaches,
+    PipelineBinaryCacheMergeStats* pStats)
+{
+    PipelineBinaryCacheMergeStats stats = {};
+    PipelineBinaryCacheMergeList  list  = {};
+
+    VkResult result = BuildMergeList(srcCacheCount, ppSrcCaches, 1, &list);
+
+    if (result == VK_SUCCESS)
+    {
+        result = MergePartition(ppSrcCaches, &list, 0, &stats);
+    }
+
+    FreeMergeList(&list);
+
+    if (pStats != nullptr)
+    {
+        *pStats = stats;
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Fetches the cache IDs of every source cache once and buckets them by the partition of the hash space they fall into,
+// so that the partitions of a merge can be handed to different threads without each of them walking all sources.
+VkResult PipelineBinaryCache::BuildMergeList(
+    uint32_t                      srcCacheCount,
+    const PipelineBinaryCache**   ppSrcCaches,
+    uint32_t                      partitionCount,
+    PipelineBinaryCacheMergeList* pList)    // [out] Must be released with FreeMergeList(), even on failure
+{
+    VK_ASSERT(partitionCount > 0);
+    VK_ASSERT(pList != nullptr);
+
+    *pList = {};
+    pList->partitionCount = partitionCount;
+
+    Pal::Result result = (m_pMemoryLayer != nullptr) ? Pal::Result::Success : Pal::Result::ErrorInitializationFailed;
+
+    Util::AutoBuffer<size_t, 16, PalAllocator> srcCounts(srcCacheCount, &m_palAllocator);
+
+    if ((result == Pal::Result::Success) && (srcCounts.Capacity() < srcCacheCount))
+    {
+        result = Pal::Result::ErrorOutOfMemory;
+    }
+
+    size_t totalCount = 0;
+
+    for (uint32_t i = 0; (i < srcCacheCount) && (result == Pal::Result::Success); i++)
+    {
+        size_t curDataSize;
+
+        result      = Util::GetMemoryCacheLayerCurSize(ppSrcCaches[i]->GetMemoryLayer(), &srcCounts[i], &curDataSize);
+        totalCount += srcCounts[i];
+    }
+
+    if (result == Pal::Result::Success)
+    {
+        const size_t entriesSize = sizeof(PipelineBinaryCacheMergeList::Entry) * totalCount;
+        void*        pMem        = AllocMem(entriesSize + (sizeof(uint32_t) * (partitionCount + 1)));
+
+        if (pMem != nullptr)
+        {
+            pList->pEntries        = static_cast<PipelineBinaryCacheMergeList::Entry*>(pMem);
+            pList->pPartitionStart = static_cast<uint32_t*>(Util::VoidPtrInc(pMem, entriesSize));
+
+            memset(pList->pPartitionStart, 0, sizeof(uint32_t) * (partitionCount + 1));
+        }
+        else
+        {
+            result = Pal::Result::ErrorOutOfMemory;
+        }
+    }
+
+    Util::AutoBuffer<CacheId, 8, PalAllocator>   cacheIds(totalCount, &m_palAllocator);
+    Util::AutoBuffer<uint32_t, 16, PalAllocator> cursors(partitionCount, &m_palAllocator);
+
+    if ((result == Pal::Result::Success) &&
+        ((cacheIds.Capacity() < totalCount) || (cursors.Capacity() < partitionCount)))
+    {
+        result = Pal::Result::ErrorOutOfMemory;
+    }
+
+    // Fetch the IDs of all sources and count the entries of each partition.
+    size_t offset = 0;
+
+    for (uint32_t i = 0; (i < srcCacheCount) && (result == Pal::Result::Success); i++)
+    {
+        if (srcCounts[i] > 0)
+        {
+            result = Util::GetMemoryCacheLayerHashIds(ppSrcCaches[i]->GetMemoryLayer(),
+                                                      srcCounts[i],
+                                                      &cacheIds[offset]);
+        }
+
+        for (size_t j = offset; (j < offset + srcCounts[i]) && (result == Pal::Result::Success); j++)
+        {
+            pList->pPartitionStart[(cacheIds[j].qwords[0] % partitionCount) + 1]++;
+        }
+
+        offset += srcCounts[i];
+    }
+
+    if (result == Pal::Result::Success)
+    {
+        for (uint32_t p = 0; p < partitionCount; p++)
+        {
+            pList->pPartitionStart[p + 1] += pList->pPartitionStart[p];
+            cursors[p]                     = pList->pPartitionStart[p];
+        }
+
+        // Scatter the IDs into their partitions. Sources are walked in order, so within a partition the first source
+        // holding an ID still provides the merged entry.
+        offset = 0;
+
+        for (uint32_t i = 0; i < srcCacheCount; i++)
+        {
+            for (size_t j = offset; j < offset + srcCounts[i]; j++)
+            {
+                PipelineBinaryCacheMergeList::Entry* pEntry =
+                    &pList->pEntries[cursors[cacheIds[j].qwords[0] % partitionCount]++];
+
+                pEntry->srcIndex = i;
+                pEntry->cacheId  = cacheIds[j];
+            }
+
+            offset += srcCounts[i];
+        }
+    }
+
+    return PalToVkResult(result);
+}
+
+// =====================================================================================================================
+void PipelineBinaryCache::FreeMergeList(
+    PipelineBinaryCacheMergeList* pList) const
+{
+    if (pList->pEntries != nullptr)
+    {
+        FreeMem(pList->pEntries);
+    }
+
+    *pList = {};
+}
+
+// =====================================================================================================================
+// Merges the entries of one partition of a merge list. Every cache ID belongs to exactly one partition, so the
+// partitions of a merge can be processed by different threads concurrently, and an ID shared by several sources is
+// always deduplicated by the same thread.
+VkResult PipelineBinaryCache::MergePartition(
+    const PipelineBinaryCache**         ppSrcCaches,
+    const PipelineBinaryCacheMergeList* pList,
+    uint32_t                            partitionIndex,
+    PipelineBinaryCacheMergeStats*      pStats)
+{
+    VK_ASSERT(partitionIndex < pList->partitionCount);
+    VK_ASSERT(pStats != nullptr);
+
+    Pal::Result result = Pal::Result::ErrorInitializationFailed;
+
+    if (m_pMemoryLayer != nullptr)
+    {
+        result = Pal::Result::Success;
+
+        const uint32_t end = pList->pPartitionStart[partitionIndex + 1];
+
+        for (uint32_t i = pList->pPartitionStart[partitionIndex]; (i < end) && (result == Pal::Result::Success); i++)
+        {
+            const PipelineBinaryCacheMergeList::Entry& entry = pList->pEntries[i];
+
+            result = MergeEntry(ppSrcCaches[entry.srcIndex], &entry.cacheId, pStats);
+
+            // The source may have dropped the entry since its IDs were fetched.
+            if (result == Pal::Result::NotFound)
+            {
+                result = Pal::Result::Success;
+            }
+        }
+    }
+
+    return PalToVkResult(result);
+}
+
+// =====================================================================================================================
+// Copies a single entry of a source cache unless this cache already has it. Entries of uncompressed memory layers are
+// stored straight from the source's memory, so the payload is only copied once.
+Util::Result PipelineBinaryCache::MergeEntry(
+    const PipelineBinaryCache*     pSrcCache,
+    const CacheId*                 pCacheId,
+    PipelineBinaryCacheMergeStats* pStats)
+{
+    pSrcCache->VerifyUncheckedEntry(pCacheId);
+
+    Util::QueryResult dstQuery  = {};
+    Util::Result      result    = m_pTopLayer->Query(pCacheId, 0, 0, &dstQuery);
+    bool              duplicate = (result == Util::Result::Success);
+
+    if (duplicate)
+    {
+        // Nothing to copy
+    }
+    else if (pSrcCache->m_memoryLayerCompressed == false)
+    {
+        Util::QueryResult srcQuery = {};
+
+        result = pSrcCache->m_pMemoryLayer->Query(
+            pCacheId, 0, Util::ICacheLayer::QueryFlags::AcquireEntryRef, &srcQuery);
+
+        if (result == Util::Result::Success)
+        {
+            const void* pBinaryCacheData = nullptr;
+
+            pSrcCache->PinMemoryEntry(pCacheId);
+
+            result = pSrcCache->m_pMemoryLayer->GetCacheData(&srcQuery, &pBinaryCacheData);
+
+            if (result == Util::Result::Success)
+            {
+                result = StorePipelineBinary(pCacheId, srcQuery.dataSize, pBinaryCacheData);
+            }
+
+            pSrcCache->UnpinMemoryEntry(pCacheId);
+            pSrcCache->m_pMemoryLayer->ReleaseCacheRef(&srcQuery);
+        }
+    }
+    else
+    {
+        size_t      dataSize;
+        const void* pBinaryCacheData;
+
+        result = pSrcCache->LoadPipelineBinary(pCacheId, &dataSize, &pBinaryCacheData);
+
+        if (result == Util::Result::Success)
+        {
+            result = StorePipelineBinary(pCacheId, dataSize, pBinaryCacheData);
+            FreeMem(const_cast<void*>(pBinaryCacheData));
+        }
+    }
+
+    if (result == Util::Result::AlreadyExists)
+    {
+        // Another thread stored the same entry in between the query and the store.
+        duplicate = true;
+        result    = Util::Result::Success;
+    }
+
+    if (duplicate)
+    {
+        pStats->duplicateCount++;
+    }
+    else if (result == Util::Result::Success)
+    {
+        pStats->mergedCount++;
+    }
+
+    return result;
 }
 
 } // namespace vk
@@ -45,9 +45,11 @@
 #include "palFile.h"
 #include "palHashSetImpl.h"
 #include "palListImpl.h"
+#include "palVectorImpl.h"
 #include "palShaderLibrary.h"
 
 #include "include/pipeline_binary_cache.h"
+#include "include/shader_module_cache.h"
 #include "devmode/devmode_mgr.h"
 
 #if VKI_RAY_TRACING
@@ -56,11 +58,15 @@
 #endif
 
 #include "palElfReader.h"
+#include "palJsonWriter.h"
 #include "palPipelineAbiReader.h"
 #include "palPipelineAbiProcessorImpl.h"
 
+#include "utils/json_writer.h"
+
 #include "llpc.h"
 
+#include <algorithm>
 #include <inttypes.h>
 
 namespace vk
@@ -232,9 +238,18 @@ PipelineCompiler::PipelineCompiler(
     , m_compilerSolutionLlpc(pPhysicalDevice)
     , m_pBinaryCache(nullptr)
     , m_pipelineCacheMatrix{}
+    , m_telemetryDumpGroupReady(false)
+    , m_telemetryDumpPending(0)
     , m_uberFetchShaderInfoFormatMap(8, pPhysicalDevice->Manager()->VkInstance()->Allocator())
-    , m_shaderModuleHandleMap(8, pPhysicalDevice->Manager()->VkInstance()->Allocator())
+    , m_pShaderModuleCache(nullptr)
+    , m_ownsShaderModuleCache(false)
     , m_colorExportShaderMap(8, pPhysicalDevice->Manager()->VkInstance()->Allocator())
+    , m_colorExportPrewarm{}
+    , m_colorExportPrewarmActive(false)
+    , m_pColorExportPrewarmList(nullptr)
+    , m_colorExportPrewarmListSize(0)
+    , m_colorExportPrewarmListGenerations(0)
+    , m_colorExportPrewarmStarted(false)
 {
 
 }
@@ -300,11 +315,134 @@ void PipelineCompiler::DumpCacheMatrix(
     }
 }
 
+// =====================================================================================================================
+// Dump the lookup statistics of the internal pipeline binary cache to PipelineBinaryCacheStats.json
+void PipelineCompiler::DumpBinaryCacheStats() const
+{
+    const RuntimeSettings& settings = m_pPhysicalDevice->GetRuntimeSettings();
+
+    if ((m_pBinaryCache != nullptr) && settings.dumpPipelineBinaryCacheStats)
+    {
+        char filename[Util::MaxPathStrLen] = {};
+        Util::Snprintf(filename, sizeof(filename), "%s/PipelineBinaryCacheStats.json", settings.pipelineDumpDir);
+
+        utils::JsonOutputStream jsonStream(filename);
+        Util::JsonWriter        jsonWriter(&jsonStream);
+
+        m_pBinaryCache->DumpStats(&jsonWriter);
+    }
+}
+
+// =====================================================================================================================
+// Writes the telemetry counters of this compiler as JSON to PipelineTelemetry_<gpuIndex>.json.  Safe to call at any
+// time; concurrent dumps are serialized so they don't write the same file at once.
+void PipelineCompiler::DumpTelemetry()
+{
+    Util::MutexAuto lock(&m_telemetryDumpLock);
+
+    char filename[Util::MaxPathStrLen] = {};
+    Util::Snprintf(filename, sizeof(filename), "%s/PipelineTelemetry_%u.json",
+        m_pPhysicalDevice->GetRuntimeSettings().pipelineDumpDir, m_pPhysicalDevice->PalProperties().gpuIndex);
+
+    DeferCompileStats deferCompileStats = {};
+    GetDeferCompileStats(&deferCompileStats);
+
+    utils::JsonOutputStream jsonStream(filename);
+    Util::JsonWriter        jsonWriter(&jsonStream);
+
+    m_telemetry.Write(&jsonWriter, m_pBinaryCache, deferCompileStats);
+}
+
+// =====================================================================================================================
+// Body of a requested telemetry dump, run on a deferred compile worker thread or inline if none is available.
+void PipelineCompiler::DumpTelemetryTask(
+    void* pPayload)
+{
+    PipelineCompiler* pCompiler = static_cast<PipelineCompiler*>(pPayload);
+
+    pCompiler->DumpTelemetry();
+
+    Util::AtomicExchange(&pCompiler->m_telemetryDumpPending, 0u);
+}
+
+// =====================================================================================================================
+// Records the compile time of a pipeline and rewrites the telemetry file if the dump interval has elapsed.
+void PipelineCompiler::RecordPipelineCompile(
+    PipelineTelemetryType type,
+    int64_t               compileTime)
+{
+    m_telemetry.RecordPipelineCompile(type, compileTime);
+
+    DumpTelemetryIfDue();
+}
+
+// =====================================================================================================================
+// Rewrites the telemetry file if the dump interval has elapsed.  Called for every pipeline cache lookup as well as for
+// every compile, so runs served entirely from the caches are dumped too.
+void PipelineCompiler::DumpTelemetryIfDue()
+{
+    const uint32_t dumpInterval = m_pPhysicalDevice->GetRuntimeSettings().pipelineTelemetryDumpInterval;
+
+    if ((dumpInterval != 0) && m_telemetry.ShouldDump(dumpInterval))
+    {
+        RequestTelemetryDump();
+    }
+}
+
+// =====================================================================================================================
+// Requests the telemetry file to be rewritten independently of the dump interval.  The file is written on a deferred
+// compile worker thread, so the calling thread doesn't wait for file I/O.  Without worker threads it is written on the
+// calling thread instead, which the dump interval keeps rare for the periodic dumps.  A request made while a dump is
+// still queued is covered by that dump.
+void PipelineCompiler::RequestTelemetryDump()
+{
+    if (Util::AtomicExchange(&m_telemetryDumpPending, 1u) == 0)
+    {
+        bool queued = false;
+
+        if (m_telemetryDumpGroupReady)
+        {
+            DeferredCompileWorkload workload = {};
+            workload.pPayloads = this;
+            workload.Execute   = &DumpTelemetryTask;
+            workload.pGroup    = &m_telemetryDumpGroup;
+            workload.priority  = DeferCompilePriority::Normal;
+
+            m_telemetryDumpGroup.AddTasks(1);
+
+            queued = m_deferCompileMgr.AddTask(workload);
+
+            if (queued == false)
+            {
+                m_telemetryDumpGroup.CompleteTask();
+            }
+        }
+
+        if (queued == false)
+        {
+            DumpTelemetryTask(this);
+        }
+    }
+}
+
 // =====================================================================================================================
 void PipelineCompiler::DestroyPipelineBinaryCache()
 {
     if (m_pBinaryCache != nullptr)
     {
+        StoreColorExportPrewarmList();
+
+        m_pBinaryCache->FreePipelineBinary(m_pColorExportPrewarmList);
+        m_pColorExportPrewarmList    = nullptr;
+        m_colorExportPrewarmListSize = 0;
+
+        const char* pExportFile = m_pPhysicalDevice->GetRuntimeSettings().pipelineCacheMappedArchiveExportFile;
+
+        if (pExportFile[0] != '\0')
+        {
+            m_pBinaryCache->ExportMappedArchive(pExportFile);
+        }
+
         m_pBinaryCache->Destroy();
         m_pBinaryCache = nullptr;
     }
@@ -389,7 +527,21 @@ VkResult PipelineCompiler::Initialize()
 
     if (result == VK_SUCCESS)
     {
-        result = PalToVkResult(m_shaderModuleHandleMap.Init());
+        if (settings.enableInstanceShaderModuleCache)
+        {
+            m_pShaderModuleCache =
+                m_pPhysicalDevice->VkInstance()->GetShaderModuleCache(settings.shaderModuleCacheMaxEntries);
+        }
+
+        // Fall back to a private cache if the instance-wide one is disabled or unavailable.
+        if (m_pShaderModuleCache == nullptr)
+        {
+            result = ShaderModuleCache::Create(m_pPhysicalDevice->VkInstance(),
+                                               settings.shaderModuleCacheMaxEntries,
+                                               &m_pShaderModuleCache);
+
+            m_ownsShaderModuleCache = (result == VK_SUCCESS);
+        }
     }
 
     if (result == VK_SUCCESS)
@@ -407,6 +559,14 @@ VkResult PipelineCompiler::Initialize()
         result = InitializeUberFetchShaderFormatTable(m_pPhysicalDevice, &m_uberFetchShaderInfoFormatMap);
     }
 
+    if (result == VK_SUCCESS)
+    {
+        m_deferCompileMgr.Init(settings.pipelineCreateThreadCount, m_pPhysicalDevice->VkInstance()->Allocator());
+
+        m_telemetryDumpGroupReady = (settings.pipelineTelemetryDumpInterval != 0) &&
+                                    (m_telemetryDumpGroup.Init() == Util::Result::Success);
+    }
+
     return result;
 }
 
@@ -419,33 +579,33 @@ void PipelineCompiler::Destroy()
 
     m_compilerSolutionLlpc.Destroy();
 
-    DestroyPipelineBinaryCache();
-
-    auto pInstance = m_pPhysicalDevice->Manager()->VkInstance();
+    DumpBinaryCacheStats();
 
-    Util::MutexAuto mutexLock(&m_cacheLock);
-    if (SupportInternalModuleCache(m_pPhysicalDevice, GetCompilerCollectionMask(), 0))
+    if (m_pPhysicalDevice->GetRuntimeSettings().pipelineTelemetryDumpInterval != 0)
     {
-        for (auto it = m_shaderModuleHandleMap.Begin(); it.Get() != nullptr; it.Next())
+        if (m_telemetryDumpGroupReady)
         {
-            VK_ASSERT(it.Get()->value.pRefCount != nullptr);
-            // Free shader module regardless ref count, as the whole map is being destroyed.
-            VK_ALERT((*(it.Get()->value.pRefCount)) != 1);
-            *(it.Get()->value.pRefCount) = 0;
+            // The queued dump references this compiler.
+            WaitDeferCompileGroup(&m_telemetryDumpGroup);
+        }
+
+        DumpTelemetry();
+    }
 
-            // Force use un-lock version of FreeShaderModule.
-            pInstance->FreeMem(it.Get()->value.pRefCount);
-            it.Get()->value.pRefCount = nullptr;
-            FreeShaderModule(&it.Get()->value);
+    DestroyPipelineBinaryCache();
 
-        }
-        m_shaderModuleHandleMap.Reset();
+    if (m_ownsShaderModuleCache)
+    {
+        m_pShaderModuleCache->Destroy();
     }
 
+    m_pShaderModuleCache    = nullptr;
+    m_ownsShaderModuleCache = false;
+
     for (auto it = m_colorExportShaderMap.Begin(); it.Get() != nullptr; it.Next())
     {
         // Destory color export shader library
-        it.Get()->value->Destroy();
+        it.Get()->value.pShaderLibrary->Destroy();
     }
     m_colorExportShaderMap.Reset();
 }
@@ -506,6 +666,8 @@ Util::MetroHash::Hash PipelineCompiler::GetShaderModuleCacheHash(
     hasher.Update(compilerMask);
     hasher.Update(uniqueHash);
     hasher.Update(m_pPhysicalDevice->GetSettingsLoader()->GetSettingsHash());
+    // Modules may be shared across physical devices through the instance-wide cache.
+    hasher.Update(m_gfxIp);
     hasher.Finalize(hash.bytes);
     return hash;
 }
@@ -530,65 +692,33 @@ VkResult PipelineCompiler::LoadShaderModuleFromCache(
     {
         const Util::MetroHash::Hash shaderModuleCacheHash =
             GetShaderModuleCacheHash(flags, compilerMask, uniqueHash);
-        ShaderModuleHandle* pHandleInShaderModuleHandleMap = nullptr;
 
         const void*  pShaderModuleBinary = nullptr;
         size_t       shaderModuleSize    = 0;
         Util::Result cacheResult         = Util::Result::NotFound;
 
-        // 1. Look up in internal cache m_shaderModuleHandleMap.
-        if (supportInternalModuleCache)
+        // 1. Look up in runtime shader module cache.
+        if (supportInternalModuleCache && m_pShaderModuleCache->Find(shaderModuleCacheHash, pShaderModule))
         {
-            Util::MutexAuto mutexLock(&m_cacheLock);
-
-            pHandleInShaderModuleHandleMap = m_shaderModuleHandleMap.FindKey(shaderModuleCacheHash);
-            if ((pHandleInShaderModuleHandleMap != nullptr) && IsValidShaderModule(pHandleInShaderModuleHandleMap))
-            {
-                VK_ASSERT(pHandleInShaderModuleHandleMap->pRefCount != nullptr);
-                (*(pHandleInShaderModuleHandleMap->pRefCount))++;
-                *pShaderModule = *pHandleInShaderModuleHandleMap;
-                result         = VK_SUCCESS;
-                cacheResult    = Util::Result::Success;
-            }
+            result      = VK_SUCCESS;
+            cacheResult = Util::Result::Success;
         }
 
+        m_telemetry.RecordShaderModuleLookup(cacheResult == Util::Result::Success);
+
         // 3. Look up in internal cache m_pBinaryCache
         if ((cacheResult != Util::Result::Success) && (m_pBinaryCache != nullptr) && supportInternalModuleCache)
         {
         }
 
-        // 4. Relocate shader and setup reference counter if cache hits and not come from m_shaderModuleHandleMap.
+        // 4. Relocate shader and setup reference counter if cache hits and not come from the runtime cache.
         if ((result != VK_SUCCESS) && (cacheResult == Util::Result::Success))
         {
 
             if ((result == VK_SUCCESS) && supportInternalModuleCache && (delayConversion == false))
             {
-                Instance* pInstance = m_pPhysicalDevice->VkInstance();
-                pShaderModule->pRefCount = reinterpret_cast<uint32_t*>(
-                    pInstance->AllocMem(sizeof(uint32_t), VK_DEFAULT_MEM_ALIGN, VK_SYSTEM_ALLOCATION_SCOPE_CACHE));
-                if (pShaderModule->pRefCount != nullptr)
-                {
-                    Util::MutexAuto mutexLock(&m_cacheLock);
-
-                    // Initialize the reference count to two: one for the runtime cache and one for this shader module.
-                    *pShaderModule->pRefCount = 2;
-                    if (pHandleInShaderModuleHandleMap == nullptr)
-                    {
-                        result = PalToVkResult(m_shaderModuleHandleMap.Insert(shaderModuleCacheHash, *pShaderModule));
-                    }
-                    else
-                    {
-                        *pHandleInShaderModuleHandleMap = *pShaderModule;
-                    }
-                    VK_ASSERT(result == VK_SUCCESS);
-
-                    if (result != VK_SUCCESS)
-                    {
-                        // In case map insertion fails for any reason, free the allocated memory.
-                        pInstance->FreeMem(pShaderModule->pRefCount);
-                        pShaderModule->pRefCount = nullptr;
-                    }
-                }
+                result = m_pShaderModuleCache->Insert(shaderModuleCacheHash, pShaderModule);
+                VK_ASSERT(result == VK_SUCCESS);
             }
         }
     }
@@ -615,25 +745,10 @@ void PipelineCompiler::StoreShaderModuleToCache(
         const Util::MetroHash::Hash shaderModuleCacheHash =
             GetShaderModuleCacheHash(flags, compilerMask, uniqueHash);
 
-        // 2. Store in internal cache m_shaderModuleHandleMap and m_pBinaryCache
+        // 2. Store in runtime shader module cache and m_pBinaryCache
         if (supportInternalModuleCache)
         {
-            Instance* pInstance = m_pPhysicalDevice->VkInstance();
-            pShaderModule->pRefCount = reinterpret_cast<uint32_t*>(
-                pInstance->AllocMem(sizeof(uint32_t), VK_DEFAULT_MEM_ALIGN, VK_SYSTEM_ALLOCATION_SCOPE_CACHE));
-            if (pShaderModule->pRefCount != nullptr)
-            {
-                Util::MutexAuto mutexLock(&m_cacheLock);
-                // Initialize the reference count to two: one for the runtime cache and one for this shader module.
-                *pShaderModule->pRefCount = 2;
-                auto palResult = m_shaderModuleHandleMap.Insert(shaderModuleCacheHash, *pShaderModule);
-                if (palResult != Util::Result::Success)
-                {
-                    // In case map insertion fails for any reason, free the allocated memory.
-                    pInstance->FreeMem(pShaderModule->pRefCount);
-                    pShaderModule->pRefCount = nullptr;
-                }
-            }
+            m_pShaderModuleCache->Insert(shaderModuleCacheHash, pShaderModule);
 
             if (m_pBinaryCache != nullptr)
             {
@@ -643,12 +758,14 @@ void PipelineCompiler::StoreShaderModuleToCache(
 }
 
 // =====================================================================================================================
-// Builds shader module from SPIR-V binary code.
+// Builds shader module from SPIR-V binary code. If the caller already has the module's code hash (see
+// ShaderModule::BuildCodeHash), it is used as the module cache key instead of hashing the SPIR-V again.
 VkResult PipelineCompiler::BuildShaderModule(
     const Device*                   pDevice,
     const ShaderModuleFlags         flags,
     const Vkgc::BinaryData&         shaderBinary,
-    ShaderModuleHandle*             pShaderModule)
+    ShaderModuleHandle*             pShaderModule,
+    const Pal::ShaderHash*          pCodeHash)
 {
     const RuntimeSettings* pSettings = &m_pPhysicalDevice->GetRuntimeSettings();
     auto pInstance = m_pPhysicalDevice->Manager()->VkInstance();
@@ -657,18 +774,29 @@ VkResult PipelineCompiler::BuildShaderModule(
     Util::MetroHash::Hash stableHash = {};
     Util::MetroHash::Hash uniqueHash = {};
 
-    Util::MetroHash64 hasher;
-    hasher.Update(reinterpret_cast<const uint8_t*>(shaderBinary.pCode), shaderBinary.codeSize);
-    hasher.Finalize(stableHash.bytes);
-    hasher.Finalize(uniqueHash.bytes);
+    const bool replaceShaders = (pSettings->shaderReplaceMode == ShaderReplaceShaderHash) ||
+                                (pSettings->shaderReplaceMode == ShaderReplaceShaderHashPipelineBinaryHash);
+
+    if ((pCodeHash != nullptr) && (replaceShaders == false))
+    {
+        uniqueHash.qwords[0] = pCodeHash->lower;
+        uniqueHash.qwords[1] = pCodeHash->upper;
+    }
+    else
+    {
+        // Replacement shaders are named after the 64-bit hash of the SPIR-V, so it is needed in that mode anyway.
+        Util::MetroHash64 hasher;
+        hasher.Update(reinterpret_cast<const uint8_t*>(shaderBinary.pCode), shaderBinary.codeSize);
+        hasher.Finalize(stableHash.bytes);
+        hasher.Finalize(uniqueHash.bytes);
+    }
 
     bool findReplaceShader = false;
 
     ShaderModuleFlags shaderFlags = flags;
 
     Vkgc::BinaryData finalData = shaderBinary;
-    if ((pSettings->shaderReplaceMode == ShaderReplaceShaderHash) ||
-        (pSettings->shaderReplaceMode == ShaderReplaceShaderHashPipelineBinaryHash))
+    if (replaceShaders)
     {
         Vkgc::BinaryData replaceBinary = {};
         uint64_t hash64 = Util::MetroHash::Compact64(&stableHash);
@@ -732,12 +860,8 @@ void PipelineCompiler::FreeShaderModule(
 {
     if (pShaderModule->pRefCount != nullptr)
     {
-        Util::MutexAuto mutexLock(&m_cacheLock);
-        if (*pShaderModule->pRefCount > 1)
-        {
-            (*pShaderModule->pRefCount)--;
-        }
-        else
+        // The reference count is shared with the runtime shader module cache, the last reference frees the module.
+        if (Util::AtomicDecrement(pShaderModule->pRefCount) == 0)
         {
             m_compilerSolutionLlpc.FreeShaderModule(pShaderModule);
             auto pInstance = m_pPhysicalDevice->Manager()->VkInstance();
@@ -979,6 +1103,7 @@ Util::Result PipelineCompiler::GetCachedPipelineBinary(
 {
     Util::Result cacheResult = Util::Result::NotFound;
     int64_t      startTime   = Util::GetPerfCpuTime();
+    int64_t      phaseTime   = startTime;
 
     if (pPipelineBinaryCache != nullptr)
     {
@@ -989,6 +1114,8 @@ Util::Result PipelineCompiler::GetCachedPipelineBinary(
             *pIsUserCacheHit = true;
             pPipelineFeedback->hitApplicationCache = true;
         }
+
+        phaseTime = RecordPipelineCreationPhase(pPipelineFeedback, PipelineCreationPhaseAppCacheLookup, phaseTime);
     }
     m_pipelineCacheMatrix.cacheAttempts++;
 
@@ -1010,8 +1137,12 @@ Util::Result PipelineCompiler::GetCachedPipelineBinary(
         {
             *pIsInternalCacheHit = true;
         }
+
+        phaseTime = RecordPipelineCreationPhase(pPipelineFeedback, PipelineCreationPhaseInternalCacheLookup, phaseTime);
     }
-    m_pipelineCacheMatrix.totalTimeSpent += Util::GetPerfCpuTime() - startTime;
+    m_pipelineCacheMatrix.totalTimeSpent += phaseTime - startTime;
+    m_telemetry.RecordPipelineCacheLookup(*pIsUserCacheHit, *pIsInternalCacheHit);
+    DumpTelemetryIfDue();
     if (*pIsUserCacheHit || *pIsInternalCacheHit)
     {
         *pFreeCompilerBinary = FreeWithInstanceAllocator;
@@ -1037,6 +1168,12 @@ void PipelineCompiler::CachePipelineBinary(
 {
     Util::Result cacheResult;
 
+    if (((pPipelineBinaryCache != nullptr) && (isUserCacheHit == false)) ||
+        ((m_pBinaryCache != nullptr) && (isInternalCacheHit == false)))
+    {
+        m_telemetry.RecordPipelineStore(pPipelineBinary->codeSize);
+    }
+
     if ((pPipelineBinaryCache != nullptr) && (isUserCacheHit == false))
     {
         cacheResult = pPipelineBinaryCache->StorePipelineBinary(
@@ -1162,6 +1299,7 @@ VkResult PipelineCompiler::CreateGraphicsPipelineBinary(
 
     m_pipelineCacheMatrix.totalTimeSpent += compileTime;
     m_pipelineCacheMatrix.totalBinaries++;
+    RecordPipelineCompile(PipelineTelemetryType::Graphics, compileTime);
 
     DumpCacheMatrix(m_pPhysicalDevice,
         "Pipeline_runtime",
@@ -1270,11 +1408,12 @@ VkResult PipelineCompiler::CreateColorExportShaderLibrary(
 
     // Look up cache with respect to the hash
     {
-        Util::MutexAuto mutexLock(&m_cacheLock);
-        Pal::IShaderLibrary** ppCachedColExpLib = m_colorExportShaderMap.FindKey(cacheId);
-        if (ppCachedColExpLib != nullptr)
+        Util::RWLockAuto<Util::RWLock::ReadOnly> lock(&m_colorExportShaderLock);
+        ColorExportShaderEntry* pCachedEntry = m_colorExportShaderMap.FindKey(cacheId);
+        if (pCachedEntry != nullptr)
         {
-            *ppColExpLib = *ppCachedColExpLib;
+            *ppColExpLib = pCachedEntry->pShaderLibrary;
+            Util::AtomicIncrement(&pCachedEntry->useCount);
             cacheHit = true;
         }
     }
@@ -1361,10 +1500,31 @@ VkResult PipelineCompiler::CreateColorExportShaderLibrary(
             if (result == VK_SUCCESS)
             {
                 VK_ASSERT(*ppColExpLib != nullptr);
-                // Store the color export shader into cache
-                Util::MutexAuto mutexLock(&m_cacheLock);
-                result = PalToVkResult(m_colorExportShaderMap.Insert(cacheId, *ppColExpLib));
-                VK_ASSERT(result == VK_SUCCESS);
+
+                Util::RWLockAuto<Util::RWLock::ReadWrite> lock(&m_colorExportShaderLock);
+
+                // The prewarm or another pipeline may have created the same library meanwhile; use the cached one so
+                // that every user shares the library the map owns.
+                ColorExportShaderEntry* pCachedEntry = m_colorExportShaderMap.FindKey(cacheId);
+
+                if (pCachedEntry != nullptr)
+                {
+                    (*ppColExpLib)->Destroy();
+                    pAllocator->pfnFree(pAllocator->pUserData, *ppColExpLib);
+
+                    *ppColExpLib = pCachedEntry->pShaderLibrary;
+                    Util::AtomicIncrement(&pCachedEntry->useCount);
+                }
+                else
+                {
+                    // Store the color export shader into cache
+                    ColorExportShaderEntry entry = {};
+                    entry.pShaderLibrary = *ppColExpLib;
+                    entry.useCount       = 1;
+
+                    result = PalToVkResult(m_colorExportShaderMap.Insert(cacheId, entry));
+                    VK_ASSERT(result == VK_SUCCESS);
+                }
             }
         }
 
@@ -1386,6 +1546,369 @@ VkResult PipelineCompiler::CreateColorExportShaderLibrary(
     return result;
 }
 
+// =====================================================================================================================
+// Returns the internal binary cache ID of the given generation of the recorded color export shader list.  Archive
+// layers can't evict entries, so an updated list is never stored over the old one but as the next generation.
+void PipelineCompiler::GetColorExportPrewarmListId(
+    uint32_t               generation,
+    Util::MetroHash::Hash* pListId)
+{
+    static constexpr char ListName[] = "ColorExportPrewarmList";
+
+    Util::MetroHash128 hasher;
+
+    hasher.Update(reinterpret_cast<const uint8_t*>(ListName), sizeof(ListName));
+    hasher.Update(ColorExportPrewarmListVersion);
+    hasher.Update(generation);
+    hasher.Finalize(pListId->bytes);
+}
+
+// =====================================================================================================================
+// Returns true if the internal binary cache holds the given generation of the recorded color export shader list.
+bool PipelineCompiler::HasColorExportPrewarmList(
+    uint32_t generation) const
+{
+    Util::MetroHash::Hash listId = {};
+    Util::QueryResult     query  = {};
+
+    GetColorExportPrewarmListId(generation, &listId);
+
+    return (m_pBinaryCache->QueryPipelineBinary(&listId, 0, &query) == Util::Result::Success);
+}
+
+// =====================================================================================================================
+// Returns the number of generations of the recorded color export shader list in the internal binary cache.  The
+// generations are stored in order, so the newest one is found with a galloping search.
+uint32_t PipelineCompiler::GetColorExportPrewarmListGenerationCount() const
+{
+    uint32_t present = 0; // Generations known to be stored
+    uint32_t absent  = 0; // Lowest generation count known to be too high
+
+    if (HasColorExportPrewarmList(0))
+    {
+        present = 1;
+        absent  = 2;
+
+        while ((absent < MaxColorExportPrewarmListGenerations) && HasColorExportPrewarmList(absent - 1))
+        {
+            present = absent;
+            absent  = Util::Min(absent * 2, MaxColorExportPrewarmListGenerations);
+        }
+
+        while ((absent - present) > 1)
+        {
+            const uint32_t mid = present + ((absent - present) / 2);
+
+            if (HasColorExportPrewarmList(mid - 1))
+            {
+                present = mid;
+            }
+            else
+            {
+                absent = mid;
+            }
+        }
+    }
+
+    return present;
+}
+
+// =====================================================================================================================
+// Starts loading the color export shader libraries recorded by previous runs on the defer compile threads, so the
+// first GPL links using them find them in m_colorExportShaderMap instead of stalling on the binary cache lookup and
+// shader library creation.  Only the first device created on this physical device starts the prewarm, and it must
+// call WaitForColorExportShaderPrewarm() before it is destroyed.
+void PipelineCompiler::PrewarmColorExportShaderLibraries(
+    const Device* pDevice)
+{
+    const uint32_t maxEntries = m_pPhysicalDevice->GetRuntimeSettings().colorExportPrewarmMaxEntries;
+
+    Util::MutexAuto lock(&m_colorExportPrewarmLock);
+
+    if ((maxEntries > 0) && (m_pBinaryCache != nullptr) && (m_colorExportPrewarmStarted == false))
+    {
+        m_colorExportPrewarmStarted = true;
+
+        Util::MetroHash::Hash listId = {};
+        const void*           pList  = nullptr;
+
+        m_colorExportPrewarmListGenerations = GetColorExportPrewarmListGenerationCount();
+
+        if (m_colorExportPrewarmListGenerations > 0)
+        {
+            GetColorExportPrewarmListId(m_colorExportPrewarmListGenerations - 1, &listId);
+
+            if (m_pBinaryCache->LoadPipelineBinary(&listId, &m_colorExportPrewarmListSize, &pList) ==
+                Util::Result::Success)
+            {
+                m_pColorExportPrewarmList = const_cast<void*>(pList);
+            }
+        }
+
+        uint32_t count = 0;
+
+        if (m_pColorExportPrewarmList != nullptr)
+        {
+            const auto* pHeader = static_cast<const ColorExportPrewarmListHeader*>(m_pColorExportPrewarmList);
+
+            if ((m_colorExportPrewarmListSize >= sizeof(ColorExportPrewarmListHeader)) &&
+                (pHeader->version == ColorExportPrewarmListVersion) &&
+                (m_colorExportPrewarmListSize ==
+                 sizeof(ColorExportPrewarmListHeader) + (pHeader->count * sizeof(Util::MetroHash::Hash))))
+            {
+                count = Util::Min(pHeader->count, maxEntries);
+            }
+            else
+            {
+                // Not a list this driver wrote; forget it so it is neither used nor merged into the next list.
+                m_pBinaryCache->FreePipelineBinary(m_pColorExportPrewarmList);
+                m_pColorExportPrewarmList    = nullptr;
+                m_colorExportPrewarmListSize = 0;
+            }
+        }
+
+        // The prewarm is only worth doing off the calling thread
+        uint32_t taskCount = Util::Min(GetDeferCompileThreadCount(), count);
+
+        if ((taskCount > 0) && (m_colorExportPrewarmGroup.Init() != Util::Result::Success))
+        {
+            taskCount = 0;
+        }
+
+        if (taskCount > 0)
+        {
+            m_colorExportPrewarm.pCompiler = this;
+            m_colorExportPrewarm.pDevice   = pDevice;
+            m_colorExportPrewarm.pCacheIds = static_cast<const Util::MetroHash::Hash*>(
+                Util::VoidPtrInc(m_pColorExportPrewarmList, sizeof(ColorExportPrewarmListHeader)));
+            m_colorExportPrewarm.count     = count;
+            m_colorExportPrewarm.nextIndex = 0;
+
+            DeferredCompileWorkload workload = {};
+            workload.pPayloads = &m_colorExportPrewarm;
+            workload.Execute   = &PrewarmColorExportShaderLibraryTask;
+            workload.pGroup    = &m_colorExportPrewarmGroup;
+            workload.priority  = DeferCompilePriority::Normal;
+
+            m_colorExportPrewarmActive = true;
+            m_colorExportPrewarmGroup.AddTasks(taskCount);
+
+            for (uint32_t i = 0; i < taskCount; ++i)
+            {
+                ExecuteDeferCompile(&workload);
+            }
+        }
+    }
+}
+
+// =====================================================================================================================
+// Stops the color export shader prewarm started by the given device, if any, and waits for its tasks to finish.
+void PipelineCompiler::WaitForColorExportShaderPrewarm(
+    const Device* pDevice)
+{
+    Util::MutexAuto lock(&m_colorExportPrewarmLock);
+
+    if (m_colorExportPrewarmActive && (m_colorExportPrewarm.pDevice == pDevice))
+    {
+        // Skip the libraries not loaded yet
+        Util::AtomicExchange(&m_colorExportPrewarm.nextIndex, m_colorExportPrewarm.count);
+
+        WaitDeferCompileGroup(&m_colorExportPrewarmGroup);
+
+        m_colorExportPrewarmActive   = false;
+        m_colorExportPrewarm.pDevice = nullptr;
+    }
+}
+
+// =====================================================================================================================
+// Defer compile task loading recorded color export shader libraries until the list is exhausted.
+void PipelineCompiler::PrewarmColorExportShaderLibraryTask(
+    void* pPayload)
+{
+    ColorExportPrewarmState* pState = static_cast<ColorExportPrewarmState*>(pPayload);
+
+    uint32_t index = Util::AtomicIncrement(&pState->nextIndex) - 1;
+
+    while (index < pState->count)
+    {
+        pState->pCompiler->LoadColorExportShaderLibrary(pState->pDevice, pState->pCacheIds[index]);
+
+        index = Util::AtomicIncrement(&pState->nextIndex) - 1;
+    }
+}
+
+// =====================================================================================================================
+// Creates the color export shader library of the given cache ID from the internal binary cache, if it is not loaded
+// yet.  Variants missing from the binary cache are skipped; they are compiled on first use as before.
+void PipelineCompiler::LoadColorExportShaderLibrary(
+    const Device*                pDevice,
+    const Util::MetroHash::Hash& cacheId)
+{
+    bool loaded = false;
+
+    {
+        Util::RWLockAuto<Util::RWLock::ReadOnly> lock(&m_colorExportShaderLock);
+        loaded = (m_colorExportShaderMap.FindKey(cacheId) != nullptr);
+    }
+
+    if (loaded == false)
+    {
+        Vkgc::BinaryData   colExpPackage    = {};
+        bool               hitAppCache      = false;
+        bool               hitInternalCache = false;
+        FreeCompilerBinary freeMethod       = FreeWithCompiler;
+
+        GetCachedPipelineBinary(
+            &cacheId, nullptr, &colExpPackage, &hitAppCache, &hitInternalCache, &freeMethod, nullptr);
+
+        if (hitInternalCache)
+        {
+            const VkAllocationCallbacks* pAllocator = pDevice->VkInstance()->GetAllocCallbacks();
+            Pal::IShaderLibrary*         pColExpLib = nullptr;
+
+            VkResult result = CreateGraphicsShaderLibrary(pDevice, colExpPackage, pAllocator, &pColExpLib);
+
+            if (result == VK_SUCCESS)
+            {
+                Util::RWLockAuto<Util::RWLock::ReadWrite> lock(&m_colorExportShaderLock);
+
+                // A pipeline may have created the same library meanwhile
+                if (m_colorExportShaderMap.FindKey(cacheId) == nullptr)
+                {
+                    ColorExportShaderEntry entry = {};
+                    entry.pShaderLibrary = pColExpLib;
+                    entry.useCount       = 0;
+
+                    result = PalToVkResult(m_colorExportShaderMap.Insert(cacheId, entry));
+                }
+                else
+                {
+                    result = VK_INCOMPLETE;
+                }
+            }
+
+            if ((result != VK_SUCCESS) && (pColExpLib != nullptr))
+            {
+                pColExpLib->Destroy();
+                pAllocator->pfnFree(pAllocator->pUserData, pColExpLib);
+            }
+
+            FreeGraphicsPipelineBinary(PipelineCompilerTypeLlpc, freeMethod, colExpPackage);
+        }
+    }
+}
+
+// =====================================================================================================================
+// Records the color export shaders used in this run, most used first, followed by the ones recorded by previous runs,
+// in the internal binary cache as the next generation of the list.  Nothing is stored if the set of shaders has not
+// changed.
+void PipelineCompiler::StoreColorExportPrewarmList()
+{
+    const uint32_t maxEntries = m_pPhysicalDevice->GetRuntimeSettings().colorExportPrewarmMaxEntries;
+    Instance*      pInstance  = m_pPhysicalDevice->Manager()->VkInstance();
+
+    if ((maxEntries > 0) && (m_pBinaryCache != nullptr))
+    {
+        struct ColorExportUse
+        {
+            Util::MetroHash::Hash cacheId;
+            uint32_t              useCount;
+        };
+
+        Util::Vector<ColorExportUse, 16, PalAllocator> uses(pInstance->Allocator());
+        Util::Result                                   result = Util::Result::Success;
+
+        for (auto it = m_colorExportShaderMap.Begin(); (it.Get() != nullptr) && (result == Util::Result::Success);
+             it.Next())
+        {
+            if (it.Get()->value.useCount > 0)
+            {
+                ColorExportUse use = {};
+                use.cacheId  = it.Get()->key;
+                use.useCount = it.Get()->value.useCount;
+
+                result = uses.PushBack(use);
+            }
+        }
+
+        if ((result == Util::Result::Success) && (uses.NumElements() > 0))
+        {
+            std::sort(&uses[0], &uses[0] + uses.NumElements(),
+                [](const ColorExportUse& lhs, const ColorExportUse& rhs) { return lhs.useCount > rhs.useCount; });
+        }
+
+        const ColorExportPrewarmListHeader* pOldHeader =
+            static_cast<const ColorExportPrewarmListHeader*>(m_pColorExportPrewarmList);
+        const Util::MetroHash::Hash*        pOldIds    = (pOldHeader != nullptr) ?
+            static_cast<const Util::MetroHash::Hash*>(Util::VoidPtrInc(pOldHeader, sizeof(*pOldHeader))) : nullptr;
+        const uint32_t                      oldCount   = (pOldHeader != nullptr) ? pOldHeader->count : 0;
+
+        const size_t maxListSize = sizeof(ColorExportPrewarmListHeader) + (maxEntries * sizeof(Util::MetroHash::Hash));
+        void*        pList       = (result == Util::Result::Success) ?
+            pInstance->AllocMem(maxListSize, VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) : nullptr;
+
+        if (pList != nullptr)
+        {
+            auto* pHeader = static_cast<ColorExportPrewarmListHeader*>(pList);
+            auto* pIds    = static_cast<Util::MetroHash::Hash*>(Util::VoidPtrInc(pList, sizeof(*pHeader)));
+
+            pHeader->version = ColorExportPrewarmListVersion;
+            pHeader->count   = 0;
+
+            // Returns true if the first count IDs of pIdList hold the given cache ID
+            auto Contains = [](const Util::MetroHash::Hash* pIdList, uint32_t count, const Util::MetroHash::Hash& id)
+            {
+                bool found = false;
+
+                for (uint32_t i = 0; (i < count) && (found == false); ++i)
+                {
+                    found = (memcmp(&pIdList[i], &id, sizeof(id)) == 0);
+                }
+
+                return found;
+            };
+
+            for (uint32_t i = 0; (i < uses.NumElements()) && (pHeader->count < maxEntries); ++i)
+            {
+                pIds[pHeader->count++] = uses[i].cacheId;
+            }
+
+            for (uint32_t i = 0; (i < oldCount) && (pHeader->count < maxEntries); ++i)
+            {
+                if (Contains(pIds, pHeader->count, pOldIds[i]) == false)
+                {
+                    pIds[pHeader->count++] = pOldIds[i];
+                }
+            }
+
+            bool changed = (pHeader->count != oldCount);
+
+            for (uint32_t i = 0; (i < pHeader->count) && (changed == false); ++i)
+            {
+                changed = (Contains(pOldIds, oldCount, pIds[i]) == false);
+            }
+
+            if (changed && (pHeader->count > 0) &&
+                ((m_colorExportPrewarmListGenerations + 1) < MaxColorExportPrewarmListGenerations))
+            {
+                Util::MetroHash::Hash listId = {};
+
+                // Older generations are left in place, evicting them would leave holes in the generation sequence.
+                GetColorExportPrewarmListId(m_colorExportPrewarmListGenerations, &listId);
+
+                result = m_pBinaryCache->StorePipelineBinary(
+                    &listId,
+                    sizeof(ColorExportPrewarmListHeader) + (pHeader->count * sizeof(Util::MetroHash::Hash)),
+                    pList);
+
+                VK_ALERT(result != Util::Result::Success);
+            }
+
+            pInstance->FreeMem(pList);
+        }
+    }
+}
+
 // =====================================================================================================================
 // Create shader library object based on pipeline information
 VkResult PipelineCompiler::CreateGraphicsShaderLibrary(
@@ -1522,6 +2045,7 @@ VkResult PipelineCompiler::CreateComputePipelineBinary(
 
     m_pipelineCacheMatrix.totalTimeSpent += compileTime;
     m_pipelineCacheMatrix.totalBinaries++;
+    RecordPipelineCompile(PipelineTelemetryType::Compute, compileTime);
 
     DumpCacheMatrix(m_pPhysicalDevice,
         "Pipeline_runtime",
@@ -1593,6 +2117,36 @@ void PipelineCompiler::UpdatePipelineCreationFeedback(
     }
 }
 
+// =====================================================================================================================
+// Adds the CPU time elapsed since startTime to the given phase of the feedback, if any.  Upload is nested in other
+// phases, so its time is remembered and taken out of the next phase recorded, which is the one that enclosed it.
+// Returns the current CPU timestamp so that consecutive phases can be chained.
+int64_t PipelineCompiler::RecordPipelineCreationPhase(
+    PipelineCreationFeedback* pPipelineFeedback,
+    PipelineCreationPhase     phase,
+    int64_t                   startTime)
+{
+    const int64_t currentTime = Util::GetPerfCpuTime();
+
+    if (pPipelineFeedback != nullptr)
+    {
+        const uint64_t elapsed = vk::utils::TicksToNano(currentTime - startTime);
+
+        if (phase == PipelineCreationPhaseUpload)
+        {
+            pPipelineFeedback->phaseDuration[phase] += elapsed;
+            pPipelineFeedback->nestedDuration       += elapsed;
+        }
+        else
+        {
+            pPipelineFeedback->phaseDuration[phase] += elapsed - Util::Min(elapsed, pPipelineFeedback->nestedDuration);
+            pPipelineFeedback->nestedDuration        = 0;
+        }
+    }
+
+    return currentTime;
+}
+
 // =====================================================================================================================
 VkResult PipelineCompiler::SetPipelineCreationFeedbackInfo(
     const VkPipelineCreationFeedbackCreateInfoEXT* pPipelineCreationFeedbackCreateInfo,
@@ -2890,6 +3444,7 @@ VkResult PipelineCompiler::UploadInternalBufferData(
     GraphicsPipelineBinaryCreateInfo* pCreateInfo)
 {
     VkResult result = VK_SUCCESS;
+    const int64_t startTime = Util::GetPerfCpuTime();
     PipelineInternalBufferInfo* pInternalBufferInfo = &pCreateInfo->pBinaryMetadata->internalBufferInfo;
     if (pInternalBufferInfo->dataSize > 0)
     {
@@ -2956,6 +3511,8 @@ VkResult PipelineCompiler::UploadInternalBufferData(
         } while (deviceGroup.IterateNext());
     }
 
+    RecordPipelineCreationPhase(&pCreateInfo->pipelineFeedback, PipelineCreationPhaseUpload, startTime);
+
     return result;
 }
 
@@ -4386,6 +4943,7 @@ VkResult PipelineCompiler::CreateRayTracingPipelineBinary(
 
     m_pipelineCacheMatrix.totalTimeSpent += compileTime;
     m_pipelineCacheMatrix.totalBinaries++;
+    RecordPipelineCompile(PipelineTelemetryType::RayTracing, compileTime);
 
     DumpCacheMatrix(m_pPhysicalDevice,
         "Pipeline_runtime",
@@ -5121,18 +5679,18 @@ void PipelineCompiler::BuildPipelineInternalBufferData(
 void PipelineCompiler::ExecuteDeferCompile(
     DeferredCompileWorkload* pWorkload)
 {
-    auto pThread = m_deferCompileMgr.GetCompileThread();
-    if (pThread != nullptr)
-    {
-        pThread->AddTask(pWorkload);
-    }
-    else
+    if (m_deferCompileMgr.AddTask(*pWorkload) == false)
     {
         pWorkload->Execute(pWorkload->pPayloads);
         if (pWorkload->pEvent != nullptr)
         {
             pWorkload->pEvent->Set();
         }
+
+        if (pWorkload->pGroup != nullptr)
+        {
+            pWorkload->pGroup->CompleteTask();
+        }
     }
 }
 
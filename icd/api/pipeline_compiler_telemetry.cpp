@@ -0,0 +1,260 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  pipeline_compiler_telemetry.cpp
+* @brief Implementation of the pipeline compiler telemetry counters.
+***********************************************************************************************************************
+*/
+
+#include "include/pipeline_compiler_telemetry.h"
+#include "include/defer_compile_thread.h"
+#include "include/pipeline_binary_cache.h"
+
+#include "palJsonWriter.h"
+#include "palSysUtil.h"
+
+namespace vk
+{
+
+static constexpr const char* PipelineTelemetryTypeNames[] =
+{
+    "graphics",
+    "graphicsLibrary",
+    "compute",
+    "rayTracing",
+};
+
+static_assert(VK_ARRAY_SIZE(PipelineTelemetryTypeNames) == static_cast<uint32_t>(PipelineTelemetryType::Count),
+              "Update PipelineTelemetryTypeNames!");
+
+static constexpr const char* PipelineCreationPhaseNames[] =
+{
+    "apiHashUs",
+    "cacheIdUs",
+    "convertInfoUs",
+    "appCacheLookupUs",
+    "internalCacheLookupUs",
+    "compileUs",
+    "uploadUs",
+    "palCreateUs",
+};
+
+static_assert(VK_ARRAY_SIZE(PipelineCreationPhaseNames) == PipelineCreationPhaseCount,
+              "Update PipelineCreationPhaseNames!");
+
+// =====================================================================================================================
+PipelineCompilerTelemetry::PipelineCompilerTelemetry()
+    :
+    m_perfFrequency       (Util::GetPerfFrequency()),
+    m_startTime           (Util::GetPerfCpuTime()),
+    m_pipelineLookups     (0),
+    m_appCacheHits        (0),
+    m_internalCacheHits   (0),
+    m_pipelineStores      (0),
+    m_pipelineStoredBytes (0),
+    m_shaderModuleLookups (0),
+    m_shaderModuleHits    (0),
+    m_lastDumpMs          (0),
+    m_compiles            {},
+    m_creations           {}
+{
+}
+
+// =====================================================================================================================
+void PipelineCompilerTelemetry::RecordPipelineCacheLookup(
+    bool appCacheHit,
+    bool internalCacheHit)
+{
+    Util::AtomicIncrement64(&m_pipelineLookups);
+
+    if (appCacheHit)
+    {
+        Util::AtomicIncrement64(&m_appCacheHits);
+    }
+    else if (internalCacheHit)
+    {
+        Util::AtomicIncrement64(&m_internalCacheHits);
+    }
+}
+
+// =====================================================================================================================
+void PipelineCompilerTelemetry::RecordPipelineCompile(
+    PipelineTelemetryType type,
+    int64_t               cpuTicks)
+{
+    VK_ASSERT(type < PipelineTelemetryType::Count);
+
+    CompileCounters* pCounters = &m_compiles[static_cast<uint32_t>(type)];
+
+    const uint64_t us     = static_cast<uint64_t>(Util::Max(cpuTicks, int64_t(0)) * 1000000 / m_perfFrequency);
+    const uint32_t bucket = (us == 0) ? 0 : Util::Min(Util::Log2(us) + 1, CompileTimeBucketCount - 1);
+
+    Util::AtomicIncrement64(&pCounters->count);
+    Util::AtomicAdd64(&pCounters->totalUs, us);
+    Util::AtomicIncrement64(&pCounters->histogram[bucket]);
+}
+
+// =====================================================================================================================
+// Accumulates the total and per-phase durations of a successfully created pipeline.
+void PipelineCompilerTelemetry::RecordPipelineCreation(
+    PipelineTelemetryType           type,
+    const PipelineCreationFeedback& feedback)
+{
+    VK_ASSERT(type < PipelineTelemetryType::Count);
+
+    CreationCounters* pCounters = &m_creations[static_cast<uint32_t>(type)];
+
+    Util::AtomicIncrement64(&pCounters->count);
+    Util::AtomicAdd64(&pCounters->totalNs, feedback.duration);
+
+    for (uint32_t phase = 0; phase < PipelineCreationPhaseCount; ++phase)
+    {
+        if (feedback.phaseDuration[phase] != 0)
+        {
+            Util::AtomicAdd64(&pCounters->phaseNs[phase], feedback.phaseDuration[phase]);
+        }
+    }
+}
+
+// =====================================================================================================================
+void PipelineCompilerTelemetry::RecordPipelineStore(
+    size_t dataSize)
+{
+    Util::AtomicIncrement64(&m_pipelineStores);
+    Util::AtomicAdd64(&m_pipelineStoredBytes, dataSize);
+}
+
+// =====================================================================================================================
+void PipelineCompilerTelemetry::RecordShaderModuleLookup(
+    bool hit)
+{
+    Util::AtomicIncrement64(&m_shaderModuleLookups);
+
+    if (hit)
+    {
+        Util::AtomicIncrement64(&m_shaderModuleHits);
+    }
+}
+
+// =====================================================================================================================
+// Returns true at most once per interval, to the first caller after the interval has elapsed.
+bool PipelineCompilerTelemetry::ShouldDump(
+    uint32_t intervalMs)
+{
+    const uint32_t nowMs  = static_cast<uint32_t>((Util::GetPerfCpuTime() - m_startTime) * 1000 / m_perfFrequency);
+    const uint32_t lastMs = m_lastDumpMs;
+
+    return ((nowMs - lastMs) >= intervalMs) &&
+           (Util::AtomicCompareAndSwap(&m_lastDumpMs, lastMs, nowMs) == lastMs);
+}
+
+// =====================================================================================================================
+// Writes a snapshot of the counters, the lookup statistics of the internal binary cache and the state of the deferred
+// compile thread pool as a JSON object. The counters keep changing while they are written, so the snapshot is not
+// guaranteed to be consistent across counters.
+void PipelineCompilerTelemetry::Write(
+    Util::JsonWriter*          pWriter,
+    const PipelineBinaryCache* pBinaryCache,
+    const DeferCompileStats&   deferCompileStats) const
+{
+    VK_ASSERT(pWriter != nullptr);
+
+    pWriter->BeginMap(false);
+
+    pWriter->KeyAndBeginMap("pipelineCache", false);
+    pWriter->KeyAndValue("lookups",           m_pipelineLookups);
+    pWriter->KeyAndValue("appCacheHits",      m_appCacheHits);
+    pWriter->KeyAndValue("internalCacheHits", m_internalCacheHits);
+    pWriter->KeyAndValue("misses",            m_pipelineLookups - m_appCacheHits - m_internalCacheHits);
+    pWriter->KeyAndValue("stores",            m_pipelineStores);
+    pWriter->KeyAndValue("storedBytes",       m_pipelineStoredBytes);
+    pWriter->EndMap();
+
+    if (pBinaryCache != nullptr)
+    {
+        pWriter->Key("internalCache");
+        pBinaryCache->DumpStats(pWriter);
+    }
+
+    pWriter->KeyAndBeginMap("shaderModuleCache", false);
+    pWriter->KeyAndValue("lookups", m_shaderModuleLookups);
+    pWriter->KeyAndValue("hits",    m_shaderModuleHits);
+    pWriter->EndMap();
+
+    pWriter->KeyAndBeginMap("compileTime", false);
+
+    for (uint32_t type = 0; type < static_cast<uint32_t>(PipelineTelemetryType::Count); ++type)
+    {
+        const CompileCounters& counters = m_compiles[type];
+
+        pWriter->KeyAndBeginMap(PipelineTelemetryTypeNames[type], false);
+        pWriter->KeyAndValue("count",   counters.count);
+        pWriter->KeyAndValue("totalUs", counters.totalUs);
+        pWriter->KeyAndBeginList("log2UsHistogram", true);
+
+        for (uint32_t bucket = 0; bucket < CompileTimeBucketCount; ++bucket)
+        {
+            pWriter->Value(counters.histogram[bucket]);
+        }
+
+        pWriter->EndList();
+        pWriter->EndMap();
+    }
+
+    pWriter->EndMap();
+
+    pWriter->KeyAndBeginMap("creationPhases", false);
+
+    for (uint32_t type = 0; type < static_cast<uint32_t>(PipelineTelemetryType::Count); ++type)
+    {
+        const CreationCounters& counters = m_creations[type];
+
+        pWriter->KeyAndBeginMap(PipelineTelemetryTypeNames[type], false);
+        pWriter->KeyAndValue("count",   counters.count);
+        pWriter->KeyAndValue("totalUs", counters.totalNs / 1000);
+
+        for (uint32_t phase = 0; phase < PipelineCreationPhaseCount; ++phase)
+        {
+            pWriter->KeyAndValue(PipelineCreationPhaseNames[phase], counters.phaseNs[phase] / 1000);
+        }
+
+        pWriter->EndMap();
+    }
+
+    pWriter->EndMap();
+
+    pWriter->KeyAndBeginMap("deferCompile", false);
+    pWriter->KeyAndValue("queuedTasks",   deferCompileStats.queuedTasks);
+    pWriter->KeyAndValue("executedTasks", deferCompileStats.executedTasks);
+    pWriter->KeyAndValue("stolenTasks",   deferCompileStats.stolenTasks);
+    pWriter->KeyAndValue("queueDepth",    deferCompileStats.queueDepth);
+    pWriter->KeyAndValue("maxQueueDepth", deferCompileStats.maxQueueDepth);
+    pWriter->EndMap();
+
+    pWriter->EndMap();
+}
+
+} // namespace vk
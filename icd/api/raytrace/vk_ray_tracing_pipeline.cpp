@@ -50,6 +50,8 @@
 #include "gpurt/gpurt.h"
 #include "vkgcDefs.h"
 
+using namespace std::chrono_literals;
+
 namespace vk
 {
 
@@ -447,6 +449,114 @@ VkResult RayTracingPipeline::Destroy(
     return result;
 }
 
+// =====================================================================================================================
+// State shared by all threads creating the PAL shader libraries (one per indirect function and device) of a pipeline.
+struct ShaderLibraryCreatePayload
+{
+    Device*                         pDevice;
+    const RayTracingPipelineBinary* pPipelineBinaries;  // Per-device pipeline binaries
+    uint32_t                        binaryOffset;       // Index of the first indirect function binary
+    uint32_t                        funcCount;          // Number of indirect functions per device
+    size_t                          shaderLibrarySize;
+    void*                           pShaderLibraryMem;  // PAL object memory for all devices' shader libraries
+    Pal::IShaderLibrary**           ppShaderLibraries;  // Output shader libraries for all devices
+    volatile uint32_t               palResult;          // First failure reported by any task
+    DeferredWorkload*               pWorkload;          // Workload the tasks are distributed through (may be null)
+};
+
+// =====================================================================================================================
+// Creates the PAL shader library for a single indirect function of a single device.
+static void CreateShaderLibraryTask(
+    ShaderLibraryCreatePayload* pPayload,
+    uint32_t                    taskIdx)
+{
+    const uint32_t deviceIdx = taskIdx / pPayload->funcCount;
+    const uint32_t funcIdx   = taskIdx % pPayload->funcCount;
+
+    if (pPayload->palResult == static_cast<uint32_t>(Pal::Result::Success))
+    {
+        const Vkgc::BinaryData& binary =
+            pPayload->pPipelineBinaries[deviceIdx].pPipelineBins[funcIdx + pPayload->binaryOffset];
+
+        VK_ASSERT((binary.pCode != nullptr) && (binary.codeSize != 0));
+
+        Pal::ShaderLibraryCreateInfo shaderLibraryCreateInfo = {};
+        shaderLibraryCreateInfo.pCodeObject    = binary.pCode;
+        shaderLibraryCreateInfo.codeObjectSize = binary.codeSize;
+
+        Pal::Result palResult = pPayload->pDevice->PalDevice(deviceIdx)->CreateShaderLibrary(
+            shaderLibraryCreateInfo,
+            Util::VoidPtrInc(pPayload->pShaderLibraryMem, pPayload->shaderLibrarySize * taskIdx),
+            &pPayload->ppShaderLibraries[taskIdx]);
+
+        if (palResult != Pal::Result::Success)
+        {
+            pPayload->ppShaderLibraries[taskIdx] = nullptr;
+
+            Util::AtomicCompareAndSwap(&pPayload->palResult,
+                                       static_cast<uint32_t>(Pal::Result::Success),
+                                       static_cast<uint32_t>(palResult));
+        }
+    }
+}
+
+// =====================================================================================================================
+// Workload entry point for deferred operation worker threads (and the pipeline main thread) picking up shader library
+// creation tasks.  Returns once no unclaimed tasks remain.
+static void ExecuteShaderLibraryCreateWorkload(
+    void* pPayloads)
+{
+    ShaderLibraryCreatePayload* pPayload  = static_cast<ShaderLibraryCreatePayload*>(pPayloads);
+    DeferredWorkload*           pWorkload = pPayload->pWorkload;
+
+    uint32_t taskIdx = Util::AtomicIncrement(&pWorkload->nextInstance) - 1;
+
+    while (taskIdx < pWorkload->totalInstances)
+    {
+        CreateShaderLibraryTask(pPayload, taskIdx);
+
+        if (Util::AtomicIncrement(&pWorkload->completedInstances) == pWorkload->totalInstances)
+        {
+            pWorkload->event.Set();
+        }
+
+        taskIdx = Util::AtomicIncrement(&pWorkload->nextInstance) - 1;
+    }
+}
+
+// =====================================================================================================================
+// Creates the shader libraries of all devices.  If the pipeline is created through a deferred operation, the tasks are
+// published through its workload so that joining threads can help; otherwise they are run on the calling thread.
+static Pal::Result CreateShaderLibraries(
+    ShaderLibraryCreatePayload* pPayload,
+    uint32_t                    taskCount)
+{
+    DeferredWorkload* pWorkload = pPayload->pWorkload;
+
+    if (pWorkload != nullptr)
+    {
+        pWorkload->Execute   = &ExecuteShaderLibraryCreateWorkload;
+        pWorkload->pPayloads = pPayload;
+        Util::AtomicExchange(&pWorkload->totalInstances, taskCount);
+
+        ExecuteShaderLibraryCreateWorkload(pPayload);
+
+        while (pWorkload->completedInstances < pWorkload->totalInstances)
+        {
+            pWorkload->event.Wait(1s);
+        }
+    }
+    else
+    {
+        for (uint32_t taskIdx = 0; taskIdx < taskCount; ++taskIdx)
+        {
+            CreateShaderLibraryTask(pPayload, taskIdx);
+        }
+    }
+
+    return static_cast<Pal::Result>(pPayload->palResult);
+}
+
 // =====================================================================================================================
 // Create a ray tracing pipeline object.
 VkResult RayTracingPipeline::CreateImpl(
@@ -454,7 +564,7 @@ VkResult RayTracingPipeline::CreateImpl(
     const VkRayTracingPipelineCreateInfoKHR* pCreateInfo,
     VkPipelineCreateFlags2KHR                flags,
     const VkAllocationCallbacks*             pAllocator,
-    DeferredWorkload*                        pDeferredWorkload)
+    DeferredWorkload*                        pDeferredWorkloads)
 {
     uint64 startTimeTicks = Util::GetPerfCpuTime();
 
@@ -537,7 +647,8 @@ VkResult RayTracingPipeline::CreateImpl(
 
         PipelineCompiler* pDefaultCompiler = m_pDevice->GetCompiler(DefaultDeviceIndex);
 
-        binaryCreateInfo.pDeferredWorkload = pDeferredWorkload;
+        binaryCreateInfo.pDeferredWorkload = (pDeferredWorkloads != nullptr) ?
+            &pDeferredWorkloads[DeferredWorkloadCompile] : nullptr;
 
         auto pPipelineCreationFeedbackCreateInfo = extStructs.pPipelineCreationFeedbackCreateInfoEXT;
 
@@ -774,7 +885,8 @@ VkResult RayTracingPipeline::CreateImpl(
                     &apiPsoHash,
                     &elfHash,
                     pTempModules,
-                    cacheId);
+                    cacheId,
+                    &binaryCreateInfo.pipelineFeedback);
 
                 binaryCreateInfo.apiPsoHash = apiPsoHash;
             }
@@ -886,6 +998,8 @@ VkResult RayTracingPipeline::CreateImpl(
             VkResult convertResult = VK_ERROR_UNKNOWN;
             if (shouldConvert)
             {
+                const int64_t convertStartTime = Util::GetPerfCpuTime();
+
                 convertResult = pDefaultCompiler->ConvertRayTracingPipelineInfo(
                     m_pDevice,
                     &pipelineCreateInfo,
@@ -896,6 +1010,9 @@ VkResult RayTracingPipeline::CreateImpl(
                     &optimizerKey,
                     &binaryCreateInfo);
                 result = (result == VK_SUCCESS) ? convertResult : result;
+
+                PipelineCompiler::RecordPipelineCreationPhase(
+                    &binaryCreateInfo.pipelineFeedback, PipelineCreationPhaseConvertInfo, convertStartTime);
             }
 
             if ((result == VK_SUCCESS) &&
@@ -931,6 +1048,8 @@ VkResult RayTracingPipeline::CreateImpl(
             // Compile if unable to retrieve from cache.
             if ((result == VK_SUCCESS) && (cacheResult != Util::Result::Success))
             {
+                const int64_t compileStartTime = Util::GetPerfCpuTime();
+
                 result = pDefaultCompiler->CreateRayTracingPipelineBinary(
                     m_pDevice,
                     deviceIdx,
@@ -939,6 +1058,9 @@ VkResult RayTracingPipeline::CreateImpl(
                     &pipelineBinaries[deviceIdx],
                     &cacheId[deviceIdx]);
 
+                PipelineCompiler::RecordPipelineCreationPhase(
+                    &binaryCreateInfo.pipelineFeedback, PipelineCreationPhaseCompile, compileStartTime);
+
                 // Add the pipeline to any cache layer where it's missing.
                 if (result == VK_SUCCESS)
                 {
@@ -1207,7 +1329,8 @@ VkResult RayTracingPipeline::CreateImpl(
 
         if (result == VK_SUCCESS)
         {
-            Pal::Result palResult = Pal::Result::Success;
+            const int64_t palCreateStartTime = Util::GetPerfCpuTime();
+            Pal::Result   palResult          = Pal::Result::Success;
 
             // ppShaderLibraries will be later used (via ~RayTracingPipeline()) to free pSystemMem
             ppShaderLibraries = static_cast<Pal::IShaderLibrary**>(pSystemMem);
@@ -1234,14 +1357,43 @@ VkResult RayTracingPipeline::CreateImpl(
             memcpy(pShaderOptKeys, optimizerKey.pShaders, shaderOptKeysSize);
             optimizerKey.pShaders = static_cast<ShaderOptimizerKey*>(pShaderOptKeys);
 
+            // Create the shader libraries of all devices up front.  These are independent of each other, so when the
+            // pipeline is deferred they are handed out as separate tasks to the threads joining the operation.
+            if (funcCount > 0)
+            {
+                ShaderLibraryCreatePayload shaderLibraryPayload = {};
+                shaderLibraryPayload.pDevice           = m_pDevice;
+                shaderLibraryPayload.pPipelineBinaries = pipelineBinaries;
+                shaderLibraryPayload.binaryOffset      = hasKernelEntry ? 1 : 0;
+                shaderLibraryPayload.funcCount         = funcCount;
+                shaderLibraryPayload.shaderLibrarySize = shaderLibrarySize;
+                shaderLibraryPayload.pShaderLibraryMem = pPalShaderLibraryMem;
+                shaderLibraryPayload.ppShaderLibraries = ppShaderLibraries;
+                shaderLibraryPayload.palResult         = static_cast<uint32_t>(Pal::Result::Success);
+                shaderLibraryPayload.pWorkload         = (pDeferredWorkloads != nullptr) ?
+                    &pDeferredWorkloads[DeferredWorkloadShaderLibrary] : nullptr;
+
+                palResult = CreateShaderLibraries(&shaderLibraryPayload, funcCount * m_pDevice->NumPalDevices());
+
+                if (palResult != Pal::Result::Success)
+                {
+                    for (uint32_t i = 0; i < (funcCount * m_pDevice->NumPalDevices()); ++i)
+                    {
+                        if (ppShaderLibraries[i] != nullptr)
+                        {
+                            ppShaderLibraries[i]->Destroy();
+                            ppShaderLibraries[i] = nullptr;
+                        }
+                    }
+                }
+            }
+
             for (uint32_t deviceIdx = 0;
                 ((deviceIdx < m_pDevice->NumPalDevices()) && (palResult == Pal::Result::Success));
                 deviceIdx++)
             {
                 const auto pBinaries               = pipelineBinaries[deviceIdx].pPipelineBins;
                 const auto ppDeviceShaderLibraries = ppShaderLibraries + deviceIdx * funcCount;
-                void*      pDeviceShaderLibraryMem = Util::VoidPtrInc(pPalShaderLibraryMem,
-                                                                      deviceIdx * funcCount * shaderLibrarySize);
 
                 VK_ASSERT(pipelineSize ==
                     m_pDevice->PalDevice(deviceIdx)->GetComputePipelineSize(localPipelineInfo.pipeline, nullptr));
@@ -1307,31 +1459,16 @@ VkResult RayTracingPipeline::CreateImpl(
                     stackSizeFactor = (shaderStats.common.flags.isWave32 == 0) ? 2 : 1;
                 }
 
-                // Create shader library and remap shader ID to indirect function GPU Va
+                // Remap shader ID to indirect function GPU Va of the shader libraries created above
                 if (palResult == Util::Result::Success)
                 {
-                    uint32_t binaryOffset = hasKernelEntry ? 1 : 0;
-                    for (uint32_t i = 0; (i < funcCount) && (palResult == Util::Result::Success); ++i)
+                    for (uint32_t i = 0; i < funcCount; ++i)
                     {
-                        VK_ASSERT((pBinaries[i + binaryOffset].pCode != nullptr) &&
-                                  (pBinaries[i + binaryOffset].codeSize != 0));
-                        Pal::ShaderLibraryCreateInfo shaderLibraryCreateInfo = {};
-                        shaderLibraryCreateInfo.pCodeObject = pBinaries[i + binaryOffset].pCode;
-                        shaderLibraryCreateInfo.codeObjectSize = pBinaries[i + binaryOffset].codeSize;
-
-                        palResult = m_pDevice->PalDevice(deviceIdx)->CreateShaderLibrary(
-                            shaderLibraryCreateInfo,
-                            Util::VoidPtrInc(pDeviceShaderLibraryMem, shaderLibrarySize * i),
-                            &ppDeviceShaderLibraries[i]);
-
-                        if (palResult == Util::Result::Success)
-                        {
-                            const auto pFunctionInfo = ppDeviceShaderLibraries[i]->GetShaderLibFunctionInfos().Data();
-                            pIndirectFuncInfo[i].symbolName  = pFunctionInfo[0].symbolName;
-                            pIndirectFuncInfo[i].gpuVirtAddr = pFunctionInfo[0].gpuVirtAddr;
+                        const auto pFunctionInfo = ppDeviceShaderLibraries[i]->GetShaderLibFunctionInfos().Data();
+                        pIndirectFuncInfo[i].symbolName  = pFunctionInfo[0].symbolName;
+                        pIndirectFuncInfo[i].gpuVirtAddr = pFunctionInfo[0].gpuVirtAddr;
 
-                            m_totalShaderLibraryList[deviceIdx].PushBack(ppDeviceShaderLibraries[i]);
-                        }
+                        m_totalShaderLibraryList[deviceIdx].PushBack(ppDeviceShaderLibraries[i]);
                     }
 
                     m_shaderStageDataList[deviceIdx].Resize(totalShaderCount);
@@ -1852,6 +1989,9 @@ VkResult RayTracingPipeline::CreateImpl(
             }
 
             result = PalToVkResult(palResult);
+
+            PipelineCompiler::RecordPipelineCreationPhase(
+                &binaryCreateInfo.pipelineFeedback, PipelineCreationPhasePalCreate, palCreateStartTime);
         }
 
         if (result == VK_SUCCESS)
@@ -1906,6 +2046,19 @@ VkResult RayTracingPipeline::CreateImpl(
                 }
             }
 
+            // The shader libraries are created up front, before the pipelines; destroy the ones that were created.
+            if (ppShaderLibraries != nullptr)
+            {
+                for (uint32_t i = 0; i < (funcCount * m_pDevice->NumPalDevices()); ++i)
+                {
+                    if (ppShaderLibraries[i] != nullptr)
+                    {
+                        ppShaderLibraries[i]->Destroy();
+                        ppShaderLibraries[i] = nullptr;
+                    }
+                }
+            }
+
             if (pShaderGroups[0] != nullptr)
             {
                 pAllocator->pfnFree(pAllocator->pUserData, pShaderGroups[0]);
@@ -1959,6 +2112,9 @@ VkResult RayTracingPipeline::CreateImpl(
             binaryCreateInfo.pipelineFeedback.feedbackValid = true;
             binaryCreateInfo.pipelineFeedback.duration      = duration;
 
+            pDefaultCompiler->GetTelemetry()->RecordPipelineCreation(
+                PipelineTelemetryType::RayTracing, binaryCreateInfo.pipelineFeedback);
+
             PipelineCompiler::SetPipelineCreationFeedbackInfo(
                 pPipelineCreationFeedbackCreateInfo,
                 0,
@@ -1986,9 +2142,11 @@ VkResult RayTracingPipeline::CreateCacheId(
     uint64_t*                                   pApiPsoHash,
     Util::MetroHash::Hash*                      pElfHash,
     ShaderModuleHandle*                         pTempModules,
-    Util::MetroHash::Hash*                      pCacheIds)
+    Util::MetroHash::Hash*                      pCacheIds,
+    PipelineCreationFeedback*                   pPipelineFeedback)
 {
-    VkResult result = VK_SUCCESS;
+    VkResult result    = VK_SUCCESS;
+    int64_t  phaseTime = Util::GetPerfCpuTime();
 
     // 1. Build shader stage info
     if (pPipelineOptimizerKey->shaderCount > 0)
@@ -2041,8 +2199,13 @@ VkResult RayTracingPipeline::CreateCacheId(
 
         VK_ASSERT(shaderIdx == pPipelineOptimizerKey->shaderCount);
 
+        phaseTime = PipelineCompiler::RecordPipelineCreationPhase(
+            pPipelineFeedback, PipelineCreationPhaseCacheId, phaseTime);
+
         // 3. Build API and ELF hashes
         BuildApiHash(pCreateInfo, flags, pElfHash, pApiPsoHash);
+        phaseTime = PipelineCompiler::RecordPipelineCreationPhase(
+            pPipelineFeedback, PipelineCreationPhaseApiHash, phaseTime);
 
         // 4. Build Cache IDs
         for (uint32_t deviceIdx = 0; deviceIdx < pDevice->NumPalDevices(); deviceIdx++)
@@ -2057,6 +2220,8 @@ VkResult RayTracingPipeline::CreateCacheId(
         }
     }
 
+    PipelineCompiler::RecordPipelineCreationPhase(pPipelineFeedback, PipelineCreationPhaseCacheId, phaseTime);
+
     return result;
 }
 
@@ -2094,7 +2259,7 @@ static int32_t DeferredCreateRayTracingPipelineCallback(
                                                         pCreateInfo,
                                                         flags,
                                                         pState->pAllocator,
-                                                        pOperation->Workload(index));
+                                                        pOperation->Workload(index * DeferredWorkloadCount));
 
                     if (localResult == VK_SUCCESS)
                     {
@@ -2127,9 +2292,14 @@ static int32_t DeferredCreateRayTracingPipelineCallback(
                 }
 
                 // If the workloads for this pipeline are still pending (after creation), then no-op them at this point
-                Util::AtomicCompareAndSwap(&pOperation->Workload(index)->totalInstances,
-                                           UINT_MAX,
-                                           0);
+                DeferredWorkload* pWorkloads = pOperation->Workload(index * DeferredWorkloadCount);
+
+                for (uint32_t type = 0; type < DeferredWorkloadCount; ++type)
+                {
+                    Util::AtomicCompareAndSwap(&pWorkloads[type].totalInstances,
+                                               UINT_MAX,
+                                               0);
+                }
 
                 Util::AtomicIncrement(&pState->completed);
 
@@ -2137,9 +2307,9 @@ static int32_t DeferredCreateRayTracingPipelineCallback(
             }
         }
 
-        // Helper worker threads go through here. They assist the main pipeline threads. Currently, the only workloads
-        // we have are the compute pipeline library creations. Helper threads return when no work is available to
-        // execute.
+        // Helper worker threads go through here. They assist the main pipeline threads with the per-pipeline workloads
+        // (LLPC ELF builds and PAL shader library creation, see DeferredWorkloadType). Helper threads return when no
+        // work is available to execute.
         for (uint32_t workloadIdx = 0; workloadIdx < pOperation->WorkloadCount(); ++workloadIdx)
         {
             DeferredHostOperation::ExecuteWorkload(pOperation->Workload(workloadIdx));
@@ -2175,16 +2345,24 @@ static int32_t DeferredCreateRayTracingPipelineCallback(
     {
         uint32_t maxConcurrency = pState->infoCount - Util::Min(pState->nextPending, pState->infoCount);
 
-        for (uint32_t workloadIdx = 0; workloadIdx < pOperation->WorkloadCount(); ++workloadIdx)
+        for (uint32_t workloadIdx = 0; workloadIdx < pOperation->WorkloadCount(); workloadIdx += DeferredWorkloadCount)
         {
-            const DeferredWorkload* pWorkload = pOperation->Workload(workloadIdx);
-            uint32_t totalInstances = pWorkload->totalInstances;
+            // The workloads of a pipeline run one after another, so only the widest of them counts
+            uint32_t pipelineConcurrency = 1;
+
+            for (uint32_t type = 0; type < DeferredWorkloadCount; ++type)
+            {
+                const DeferredWorkload* pWorkload = pOperation->Workload(workloadIdx + type);
+                uint32_t totalInstances = pWorkload->totalInstances;
 
-            uint32_t workloadConcurrency = (totalInstances == UINT_MAX) ? pWorkload->maxInstances :
-                (totalInstances - Util::Min(pWorkload->nextInstance, totalInstances));
+                uint32_t workloadConcurrency = (totalInstances == UINT_MAX) ? pWorkload->maxInstances :
+                    (totalInstances - Util::Min(pWorkload->nextInstance, totalInstances));
+
+                pipelineConcurrency = Util::Max(pipelineConcurrency, workloadConcurrency);
+            }
 
             // Subtract one, as it will be executed on the pipeline main thread
-            maxConcurrency += Util::Max(workloadConcurrency, static_cast<uint32_t>(1)) - 1;
+            maxConcurrency += pipelineConcurrency - 1;
         }
 
         result = maxConcurrency;
@@ -2594,16 +2772,21 @@ VkResult RayTracingPipeline::Create(
         pState->pAllocator     = pAllocator;
         pState->pPipelines     = pPipelines;
 
-        finalResult = pDeferredOperation->GenerateWorkloads(count);
+        finalResult = pDeferredOperation->GenerateWorkloads(count * DeferredWorkloadCount);
 
         if (finalResult == VK_SUCCESS)
         {
             for (uint32_t i = 0; i < count; ++i)
             {
-                DeferredWorkload* pWorkload = pDeferredOperation->Workload(i);
+                DeferredWorkload* pWorkloads = pDeferredOperation->Workload(i * DeferredWorkloadCount);
+
+                pWorkloads[DeferredWorkloadCompile].totalInstances = UINT_MAX;
+                pWorkloads[DeferredWorkloadCompile].maxInstances   = pCreateInfos[i].stageCount + 2;
 
-                pWorkload->totalInstances = UINT_MAX;
-                pWorkload->maxInstances = pCreateInfos[i].stageCount + 2;
+                // One shader library per indirect function and device
+                pWorkloads[DeferredWorkloadShaderLibrary].totalInstances = UINT_MAX;
+                pWorkloads[DeferredWorkloadShaderLibrary].maxInstances   =
+                    pCreateInfos[i].stageCount * pDevice->NumPalDevices();
             }
         }
     }
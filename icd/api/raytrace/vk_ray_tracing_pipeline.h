@@ -59,6 +59,16 @@ class PipelineCache;
 
 static constexpr uint64_t RayTracingInvalidShaderId = 0;
 
+// Deferred host operation workloads generated for each pipeline of a deferred vkCreateRayTracingPipelinesKHR call.
+// The workloads of a pipeline are contiguous and run one after another on the pipeline's main thread, with joining
+// threads helping out.
+enum DeferredWorkloadType : uint32_t
+{
+    DeferredWorkloadCompile = 0,    // LLPC helper thread tasks for building the pipeline ELFs
+    DeferredWorkloadShaderLibrary,  // PAL shader library creation for each indirect function
+    DeferredWorkloadCount
+};
+
 typedef Util::Vector<VkPipelineShaderStageCreateInfo, 16, PalAllocator>       ShaderStageList;
 typedef Util::Vector<VkRayTracingShaderGroupCreateInfoKHR, 16, PalAllocator>  ShaderGroupList;
 
@@ -211,7 +221,7 @@ public:
         const VkRayTracingPipelineCreateInfoKHR* pCreateInfo,
         VkPipelineCreateFlags2KHR                flags,
         const VkAllocationCallbacks*             pAllocator,
-        DeferredWorkload*                        pDeferredWorkload);
+        DeferredWorkload*                        pDeferredWorkloads);
 
     static VkResult CreateCacheId(
         const Device*                               pDevice,
@@ -223,7 +233,8 @@ public:
         uint64_t*                                   pApiPsoHash,
         Util::MetroHash::Hash*                      pElfHash,
         ShaderModuleHandle*                         pTempModule,
-        Util::MetroHash::Hash*                      pCacheIds);
+        Util::MetroHash::Hash*                      pCacheIds,
+        PipelineCreationFeedback*                   pPipelineFeedback = nullptr);
 
     void BindToCmdBuffer(
         CmdBuffer*                           pCmdBuffer,
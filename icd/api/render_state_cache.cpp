@@ -498,6 +498,7 @@ Pal::Result RenderStateCache::CreateStaticPalObjectState(
     VkSystemAllocationScope                 parentScope,
     InfoMap*                                pStateMap,
     RefMap*                                 pRefMap,
+    Util::RWLock*                           pLock,
     typename StateObject::PalObject*        pStates[MaxPalDevices])
 {
     if (IsEnabled(settingMask) == false)
@@ -510,7 +511,23 @@ Pal::Result RenderStateCache::CreateStaticPalObjectState(
     bool existed = false;
     StateObject** ppState = nullptr;
 
-    Util::MutexAuto lock(&m_mutex);
+    {
+        Util::RWLockAuto<Util::RWLock::ReadOnly> lock(pLock);
+
+        ppState = pStateMap->FindKey(createInfo);
+
+        if ((ppState != nullptr) && TryAddRef(&(*ppState)->refCount))
+        {
+            for (uint32_t deviceIdx = 0; deviceIdx < m_pDevice->NumPalDevices(); ++deviceIdx)
+            {
+                pStates[deviceIdx] = (*ppState)->pObjects[deviceIdx];
+            }
+
+            return result;
+        }
+    }
+
+    Util::RWLockAuto<Util::RWLock::ReadWrite> lock(pLock);
 
     // Map the createinfo to a pre-existing state object.  Allocate a new (empty) entry if one does not exist.
     result = pStateMap->FindAllocate(createInfo, &existed, &ppState);
@@ -591,7 +608,8 @@ void RenderStateCache::DestroyStaticPalObjectState(
     typename StateObject::PalObject** ppStates,
     const VkAllocationCallbacks*      pAllocator,
     InfoMap*                          pInfoMap,
-    RefMap*                           pRefMap)
+    RefMap*                           pRefMap,
+    Util::RWLock*                     pLock)
 {
     if ((ppStates == nullptr) || (ppStates[0] == nullptr))
     {
@@ -604,7 +622,19 @@ void RenderStateCache::DestroyStaticPalObjectState(
     }
     else
     {
-        Util::MutexAuto lock(&m_mutex);
+        {
+            Util::RWLockAuto<Util::RWLock::ReadOnly> lock(pLock);
+
+            auto** pValue = pRefMap->FindKey(ppStates[0]);
+
+            if ((pValue != nullptr) && TryReleaseRef(&(*pValue)->refCount))
+            {
+                return;
+            }
+        }
+
+        // Dropping the last reference removes the entry, which needs exclusive access to the maps
+        Util::RWLockAuto<Util::RWLock::ReadWrite> lock(pLock);
 
         // Find the state object containing the given PAL object.  This should always exist.
         auto** pValue = pRefMap->FindKey(ppStates[0]);
@@ -648,6 +678,7 @@ Pal::Result RenderStateCache::CreateMsaaState(
         parentScope,
         &m_msaaStates,
         &m_msaaRefs,
+        &m_msaaLock,
         pStates);
 }
 
@@ -663,7 +694,8 @@ void RenderStateCache::DestroyMsaaState(
         ppStates,
         pAllocator,
         &m_msaaStates,
-        &m_msaaRefs);
+        &m_msaaRefs,
+        &m_msaaLock);
 }
 
 // =====================================================================================================================
@@ -682,6 +714,7 @@ Pal::Result RenderStateCache::CreateColorBlendState(
         parentScope,
         &m_colorBlendStates,
         &m_colorBlendRefs,
+        &m_colorBlendLock,
         pStates);
 }
 
@@ -697,7 +730,8 @@ void RenderStateCache::DestroyColorBlendState(
         ppStates,
         pAllocator,
         &m_colorBlendStates,
-        &m_colorBlendRefs);
+        &m_colorBlendRefs,
+        &m_colorBlendLock);
 }
 
 // =====================================================================================================================
@@ -716,6 +750,7 @@ Pal::Result RenderStateCache::CreateDepthStencilState(
         parentScope,
         &m_depthStencilStates,
         &m_depthStencilRefs,
+        &m_depthStencilLock,
         pStates);
 }
 
@@ -731,7 +766,8 @@ void RenderStateCache::DestroyDepthStencilState(
         ppStates,
         pAllocator,
         &m_depthStencilStates,
-        &m_depthStencilRefs);
+        &m_depthStencilRefs,
+        &m_depthStencilLock);
 }
 
 // =====================================================================================================================
@@ -743,6 +779,52 @@ bool RenderStateCache::IsEnabled(
     return (staticStateFlag & m_pDevice->GetRuntimeSettings().optRenderStateCacheEnable) != 0;
 }
 
+// =====================================================================================================================
+// Takes another reference on a cached entry while the maps are only locked for reading.  Entries in the maps always
+// hold at least one reference, so this only fails when the count would overflow.
+bool RenderStateCache::TryAddRef(
+    uint32_t* pRefCount)
+{
+    uint32_t refCount = *static_cast<volatile uint32_t*>(pRefCount);
+
+    while (refCount < UINT_MAX)
+    {
+        const uint32_t prevRefCount = Util::AtomicCompareAndSwap(pRefCount, refCount, refCount + 1);
+
+        if (prevRefCount == refCount)
+        {
+            return true;
+        }
+
+        refCount = prevRefCount;
+    }
+
+    return false;
+}
+
+// =====================================================================================================================
+// Drops a reference on a cached entry while the maps are only locked for reading.  Fails without touching the count if
+// this would be the last reference, since removing the entry requires the maps to be locked for writing.
+bool RenderStateCache::TryReleaseRef(
+    uint32_t* pRefCount)
+{
+    uint32_t refCount = *static_cast<volatile uint32_t*>(pRefCount);
+
+    while (refCount > 1)
+    {
+        const uint32_t prevRefCount = Util::AtomicCompareAndSwap(pRefCount, refCount, refCount - 1);
+
+        if (prevRefCount == refCount)
+        {
+            return true;
+        }
+
+        refCount = prevRefCount;
+    }
+
+    return false;
+}
+
 // =====================================================================================================================
 // Template function for creating a cached mapping of a struct of parameters (for PAL CmdSet*) to a uint32_t token.
 template<typename ParamInfo, typename ParamHashMap>
@@ -750,13 +832,25 @@ uint32_t RenderStateCache::CreateStaticParamsState(
     uint32_t         enabledType,
     const ParamInfo& params,
     ParamHashMap*    pMap,
+    Util::RWLock*    pLock,
     uint32_t*        pNextId)
 {
     uint32_t token = DynamicRenderStateToken;
 
     if (IsEnabled(enabledType))
     {
-        Util::MutexAuto lock(&m_mutex);
+        {
+            Util::RWLockAuto<Util::RWLock::ReadOnly> lock(pLock);
+
+            StaticParamState* pState = pMap->FindKey(params);
+
+            if ((pState != nullptr) && TryAddRef(&pState->refCount))
+            {
+                return pState->paramToken;
+            }
+        }
+
+        Util::RWLockAuto<Util::RWLock::ReadWrite> lock(pLock);
 
         bool existed = false;
         StaticParamState* pState = nullptr;
@@ -803,11 +897,23 @@ void RenderStateCache::DestroyStaticParamsState(
     uint32_t         enabledType,
     const ParamInfo& params,
     uint32_t         token,
-    ParamHashMap*    pMap)
+    ParamHashMap*    pMap,
+    Util::RWLock*    pLock)
 {
     if (IsEnabled(enabledType) && (token != DynamicRenderStateToken))
     {
-        Util::MutexAuto lock(&m_mutex);
+        {
+            Util::RWLockAuto<Util::RWLock::ReadOnly> lock(pLock);
+
+            StaticParamState* pValue = pMap->FindKey(params);
+
+            if ((pValue != nullptr) && TryReleaseRef(&pValue->refCount))
+            {
+                return;
+            }
+        }
+
+        Util::RWLockAuto<Util::RWLock::ReadWrite> lock(pLock);
 
         StaticParamState* pValue = pMap->FindKey(params);
 
@@ -833,6 +939,7 @@ uint32_t RenderStateCache::CreateInputAssemblyState(
         OptRenderStateCacheInputAssemblyState,
         params,
         &m_inputAssemblyState,
+        &m_inputAssemblyStateLock,
         &m_inputAssemblyStateNextId);
 }
 
@@ -845,7 +952,8 @@ void RenderStateCache::DestroyInputAssemblyState(
         OptRenderStateCacheInputAssemblyState,
         params,
         token,
-        &m_inputAssemblyState);
+        &m_inputAssemblyState,
+        &m_inputAssemblyStateLock);
 }
 
 // =====================================================================================================================
@@ -856,6 +964,7 @@ uint32_t RenderStateCache::CreateTriangleRasterState(
         OptRenderStateCacheTriangleRasterState,
         params,
         &m_triangleRasterState,
+        &m_triangleRasterStateLock,
         &m_triangleRasterStateNextId);
 }
 
@@ -868,7 +977,8 @@ void RenderStateCache::DestroyTriangleRasterState(
         OptRenderStateCacheTriangleRasterState,
         params,
         token,
-        &m_triangleRasterState);
+        &m_triangleRasterState,
+        &m_triangleRasterStateLock);
 }
 
 // =====================================================================================================================
@@ -879,6 +989,7 @@ uint32_t RenderStateCache::CreatePointLineRasterState(
         OptRenderStateCacheStaticPointLineRasterState,
         params,
         &m_pointLineRasterState,
+        &m_pointLineRasterStateLock,
         &m_pointLineRasterStateNextId);
 }
 
@@ -891,7 +1002,8 @@ void RenderStateCache::DestroyPointLineRasterState(
         OptRenderStateCacheStaticPointLineRasterState,
         params,
         token,
-        &m_pointLineRasterState);
+        &m_pointLineRasterState,
+        &m_pointLineRasterStateLock);
 }
 
 // =====================================================================================================================
@@ -902,6 +1014,7 @@ uint32_t RenderStateCache::CreateDepthBias(
         OptRenderStateCacheStaticDepthBias,
         params,
         &m_depthBias,
+        &m_depthBiasLock,
         &m_depthBiasNextId);
 }
 
@@ -914,7 +1027,8 @@ void RenderStateCache::DestroyDepthBias(
         OptRenderStateCacheStaticDepthBias,
         params,
         token,
-        &m_depthBias);
+        &m_depthBias,
+        &m_depthBiasLock);
 }
 
 // =====================================================================================================================
@@ -925,6 +1039,7 @@ uint32_t RenderStateCache::CreateBlendConst(
         OptRenderStateCacheStaticBlendConst,
         params,
         &m_blendConst,
+        &m_blendConstLock,
         &m_blendConstNextId);
 }
 
@@ -937,7 +1052,8 @@ void RenderStateCache::DestroyBlendConst(
         OptRenderStateCacheStaticBlendConst,
         params,
         token,
-        &m_blendConst);
+        &m_blendConst,
+        &m_blendConstLock);
 }
 
 // =====================================================================================================================
@@ -948,6 +1064,7 @@ uint32_t RenderStateCache::CreateDepthBounds(
         OptRenderStateCacheStaticDepthBounds,
         params,
         &m_depthBounds,
+        &m_depthBoundsLock,
         &m_depthBoundsNextId);
 }
 
@@ -960,7 +1077,8 @@ void RenderStateCache::DestroyDepthBounds(
         OptRenderStateCacheStaticDepthBounds,
         params,
         token,
-        &m_depthBounds);
+        &m_depthBounds,
+        &m_depthBoundsLock);
 }
 
 // =====================================================================================================================
@@ -971,6 +1089,7 @@ uint32_t RenderStateCache::CreateViewport(
         OptRenderStateCacheStaticViewport,
         params,
         &m_viewport,
+        &m_viewportLock,
         &m_viewportNextId);
 }
 
@@ -983,7 +1102,8 @@ void RenderStateCache::DestroyViewport(
         OptRenderStateCacheStaticViewport,
         params,
         token,
-        &m_viewport);
+        &m_viewport,
+        &m_viewportLock);
 }
 
 // =====================================================================================================================
@@ -994,6 +1114,7 @@ uint32_t RenderStateCache::CreateScissorRect(
         OptRenderStateCacheStaticScissorRect,
         params,
         &m_scissorRect,
+        &m_scissorRectLock,
         &m_scissorRectNextId);
 }
 
@@ -1006,7 +1127,8 @@ void RenderStateCache::DestroyScissorRect(
         OptRenderStateCacheStaticScissorRect,
         params,
         token,
-        &m_scissorRect);
+        &m_scissorRect,
+        &m_scissorRectLock);
 }
 
 // =====================================================================================================================
@@ -1017,6 +1139,7 @@ uint32_t RenderStateCache::CreateLineStipple(
         OptRenderStateCacheStaticLineStipple,
         params,
         &m_lineStippleState,
+        &m_lineStippleStateLock,
         &m_lineStippleStateNextId);
 }
 
@@ -1029,7 +1152,8 @@ void RenderStateCache::DestroyLineStipple(
         OptRenderStateCacheStaticLineStipple,
         params,
         token,
-        &m_lineStippleState);
+        &m_lineStippleState,
+        &m_lineStippleStateLock);
 }
 
 // =====================================================================================================================
@@ -1040,6 +1164,7 @@ uint32_t RenderStateCache::CreateFragmentShadingRate(
         OptRenderStateFragmentShadingRate,
         params,
         &m_fragmentShadingRate,
+        &m_fragmentShadingRateLock,
         &m_fragmentShadingRateNextId);
 }
 
@@ -1052,7 +1177,8 @@ void RenderStateCache::DestroyFragmentShadingRate(
         OptRenderStateFragmentShadingRate,
         params,
         token,
-        &m_fragmentShadingRate);
+        &m_fragmentShadingRate,
+        &m_fragmentShadingRateLock);
 }
 
 };
@@ -0,0 +1,275 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+***********************************************************************************************************************
+* @file  shader_module_cache.cpp
+* @brief Runtime cache of built shader modules, keyed by module cache hash.
+***********************************************************************************************************************
+*/
+
+#include "include/shader_module_cache.h"
+#include "include/vk_instance.h"
+
+#include "palHashMapImpl.h"
+#include "palSysUtil.h"
+
+namespace vk
+{
+
+// =====================================================================================================================
+// Creates a store holding at most maxEntries modules (0 for no limit).
+VkResult ShaderModuleCache::Create(
+    Instance*           pInstance,
+    uint32_t            maxEntries,
+    ShaderModuleCache** ppCache)
+{
+    VkResult result = VK_SUCCESS;
+
+    void* pSystemMem = pInstance->AllocMem(sizeof(ShaderModuleCache) + (sizeof(Shard) * ShardCount),
+                                           VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+
+    if (pSystemMem == nullptr)
+    {
+        result = VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        ShaderModuleCache* pCache = VK_PLACEMENT_NEW(pSystemMem) ShaderModuleCache(pInstance, maxEntries);
+
+        result = pCache->Init();
+
+        if (result == VK_SUCCESS)
+        {
+            *ppCache = pCache;
+        }
+        else
+        {
+            pCache->Destroy();
+        }
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+ShaderModuleCache::ShaderModuleCache(
+    Instance* pInstance,
+    uint32_t  maxEntries)
+    :
+    m_pInstance(pInstance),
+    m_maxShardEntries((maxEntries > 0) ? Util::Max(maxEntries / ShardCount, 1u) : 0),
+    m_shards(static_cast<Shard*>(Util::VoidPtrInc(this, sizeof(ShaderModuleCache))))
+{
+    for (uint32_t i = 0; i < ShardCount; ++i)
+    {
+        VK_PLACEMENT_NEW(&m_shards[i]) Shard(pInstance->Allocator());
+    }
+}
+
+// =====================================================================================================================
+VkResult ShaderModuleCache::Init()
+{
+    VkResult result = VK_SUCCESS;
+
+    for (uint32_t i = 0; (i < ShardCount) && (result == VK_SUCCESS); ++i)
+    {
+        result = PalToVkResult(m_shards[i].handleMap.Init());
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+ShaderModuleCache::~ShaderModuleCache()
+{
+    for (uint32_t i = 0; i < ShardCount; ++i)
+    {
+        Util::Destructor(&m_shards[i]);
+    }
+}
+
+// =====================================================================================================================
+// Frees all cached modules regardless of their reference count, as the whole store is being destroyed.
+void ShaderModuleCache::Destroy()
+{
+    for (uint32_t i = 0; i < ShardCount; ++i)
+    {
+        Shard* pShard = &m_shards[i];
+
+        Util::MutexAuto mutexLock(&pShard->lock);
+
+        for (auto it = pShard->handleMap.Begin(); it.Get() != nullptr; it.Next())
+        {
+            ShaderModuleHandle* pHandle = &it.Get()->value;
+
+            VK_ASSERT(pHandle->pRefCount != nullptr);
+            VK_ALERT((*(pHandle->pRefCount)) != 1);
+
+            FreeModule(pHandle);
+        }
+
+        pShard->handleMap.Reset();
+    }
+
+    Instance* pInstance = m_pInstance;
+
+    Util::Destructor(this);
+
+    pInstance->FreeMem(this);
+}
+
+// =====================================================================================================================
+// Frees a module and its reference count, the module must not be referenced outside the store anymore.
+void ShaderModuleCache::FreeModule(
+    ShaderModuleHandle* pHandle)
+{
+    m_pInstance->FreeMem(pHandle->pRefCount);
+    pHandle->pRefCount = nullptr;
+
+    // The module data is allocated from the instance by the compiler's output allocator.
+    m_pInstance->FreeMem(pHandle->pLlpcShaderModule);
+    pHandle->pLlpcShaderModule = nullptr;
+}
+
+// =====================================================================================================================
+// Releases a module of the shard that is only referenced by the store. References are only added under the shard lock,
+// which the caller holds, so a module seen with a single reference can't be picked up concurrently. Returns false if
+// every module of the shard is still in use.
+bool ShaderModuleCache::EvictUnreferencedModule(
+    Shard* pShard)
+{
+    ShaderModuleHandle*   pVictim = nullptr;
+    Util::MetroHash::Hash victimKey;
+
+    for (auto it = pShard->handleMap.Begin(); it.Get() != nullptr; it.Next())
+    {
+        if (*(it.Get()->value.pRefCount) == 1)
+        {
+            pVictim   = &it.Get()->value;
+            victimKey = it.Get()->key;
+            break;
+        }
+    }
+
+    const bool evicted = (pVictim != nullptr);
+
+    if (evicted)
+    {
+        FreeModule(pVictim);
+        pShard->handleMap.Erase(victimKey);
+    }
+
+    return evicted;
+}
+
+// =====================================================================================================================
+// Looks up a module and adds a reference to it for the caller.
+bool ShaderModuleCache::Find(
+    const Util::MetroHash::Hash& shaderModuleCacheHash,
+    ShaderModuleHandle*          pShaderModule)
+{
+    Shard* pShard = GetShard(shaderModuleCacheHash);
+    bool   found  = false;
+
+    Util::MutexAuto mutexLock(&pShard->lock);
+
+    const ShaderModuleHandle* pCachedModule = pShard->handleMap.FindKey(shaderModuleCacheHash);
+
+    if (pCachedModule != nullptr)
+    {
+        VK_ASSERT(pCachedModule->pRefCount != nullptr);
+        Util::AtomicIncrement(pCachedModule->pRefCount);
+
+        *pShaderModule = *pCachedModule;
+        found          = true;
+    }
+
+    return found;
+}
+
+// =====================================================================================================================
+// Adds a freshly built module to the store and sets up its reference count: one reference for the store and one for
+// the caller. If the module can't be added (e.g. another thread stored the same module first, or the shard is full of
+// modules still in use), pRefCount stays null and the caller keeps sole ownership of the module.
+VkResult ShaderModuleCache::Insert(
+    const Util::MetroHash::Hash& shaderModuleCacheHash,
+    ShaderModuleHandle*          pShaderModule)
+{
+    VK_ASSERT(pShaderModule->pRefCount == nullptr);
+
+    VkResult result = VK_INCOMPLETE;
+
+    if (pShaderModule->pLlpcShaderModule != nullptr)
+    {
+        pShaderModule->pRefCount = static_cast<uint32_t*>(
+            m_pInstance->AllocMem(sizeof(uint32_t), VK_DEFAULT_MEM_ALIGN, VK_SYSTEM_ALLOCATION_SCOPE_CACHE));
+
+        result = (pShaderModule->pRefCount != nullptr) ? VK_SUCCESS : VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    if (result == VK_SUCCESS)
+    {
+        Shard* pShard = GetShard(shaderModuleCacheHash);
+
+        Util::MutexAuto mutexLock(&pShard->lock);
+
+        bool                existed       = false;
+        ShaderModuleHandle* pCachedModule = nullptr;
+
+        if ((m_maxShardEntries > 0)                                       &&
+            (pShard->handleMap.GetNumEntries() >= m_maxShardEntries)      &&
+            (pShard->handleMap.FindKey(shaderModuleCacheHash) == nullptr) &&
+            (EvictUnreferencedModule(pShard) == false))
+        {
+            result = VK_INCOMPLETE;
+        }
+
+        if (result == VK_SUCCESS)
+        {
+            result = PalToVkResult(pShard->handleMap.FindAllocate(shaderModuleCacheHash, &existed, &pCachedModule));
+        }
+
+        if ((result == VK_SUCCESS) && existed)
+        {
+            result = VK_INCOMPLETE;
+        }
+
+        if (result == VK_SUCCESS)
+        {
+            *pShaderModule->pRefCount = 2;
+            *pCachedModule            = *pShaderModule;
+        }
+        else
+        {
+            m_pInstance->FreeMem(pShaderModule->pRefCount);
+            pShaderModule->pRefCount = nullptr;
+        }
+    }
+
+    return result;
+}
+
+} // namespace vk
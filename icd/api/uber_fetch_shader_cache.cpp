@@ -0,0 +1,336 @@
+/*
+ ***********************************************************************************************************************
+ *
+ *  Copyright (c) 2014-2024 Advanced Micro Devices, Inc. All Rights Reserved.
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ *
+ **********************************************************************************************************************/
+/**
+ ***********************************************************************************************************************
+ * @file  uber_fetch_shader_cache.cpp
+ * @brief Implementation of the device-level cache of uber-fetch shader internal data.
+ ***********************************************************************************************************************
+ */
+
+#include "include/khronos/vulkan.h"
+
+#include "include/internal_mem_mgr.h"
+#include "include/pipeline_compiler.h"
+#include "include/uber_fetch_shader_cache.h"
+#include "include/vk_device.h"
+#include "include/vk_instance.h"
+
+#include "palHashMapImpl.h"
+#include "palVectorImpl.h"
+
+namespace vk
+{
+
+// =====================================================================================================================
+UberFetchShaderInternalDataCache::UberFetchShaderInternalDataCache(
+    Device* pDevice)
+    :
+    m_pDevice(pDevice),
+    m_maxMemSize(pDevice->GetRuntimeSettings().uberFetchShaderInternalDataCacheSize),
+    m_dataMap(NumDataBuckets, pDevice->VkInstance()->Allocator()),
+    m_chunks(pDevice->VkInstance()->Allocator()),
+    m_chunkOffset(0),
+    m_pTempBuffer(nullptr),
+    m_full(false)
+{
+
+}
+
+// =====================================================================================================================
+// Initializes the cache.  Should be called during device create.  GPU memory is only allocated on first use.
+VkResult UberFetchShaderInternalDataCache::Init()
+{
+    return PalToVkResult(m_dataMap.Init());
+}
+
+// =====================================================================================================================
+// Builds the key of a vertex input state from the fields the internal data depends on.  The sType and pNext members of
+// the descriptions are left out, so equal states from different call sites share an entry.
+void UberFetchShaderInternalDataCache::BuildKey(
+    uint32_t                                     vertexBindingDescriptionCount,
+    const VkVertexInputBindingDescription2EXT*   pVertexBindingDescriptions,
+    uint32_t                                     vertexAttributeDescriptionCount,
+    const VkVertexInputAttributeDescription2EXT* pVertexAttributeDescriptions,
+    bool                                         isOffsetMode,
+    Util::MetroHash::Hash*                       pKey)
+{
+    Util::MetroHash128 hasher;
+
+    hasher.Update(vertexBindingDescriptionCount);
+
+    for (uint32_t i = 0; i < vertexBindingDescriptionCount; ++i)
+    {
+        const VkVertexInputBindingDescription2EXT& binding = pVertexBindingDescriptions[i];
+
+        hasher.Update(binding.binding);
+        hasher.Update(binding.stride);
+        hasher.Update(binding.inputRate);
+        hasher.Update(binding.divisor);
+    }
+
+    hasher.Update(vertexAttributeDescriptionCount);
+
+    for (uint32_t i = 0; i < vertexAttributeDescriptionCount; ++i)
+    {
+        const VkVertexInputAttributeDescription2EXT& attrib = pVertexAttributeDescriptions[i];
+
+        hasher.Update(attrib.location);
+        hasher.Update(attrib.binding);
+        hasher.Update(attrib.format);
+        hasher.Update(attrib.offset);
+    }
+
+    hasher.Update(isOffsetMode);
+    hasher.Finalize(pKey->bytes);
+}
+
+// =====================================================================================================================
+// Returns the published uber-fetch shader internal data of the given vertex input state, building and publishing it on
+// first use.  The GPU address is zero if the state needs no internal data.  Returns nullptr with *pCacheFull set if
+// the data could not be published, in which case the caller must provide the data itself.  Once publishing has failed,
+// states that are not published yet are not tried again.
+const DynamicVertexInputInternalData* UberFetchShaderInternalDataCache::GetInternalData(
+    const Util::MetroHash::Hash&                 key,
+    uint32_t                                     vertexBindingDescriptionCount,
+    const VkVertexInputBindingDescription2EXT*   pVertexBindingDescriptions,
+    uint32_t                                     vertexAttributeDescriptionCount,
+    const VkVertexInputAttributeDescription2EXT* pVertexAttributeDescriptions,
+    bool                                         isOffsetMode,
+    bool*                                        pCacheFull)
+{
+    const DynamicVertexInputInternalData* pData = nullptr;
+    bool                                  full  = false;
+
+    {
+        Util::RWLockAuto<Util::RWLock::ReadOnly> lock(&m_lock);
+
+        pData = m_dataMap.FindKey(key);
+        full  = m_full;
+    }
+
+    *pCacheFull = (pData == nullptr) && full;
+
+    if ((pData == nullptr) && (full == false))
+    {
+        Util::RWLockAuto<Util::RWLock::ReadWrite> lock(&m_lock);
+
+        // Another command buffer may have published the same state meanwhile
+        pData = m_dataMap.FindKey(key);
+
+        if ((pData == nullptr) && m_full)
+        {
+            *pCacheFull = true;
+        }
+        else if (pData == nullptr)
+        {
+            const size_t   maxDataSize   = PipelineCompiler::GetMaxUberFetchShaderInternalDataSize();
+            const bool     dynamicStride = m_pDevice->GetEnabledFeatures().deviceGeneratedCommands;
+            const uint32_t deviceMask    = m_pDevice->GetPalDeviceMask();
+
+            if (m_pTempBuffer == nullptr)
+            {
+                m_pTempBuffer = m_pDevice->VkInstance()->AllocMem(
+                    maxDataSize * m_pDevice->NumPalDevices(),
+                    VK_SYSTEM_ALLOCATION_SCOPE_DEVICE);
+            }
+
+            Pal::Result result = (m_pTempBuffer != nullptr) ? Pal::Result::Success : Pal::Result::ErrorOutOfMemory;
+
+            // Build the data of every device, the data of all devices is published at the same chunk offset
+            uint32_t     dataSize[MaxPalDevices] = {};
+            Pal::gpusize entrySize               = 0;
+
+            if (result == Pal::Result::Success)
+            {
+                utils::IterateMask deviceGroup(deviceMask);
+                do
+                {
+                    const uint32_t deviceIdx = deviceGroup.Index();
+
+                    dataSize[deviceIdx] = m_pDevice->GetCompiler(deviceIdx)->BuildUberFetchShaderInternalData(
+                        vertexBindingDescriptionCount,
+                        pVertexBindingDescriptions,
+                        vertexAttributeDescriptionCount,
+                        pVertexAttributeDescriptions,
+                        dynamicStride,
+                        isOffsetMode,
+                        Util::VoidPtrInc(m_pTempBuffer, maxDataSize * deviceIdx));
+
+                    entrySize = Util::Max(entrySize, static_cast<Pal::gpusize>(dataSize[deviceIdx]));
+                } while (deviceGroup.IterateNext());
+            }
+
+            DynamicVertexInputInternalData entry = {};
+
+            if ((result == Pal::Result::Success) && (entrySize > 0))
+            {
+                InternalMemory* pChunk = nullptr;
+                Pal::gpusize    offset = 0;
+
+                result = AllocChunkSpace(entrySize, &pChunk, &offset);
+
+                if (result == Pal::Result::Success)
+                {
+                    utils::IterateMask deviceGroup(deviceMask);
+                    do
+                    {
+                        const uint32_t deviceIdx = deviceGroup.Index();
+
+                        memcpy(Util::VoidPtrInc(pChunk->CpuAddr(deviceIdx), static_cast<size_t>(offset)),
+                               Util::VoidPtrInc(m_pTempBuffer, maxDataSize * deviceIdx),
+                               dataSize[deviceIdx]);
+
+                        entry.gpuAddress[deviceIdx] = pChunk->GpuVirtAddr(deviceIdx) + offset;
+                    } while (deviceGroup.IterateNext());
+                }
+            }
+
+            if (result == Pal::Result::Success)
+            {
+                result = m_dataMap.Insert(key, entry);
+            }
+
+            if (result == Pal::Result::Success)
+            {
+                pData = m_dataMap.FindKey(key);
+            }
+            else
+            {
+                m_full      = true;
+                *pCacheFull = true;
+            }
+        }
+    }
+
+    return pData;
+}
+
+// =====================================================================================================================
+// Reserves size bytes of GPU memory for a new entry, starting a new chunk if the last one is full.  Fails once the
+// chunks would exceed the configured cache size.  The lock must be held for writing.
+Pal::Result UberFetchShaderInternalDataCache::AllocChunkSpace(
+    Pal::gpusize     size,
+    InternalMemory** ppChunk,
+    Pal::gpusize*    pOffset)
+{
+    VK_ASSERT(size <= ChunkSize);
+
+    Pal::Result  result = Pal::Result::Success;
+    Pal::gpusize offset = Util::Pow2Align(m_chunkOffset, VK_DEFAULT_MEM_ALIGN);
+
+    if ((m_chunks.NumElements() == 0) || ((offset + size) > ChunkSize))
+    {
+        if ((m_chunks.NumElements() + 1) * ChunkSize > m_maxMemSize)
+        {
+            result = Pal::Result::ErrorOutOfGpuMemory;
+        }
+
+        InternalMemory* pChunk = nullptr;
+
+        if (result == Pal::Result::Success)
+        {
+            void* pMem = m_pDevice->VkInstance()->AllocMem(sizeof(InternalMemory),
+                                                           VK_DEFAULT_MEM_ALIGN,
+                                                           VK_SYSTEM_ALLOCATION_SCOPE_DEVICE);
+
+            result = (pMem != nullptr) ? Pal::Result::Success : Pal::Result::ErrorOutOfMemory;
+
+            if (result == Pal::Result::Success)
+            {
+                pChunk = VK_PLACEMENT_NEW(pMem) InternalMemory;
+
+                // The descriptor table pool keeps the high address bits fixed, like embedded data, because
+                // non-compact pipeline layouts only pass the low 32 bits to the uber-fetch shader.
+                InternalMemCreateInfo allocInfo = {};
+                allocInfo.pal.size      = ChunkSize;
+                allocInfo.pal.alignment = VK_DEFAULT_MEM_ALIGN;
+                allocInfo.pal.priority  = Pal::GpuMemPriority::Normal;
+
+                m_pDevice->MemMgr()->GetCommonPool(InternalPoolDescriptorTable, &allocInfo);
+
+                result = (m_pDevice->MemMgr()->AllocGpuMem(
+                    allocInfo,
+                    pChunk,
+                    m_pDevice->GetPalDeviceMask(),
+                    VK_OBJECT_TYPE_DEVICE,
+                    ApiDevice::IntValueFromHandle(ApiDevice::FromObject(m_pDevice))) == VK_SUCCESS) ?
+                    Pal::Result::Success : Pal::Result::ErrorOutOfGpuMemory;
+
+                if (result == Pal::Result::Success)
+                {
+                    result = m_chunks.PushBack(pChunk);
+
+                    if (result != Pal::Result::Success)
+                    {
+                        m_pDevice->MemMgr()->FreeGpuMem(pChunk);
+                    }
+                }
+
+                if (result != Pal::Result::Success)
+                {
+                    Util::Destructor(pChunk);
+                    m_pDevice->VkInstance()->FreeMem(pMem);
+                }
+            }
+        }
+
+        offset = 0;
+    }
+
+    if (result == Pal::Result::Success)
+    {
+        *ppChunk      = m_chunks.At(m_chunks.NumElements() - 1);
+        *pOffset      = offset;
+        m_chunkOffset = offset + size;
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Frees the GPU memory of all published entries.  Should be called during device destroy, once no command buffer can
+// reference the data anymore.
+void UberFetchShaderInternalDataCache::Destroy()
+{
+    for (uint32_t i = 0; i < m_chunks.NumElements(); ++i)
+    {
+        InternalMemory* pChunk = m_chunks.At(i);
+
+        m_pDevice->MemMgr()->FreeGpuMem(pChunk);
+        Util::Destructor(pChunk);
+        m_pDevice->VkInstance()->FreeMem(pChunk);
+    }
+
+    m_chunks.Clear();
+    m_dataMap.Reset();
+
+    if (m_pTempBuffer != nullptr)
+    {
+        m_pDevice->VkInstance()->FreeMem(m_pTempBuffer);
+        m_pTempBuffer = nullptr;
+    }
+}
+
+} // namespace vk
@@ -27,21 +27,55 @@
 #include <assert.h>
 #include <malloc.h>
 #include <memory.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 #include "json_reader.h"
 #include "vk_utils.h"
 
+#include "palInlineFuncs.h"
+
 namespace vk { namespace utils {
 
+// Header of a block of memory that nodes and key indices are carved out of in arena mode.  The usable bytes follow
+// the header.
+struct JsonArenaChunk
+{
+    JsonArenaChunk* pNext;    // Previously allocated chunk
+    size_t          capacity; // Number of usable bytes in the chunk
+    size_t          tail;     // First free byte in the chunk
+};
+
+// Allocation holding the root of an arena-mode tree.  The root node comes first so that JsonDestroy() can get back to
+// the chunk list from the root pointer.
+struct JsonDocument
+{
+    Json            root;     // Root node returned to the caller
+    JsonArenaChunk* pChunks;  // Every chunk owned by the tree, newest first
+};
+
+// Open-addressed hash table over the children of an object, keyed by the hash of the child key.
+struct JsonKeyIndex
+{
+    uint32_t mask;      // Number of slots minus one; the slot count is a power of two
+    Json*    pSlots[1]; // Child nodes, or nullptr for empty slots
+};
+
+constexpr size_t JsonArenaAlignment    = alignof(Json);
+constexpr size_t JsonArenaMinChunkSize = 64 * 1024;
+
+static_assert((sizeof(JsonArenaChunk) % JsonArenaAlignment) == 0, "Chunk data must start aligned");
+
 // Context for parsing JSON data
 struct JsonContext
 {
-    JsonSettings settings;              // Copy of settings
-    const char*  pStr;                  // Next character in buffer
-    size_t       sz;                    // Number of bytes left in buffer
-    bool         inSingleLineComment;   // If currently parsing a single-line (//) comment
-    bool         inMultiLineComment;    // If currently parsing a multi-line (/* */) comment
+    JsonSettings    settings;              // Copy of settings
+    const char*     pStr;                  // Next character in buffer
+    size_t          sz;                    // Number of bytes left in buffer
+    bool            inSingleLineComment;   // If currently parsing a single-line (//) comment
+    bool            inMultiLineComment;    // If currently parsing a multi-line (/* */) comment
+    JsonArenaChunk* pArena;                // Current arena chunk when settings.arenaAlloc is set
+    size_t          arenaChunkSize;        // Minimum capacity of a new arena chunk
 };
 
 static bool JsonParseObject(JsonContext* pCtx, char prefix, Json* pObject);
@@ -65,6 +99,68 @@ static void JsonDefaultFree(
     free(ptr);
 }
 
+// =====================================================================================================================
+// Carves memory out of the current arena chunk, starting a new chunk when it does not fit.
+static void* JsonArenaAlloc(
+    JsonContext* pCtx,
+    size_t       size)
+{
+    size = Util::Pow2Align(size, JsonArenaAlignment);
+
+    JsonArenaChunk* pChunk = pCtx->pArena;
+
+    if ((pChunk == nullptr) || ((pChunk->capacity - pChunk->tail) < size))
+    {
+        const size_t capacity = Util::Max(size, pCtx->arenaChunkSize);
+
+        pChunk = static_cast<JsonArenaChunk*>(
+            pCtx->settings.pfnAlloc(pCtx->settings.pUserData, sizeof(JsonArenaChunk) + capacity));
+
+        if (pChunk == nullptr)
+        {
+            return nullptr;
+        }
+
+        pChunk->pNext    = pCtx->pArena;
+        pChunk->capacity = capacity;
+        pChunk->tail     = 0;
+
+        pCtx->pArena = pChunk;
+    }
+
+    void* pMem = reinterpret_cast<uint8_t*>(pChunk + 1) + pChunk->tail;
+
+    pChunk->tail += size;
+
+    return pMem;
+}
+
+// =====================================================================================================================
+// Frees a list of arena chunks.
+static void JsonArenaFree(
+    const JsonSettings& settings,
+    JsonArenaChunk*     pChunk)
+{
+    while (pChunk != nullptr)
+    {
+        JsonArenaChunk* pNext = pChunk->pNext;
+
+        settings.pfnFree(settings.pUserData, pChunk);
+
+        pChunk = pNext;
+    }
+}
+
+// =====================================================================================================================
+// Allocates memory for the tree being parsed, either from the arena or directly from the allocator.
+static void* JsonAlloc(
+    JsonContext* pCtx,
+    size_t       size)
+{
+    return pCtx->settings.arenaAlloc ? JsonArenaAlloc(pCtx, size)
+                                     : pCtx->settings.pfnAlloc(pCtx->settings.pUserData, size);
+}
+
 // =====================================================================================================================
 // Returns the next character after offset entries without advancing the buffer.
 static char JsonPeek(
@@ -178,6 +274,11 @@ static void JsonFree(
         settings.pfnFree(settings.pUserData, pItem->pStringValue);
     }
 
+    if (pItem->pKeyIndex != nullptr)
+    {
+        settings.pfnFree(settings.pUserData, pItem->pKeyIndex);
+    }
+
     Json* pChild = pItem->pChild;
 
     while (pChild != nullptr)
@@ -192,27 +293,106 @@ static void JsonFree(
     settings.pfnFree(settings.pUserData, pItem);
 }
 
+// =====================================================================================================================
+// Initializes an empty JSON node.
+static void JsonInit(Json* pItem)
+{
+    pItem->type         = JsonValueType::String;
+    pItem->pKey         = nullptr;
+    pItem->pStringValue = nullptr;
+    pItem->doubleValue  = 0.0;
+    pItem->integerValue = 0;
+    pItem->booleanValue = false;
+    pItem->pChild       = nullptr;
+    pItem->pNext        = nullptr;
+    pItem->pKeyIndex    = nullptr;
+}
+
 // =====================================================================================================================
 // Creates a new empty JSON node.
-static Json* JsonNew(const JsonSettings& settings)
+static Json* JsonNew(JsonContext* pCtx)
 {
-    Json* pItem = static_cast<Json*>(settings.pfnAlloc(settings.pUserData, sizeof(Json)));
+    Json* pItem = static_cast<Json*>(JsonAlloc(pCtx, sizeof(Json)));
 
     if (pItem != nullptr)
     {
-        pItem->type         = JsonValueType::String;
-        pItem->pKey         = nullptr;
-        pItem->pStringValue = nullptr;
-        pItem->doubleValue  = 0.0;
-        pItem->integerValue = 0;
-        pItem->booleanValue = false;
-        pItem->pChild       = nullptr;
-        pItem->pNext        = nullptr;
+        JsonInit(pItem);
     }
 
     return pItem;
 }
 
+// =====================================================================================================================
+// Hashes a key for the key index.
+static uint32_t JsonHashKey(
+    const char* pKey)
+{
+    return Util::HashString(pKey, strlen(pKey));
+}
+
+// =====================================================================================================================
+// Builds the hashed key index of a fully parsed object.
+static void JsonBuildKeyIndex(
+    JsonContext* pCtx,
+    Json*        pObject,
+    uint32_t     keyCount)
+{
+    const uint32_t slotCount = Util::Pow2Pad(keyCount * 2);
+
+    JsonKeyIndex* pIndex = static_cast<JsonKeyIndex*>(
+        JsonAlloc(pCtx, offsetof(JsonKeyIndex, pSlots) + (slotCount * sizeof(Json*))));
+
+    // The object can still be searched linearly, so running out of memory here is not a parse error.
+    if (pIndex != nullptr)
+    {
+        pIndex->mask = slotCount - 1;
+
+        memset(pIndex->pSlots, 0, slotCount * sizeof(Json*));
+
+        for (Json* pChild = pObject->pChild; pChild != nullptr; pChild = pChild->pNext)
+        {
+            uint32_t slot = JsonHashKey(pChild->pKey) & pIndex->mask;
+
+            while ((pIndex->pSlots[slot] != nullptr) && (strcmp(pIndex->pSlots[slot]->pKey, pChild->pKey) != 0))
+            {
+                slot = (slot + 1) & pIndex->mask;
+            }
+
+            // Keep the first of any duplicate keys, the same one a linear search finds.
+            if (pIndex->pSlots[slot] == nullptr)
+            {
+                pIndex->pSlots[slot] = pChild;
+            }
+        }
+
+        pObject->pKeyIndex = pIndex;
+    }
+}
+
+// =====================================================================================================================
+// Looks a key up in an object's key index.
+static Json* JsonFindIndexedKey(
+    const JsonKeyIndex* pIndex,
+    const char*         pKey)
+{
+    Json*    pValue = nullptr;
+    uint32_t slot   = JsonHashKey(pKey) & pIndex->mask;
+
+    while (pIndex->pSlots[slot] != nullptr)
+    {
+        if (strcmp(pKey, pIndex->pSlots[slot]->pKey) == 0)
+        {
+            pValue = pIndex->pSlots[slot];
+
+            break;
+        }
+
+        slot = (slot + 1) & pIndex->mask;
+    }
+
+    return pValue;
+}
+
 // =====================================================================================================================
 // Parses a string value until a quote is seen.  Prefix is expected to be '"' and the value of JsonPeek(0) is expected
 // to be the first character of the string after the quote.
@@ -247,13 +427,23 @@ static bool JsonParseStringValue(
     {
         size_t len = (pEnd - pStart);
 
-        pString = (char*)pCtx->settings.pfnAlloc(pCtx->settings.pUserData, len + 1);
-
-        if (pString != nullptr)
+        if (pCtx->settings.arenaAlloc)
         {
-            memcpy(pString, pStart, len);
+            // In arena mode the buffer is the arena's own copy of the source, so the string is terminated in place
+            // over its closing quote, which has already been consumed.
+            pString = const_cast<char*>(pStart);
             pString[len] = '\0';
         }
+        else
+        {
+            pString = (char*)pCtx->settings.pfnAlloc(pCtx->settings.pUserData, len + 1);
+
+            if (pString != nullptr)
+            {
+                memcpy(pString, pStart, len);
+                pString[len] = '\0';
+            }
+        }
     }
 
     if (pString != nullptr)
@@ -527,7 +717,8 @@ static bool JsonParseObject(
 {
     bool good = true;
 
-    Json* pPrevChild = nullptr;
+    Json*    pPrevChild = nullptr;
+    uint32_t keyCount   = 0;
 
     while (good)
     {
@@ -538,7 +729,7 @@ static bool JsonParseObject(
             break;
         }
 
-        Json* pChild = JsonNew(pCtx->settings);
+        Json* pChild = JsonNew(pCtx);
 
         if (pChild != nullptr)
         {
@@ -553,6 +744,7 @@ static bool JsonParseObject(
             }
 
             pPrevChild = pChild;
+            keyCount++;
         }
         else
         {
@@ -574,6 +766,11 @@ static bool JsonParseObject(
         good = (c == ',');
     }
 
+    if (good && (pCtx->settings.keyIndexMinKeys > 0) && (keyCount >= pCtx->settings.keyIndexMinKeys))
+    {
+        JsonBuildKeyIndex(pCtx, pObject, keyCount);
+    }
+
     return good;
 }
 
@@ -597,7 +794,7 @@ static bool JsonParseArray(
             break;
         }
 
-        Json* pChild = JsonNew(pCtx->settings);
+        Json* pChild = JsonNew(pCtx);
 
         if (pChild != nullptr)
         {
@@ -657,6 +854,9 @@ static JsonSettings JsonFillSettings(
 // =====================================================================================================================
 // Parses a buffer of JSON text into a Json* node hierarchy.  If an error is occurred while parsing, nullptr is
 // returned.
+//
+// In arena mode the source is copied once into the first arena chunk and parsed from there, so that strings can be
+// left in place instead of being allocated individually.
 Json* JsonParse(
     const JsonSettings& settings,
     const void*         pJson,
@@ -668,15 +868,58 @@ Json* JsonParse(
     ctx.pStr     = (const char*)pJson;
     ctx.sz       = sz;
 
-    Json* pRoot = JsonNew(ctx.settings);
+    Json*         pRoot     = nullptr;
+    JsonDocument* pDocument = nullptr;
 
-    char prefix = JsonNextToken(&ctx);
+    if (ctx.settings.arenaAlloc)
+    {
+        // Size chunks so that the source copy and the nodes of a typical document share the first one
+        ctx.arenaChunkSize = Util::Max(JsonArenaMinChunkSize, sz * 2);
+
+        pDocument   = static_cast<JsonDocument*>(JsonArenaAlloc(&ctx, sizeof(JsonDocument)));
+        char* pText = static_cast<char*>(JsonArenaAlloc(&ctx, sz + 1));
+
+        if ((pDocument != nullptr) && (pText != nullptr))
+        {
+            memcpy(pText, pJson, sz);
+            pText[sz] = '\0';
+
+            ctx.pStr = pText;
+            pRoot    = &pDocument->root;
 
-    if (JsonParseValue(&ctx, prefix, pRoot) == false)
+            JsonInit(pRoot);
+        }
+    }
+    else
     {
-        JsonFree(ctx.settings, pRoot);
+        pRoot = JsonNew(&ctx);
+    }
+
+    if (pRoot != nullptr)
+    {
+        char prefix = JsonNextToken(&ctx);
+
+        if (JsonParseValue(&ctx, prefix, pRoot) == false)
+        {
+            if (ctx.settings.arenaAlloc == false)
+            {
+                JsonFree(ctx.settings, pRoot);
+            }
+
+            pRoot = nullptr;
+        }
+    }
 
-        pRoot = nullptr;
+    if (ctx.settings.arenaAlloc)
+    {
+        if (pRoot != nullptr)
+        {
+            pDocument->pChunks = ctx.pArena;
+        }
+        else
+        {
+            JsonArenaFree(ctx.settings, ctx.pArena);
+        }
     }
 
     return pRoot;
@@ -688,7 +931,19 @@ void JsonDestroy(
     const JsonSettings& settings,
     Json*               pJson)
 {
-    JsonFree(settings, pJson);
+    const JsonSettings filledSettings = JsonFillSettings(&settings);
+
+    if (filledSettings.arenaAlloc)
+    {
+        if (pJson != nullptr)
+        {
+            JsonArenaFree(filledSettings, reinterpret_cast<JsonDocument*>(pJson)->pChunks);
+        }
+    }
+    else
+    {
+        JsonFree(filledSettings, pJson);
+    }
 }
 
 // =====================================================================================================================
@@ -773,7 +1028,11 @@ Json* JsonGetValue(
 {
     Json* pValue = nullptr;
 
-    if (pObject != nullptr && pObject->type == JsonValueType::Object)
+    if (pObject != nullptr && pObject->type == JsonValueType::Object && pObject->pKeyIndex != nullptr)
+    {
+        pValue = JsonFindIndexedKey(pObject->pKeyIndex, pKey);
+    }
+    else if (pObject != nullptr && pObject->type == JsonValueType::Object)
     {
         for (Json* pChild = pObject->pChild; pChild != nullptr; pChild = pChild->pNext)
         {
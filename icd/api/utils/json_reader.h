@@ -52,6 +52,8 @@ enum class JsonValueType
     Boolean
 };
 
+struct JsonKeyIndex;
+
 // Basic JSON node representing either a value or a key:value pair.  JSON data is composed of a tree of these nodes.
 struct Json
 {
@@ -63,6 +65,7 @@ struct Json
     bool          booleanValue; // A boolean value type.  Valid when type is Number or Boolean.
     Json*         pChild;       // List of child key:value pairs.  Valid when type is Object or Array.
     Json*         pNext;        // Next pointer in a list of key:value pairs.
+    JsonKeyIndex* pKeyIndex;    // Optional hashed index of the child keys.  Valid when type is Object.
 };
 
 // Settings structure for parsing JSON data.
@@ -76,6 +79,15 @@ struct JsonSettings
 
     // A user-provided value to the allocator functions.
     const void* pUserData;
+
+    // If true, nodes are carved out of a few large arena blocks and strings point into a single copy of the source
+    // buffer instead of being allocated one by one.  The whole tree is released at once by JsonDestroy(), which must be
+    // given the same settings.
+    bool arenaAlloc;
+
+    // Objects with at least this many keys get a hashed key index that JsonGetValue() uses instead of a linear search.
+    // Zero disables the index.
+    uint32_t keyIndexMinKeys;
 };
 
 // Parse a JSON string from a buffer into a tree of Json nodes.
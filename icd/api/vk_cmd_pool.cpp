@@ -34,6 +34,7 @@
 #include "include/vk_instance.h"
 #include "include/vk_device.h"
 #include "include/vk_conv.h"
+#include "include/log.h"
 
 #include "palFile.h"
 #include "palHashSetImpl.h"
@@ -58,7 +59,11 @@ CmdPool::CmdPool(
     m_pAllocator(pAllocator),
     m_queueFamilyIndex(queueFamilyIndex),
     m_cmdBufferRegistry(32, pDevice->VkInstance()->Allocator()),
-    m_cmdBuffersAlreadyBegun(32, pDevice->VkInstance()->Allocator())
+    m_cmdBuffersAlreadyBegun(32, pDevice->VkInstance()->Allocator()),
+    m_maxRecycledCmdBuffers(pDevice->GetRuntimeSettings().cmdBufferRecycleLimit),
+    m_freePrimaryCmdBuffers(pDevice->VkInstance()->Allocator()),
+    m_freeSecondaryCmdBuffers(pDevice->VkInstance()->Allocator()),
+    m_recycleStats()
 {
     m_flags.u32All = 0;
 
@@ -87,6 +92,17 @@ VkResult CmdPool::Init()
         palResult = m_cmdBuffersAlreadyBegun.Init();
     }
 
+    // Reserve the free lists up front so that freeing a command buffer never has to allocate.
+    if ((palResult == Pal::Result::Success) && (m_maxRecycledCmdBuffers > 0))
+    {
+        palResult = m_freePrimaryCmdBuffers.Reserve(m_maxRecycledCmdBuffers);
+    }
+
+    if ((palResult == Pal::Result::Success) && (m_maxRecycledCmdBuffers > 0))
+    {
+        palResult = m_freeSecondaryCmdBuffers.Reserve(m_maxRecycledCmdBuffers);
+    }
+
     return PalToVkResult(palResult);
 }
 
@@ -237,6 +253,24 @@ VkResult CmdPool::Destroy(
         pCmdBuf->Destroy();
     }
 
+    DestroyRecycledCmdBuffers();
+
+    const uint64_t allocCount = m_recycleStats.allocHits + m_recycleStats.allocMisses;
+
+    if (allocCount > 0)
+    {
+        AmdvlkLog(pDevice->GetRuntimeSettings().logTagIdMask,
+                  GeneralPrint,
+                  "CmdPool %p: %llu of %llu command buffer allocations served from free lists (%.1f%%), "
+                  "%llu recycled, %llu trimmed",
+                  this,
+                  static_cast<unsigned long long>(m_recycleStats.allocHits),
+                  static_cast<unsigned long long>(allocCount),
+                  (100.0 * m_recycleStats.allocHits) / allocCount,
+                  static_cast<unsigned long long>(m_recycleStats.recycled),
+                  static_cast<unsigned long long>(m_recycleStats.trimmed));
+    }
+
     // If we don't use a shared CmdAllocator then we have to destroy our own one.
     if (m_flags.sharedCmdAllocator == 0)
     {
@@ -326,6 +360,10 @@ VkResult CmdPool::Reset(
 // =====================================================================================================================
 void CmdPool::Trim()
 {
+    // Release the command buffers kept for reuse first so that their PAL command buffers no longer hold on to any
+    // allocator chunks.
+    DestroyRecycledCmdBuffers();
+
     for (uint32_t deviceIdx = 0; deviceIdx < m_pDevice->NumPalDevices(); ++deviceIdx)
     {
         m_pPalCmdAllocators[deviceIdx]->Trim(((1 << Pal::CmdAllocatorTypeCount) - 1), 0);
@@ -347,6 +385,69 @@ void CmdPool::UnregisterCmdBuffer(CmdBuffer* pCmdBuffer)
     m_cmdBufferRegistry.Erase(pCmdBuffer);
 }
 
+// =====================================================================================================================
+// Takes a command buffer of the given level from this pool's free lists.  Returns nullptr if none is available, in
+// which case the caller must construct a new command buffer.
+CmdBuffer* CmdPool::AcquireRecycledCmdBuffer(
+    bool secondaryLevel)
+{
+    CmdBuffer*         pCmdBuffer = nullptr;
+    CmdBufferFreeList* pFreeList  = GetFreeList(secondaryLevel);
+
+    if (pFreeList->IsEmpty() == false)
+    {
+        pFreeList->PopBack(&pCmdBuffer);
+
+        m_recycleStats.allocHits++;
+    }
+    else if (m_maxRecycledCmdBuffers > 0)
+    {
+        m_recycleStats.allocMisses++;
+    }
+
+    return pCmdBuffer;
+}
+
+// =====================================================================================================================
+// Keeps a freed command buffer, which must already have been reset with its resources released, for reuse by a later
+// allocation.  The command buffer is no longer registered with the pool while it sits in the free list.
+Pal::Result CmdPool::RecycleCmdBuffer(
+    CmdBuffer* pCmdBuffer)
+{
+    VK_ASSERT(CanRecycleCmdBuffer(pCmdBuffer->IsSecondaryLevel()));
+
+    Pal::Result result = GetFreeList(pCmdBuffer->IsSecondaryLevel())->PushBack(pCmdBuffer);
+
+    if (result == Pal::Result::Success)
+    {
+        UnregisterCmdBuffer(pCmdBuffer);
+
+        m_recycleStats.recycled++;
+    }
+
+    return result;
+}
+
+// =====================================================================================================================
+// Destroys all command buffers kept in this pool's free lists.
+void CmdPool::DestroyRecycledCmdBuffers()
+{
+    for (uint32_t level = 0; level < 2; ++level)
+    {
+        CmdBufferFreeList* pFreeList = GetFreeList(level != 0);
+
+        while (pFreeList->IsEmpty() == false)
+        {
+            CmdBuffer* pCmdBuffer = nullptr;
+
+            pFreeList->PopBack(&pCmdBuffer);
+            pCmdBuffer->Destroy();
+
+            m_recycleStats.trimmed++;
+        }
+    }
+}
+
 // =====================================================================================================================
 // Adds command buffer to the set of command buffers needing explicit reset when this cmd pool is reset.
 Pal::Result CmdPool::MarkCmdBufBegun(
@@ -89,6 +89,9 @@ namespace
         {{0}},  // flags
     };
 
+    // Hash buckets of the per-command buffer dynamic PAL state object maps
+    constexpr uint32_t DynamicStateMapBuckets = 16;
+
 // =====================================================================================================================
 // Creates a compatible PAL "clear box" structure from attachment + render area for a renderpass clear.
 Pal::Box BuildClearBox(
@@ -599,6 +602,9 @@ CmdBuffer::CmdBuffer(
     m_palDepthStencilState(pDevice->VkInstance()->Allocator()),
     m_palColorBlendState(pDevice->VkInstance()->Allocator()),
     m_palMsaaState(pDevice->VkInstance()->Allocator()),
+    m_palDepthStencilStateMap(DynamicStateMapBuckets, pDevice->VkInstance()->Allocator()),
+    m_palColorBlendStateMap(DynamicStateMapBuckets, pDevice->VkInstance()->Allocator()),
+    m_palMsaaStateMap(DynamicStateMapBuckets, pDevice->VkInstance()->Allocator()),
     m_writtenFlippableImages(pDevice->VkInstance()->Allocator()),
     m_uberFetchShaderInternalDataMap(8, pDevice->VkInstance()->Allocator()),
     m_pUberFetchShaderTempBuffer(nullptr),
@@ -612,8 +618,10 @@ CmdBuffer::CmdBuffer(
 {
     m_flags.wasBegun = false;
 
-    m_perCmdBufDrawCallCounter     = 0;
-    m_perCmdBufDispatchCallCounter = 0;
+    m_perCmdBufDrawCallCounter       = 0;
+    m_perCmdBufDispatchCallCounter   = 0;
+    m_perCmdBufSetBindCounter        = 0;
+    m_perCmdBufSkippedSetBindCounter = 0;
 
     const RuntimeSettings& settings = m_pDevice->GetRuntimeSettings();
 
@@ -728,10 +736,24 @@ VkResult CmdBuffer::Create(
 
     while ((result == VK_SUCCESS) && (allocCount < commandBufferCount))
     {
+        // Reuse a command buffer of the same level that was freed back to the pool before constructing a new one
+        CmdBuffer* pRecycledCmdBuffer = pCmdPool->AcquireRecycledCmdBuffer(palCreateInfo.flags.nested != 0);
+
         // Allocate memory for the command buffer
-        void* pMemory = pDevice->AllocApiObject(pCmdPool->GetCmdPoolAllocator(), cmdBufSize);
+        void* pMemory = (pRecycledCmdBuffer == nullptr) ?
+                        pDevice->AllocApiObject(pCmdPool->GetCmdPoolAllocator(), cmdBufSize) : nullptr;
+
+        if (pRecycledCmdBuffer != nullptr)
+        {
+            pCommandBuffers[allocCount] =
+                reinterpret_cast<VkCommandBuffer>(ApiCmdBuffer::FromObject(pRecycledCmdBuffer));
+
+            result = pRecycledCmdBuffer->Reuse();
+
+            allocCount++;
+        }
         // Create the command buffer
-        if (pMemory != nullptr)
+        else if (pMemory != nullptr)
         {
             void* pPalMem = Util::VoidPtrInc(pMemory, apiSize + perGpuSize - inaccessibleSize);
 
@@ -755,6 +777,8 @@ VkResult CmdBuffer::Create(
                 pCmdBuffer->m_allGpuState.pDescBufBinding = nullptr;
             }
 
+            pCmdBuffer->m_descBufBindingWatermark = 0;
+
             result = pCmdBuffer->Initialize(pPalMem, palCreateInfo);
 
             allocCount++;
@@ -833,14 +857,7 @@ VkResult CmdBuffer::Initialize(
     {
         m_flags.is2ndLvl = groupCreateInfo.flags.nested;
 
-        m_allGpuState.stencilRefMasks.flags.u8All = 0xff;
-
-        // Set up the default front/back op values == 1
-        m_allGpuState.stencilRefMasks.frontOpValue = DefaultStencilOpValue;
-        m_allGpuState.stencilRefMasks.backOpValue = DefaultStencilOpValue;
-
-        m_allGpuState.logicOpEnable = VK_FALSE;
-        m_allGpuState.logicOp = VK_LOGIC_OP_COPY;
+        InitializeDefaultState();
     }
 
     // Initialize SQTT command buffer state if thread tracing support is enabled (gpuopen developer mode).
@@ -864,6 +881,21 @@ VkResult CmdBuffer::Initialize(
         result = m_uberFetchShaderInternalDataMap.Init();
     }
 
+    if (result == Pal::Result::Success)
+    {
+        result = m_palDepthStencilStateMap.Init();
+    }
+
+    if (result == Pal::Result::Success)
+    {
+        result = m_palColorBlendStateMap.Init();
+    }
+
+    if (result == Pal::Result::Success)
+    {
+        result = m_palMsaaStateMap.Init();
+    }
+
     if ((result == Pal::Result::Success) && (createInfo.queueType == Pal::QueueType::QueueTypeDma))
     {
         result = BackupInitialize(createInfo);
@@ -880,6 +912,35 @@ VkResult CmdBuffer::Initialize(
     return PalToVkResult(result);
 }
 
+// =====================================================================================================================
+// Sets up the render state defaults that are not reset by vkBeginCommandBuffer.  Called when the command buffer is
+// created and when it is reused from its pool's free list.
+void CmdBuffer::InitializeDefaultState()
+{
+    m_allGpuState.stencilRefMasks = {};
+    m_allGpuState.stencilRefMasks.flags.u8All = 0xff;
+
+    // Set up the default front/back op values == 1
+    m_allGpuState.stencilRefMasks.frontOpValue = DefaultStencilOpValue;
+    m_allGpuState.stencilRefMasks.backOpValue = DefaultStencilOpValue;
+
+    m_allGpuState.logicOpEnable = VK_FALSE;
+    m_allGpuState.logicOp = VK_LOGIC_OP_COPY;
+}
+
+// =====================================================================================================================
+// Prepares a command buffer taken from its pool's free list to be handed out by vkAllocateCommandBuffers again.  The
+// command buffer and its PAL command buffers were reset with their resources released when it was freed.
+VkResult CmdBuffer::Reuse()
+{
+    VK_ASSERT((m_flags.isRecording == false) && (m_flags.wasBegun == false));
+
+    InitializeDefaultState();
+
+    // Register this command buffer with the pool again
+    return PalToVkResult(m_pCmdPool->RegisterCmdBuffer(this));
+}
+
 // =====================================================================================================================
 // Create backup pal cmdbuffer, only call when DMA queue cmdbuffer be created
 Pal::Result CmdBuffer::BackupInitialize(
@@ -1509,6 +1570,8 @@ VkResult CmdBuffer::Begin(
 
         if (pInheritanceRenderingInfo != nullptr)
         {
+            m_flags.dynamicRenderingStateDirty = true;
+
             m_allGpuState.dynamicRenderingInstance.viewMask =
                 pInheritanceRenderingInfo->viewMask;
 
@@ -1759,6 +1822,7 @@ void CmdBuffer::ResetPipelineState()
             sizeof(m_allGpuState.pipelineState[bindIdx].userDataLayout));
 
         m_allGpuState.pipelineState[bindIdx].boundSetCount    = 0;
+        m_allGpuState.pipelineState[bindIdx].boundSetValidMask = 0;
         m_allGpuState.pipelineState[bindIdx].pushedConstCount = 0;
         m_allGpuState.pipelineState[bindIdx].dynamicBindInfo  = {};
         m_allGpuState.pipelineState[bindIdx].hasDynamicVertexInput = false;
@@ -1824,18 +1888,33 @@ void CmdBuffer::ResetPipelineState()
 // and during vkResetCommandBuffer
 void CmdBuffer::ResetState()
 {
-    // Memset the first section of m_allGpuState.  The second section begins with pipelineState.
-    const size_t memsetBytes = offsetof(AllGpuRenderState, pipelineState);
+    // Memset the first section of m_allGpuState.  The second section begins with pipelineState.  The dynamic rendering
+    // instance at the end of the first section makes up most of its size, so it is only cleared if it was written.
+    static_assert((offsetof(AllGpuRenderState, pipelineState) -
+                   (offsetof(AllGpuRenderState, dynamicRenderingInstance) + sizeof(DynamicRenderingInstance))) <
+                  alignof(PipelineBindState),
+                  "dynamicRenderingInstance must be the last member of the first section of AllGpuRenderState");
+
+    const size_t memsetBytes = offsetof(AllGpuRenderState, dynamicRenderingInstance);
 
     memset(&m_allGpuState, 0, memsetBytes);
 
+    if (m_flags.dynamicRenderingStateDirty)
+    {
+        memset(&m_allGpuState.dynamicRenderingInstance, 0, sizeof(m_allGpuState.dynamicRenderingInstance));
+
+        m_flags.dynamicRenderingStateDirty = false;
+    }
+
     ResetPipelineState();
 
     m_curDeviceMask = InvalidPalDeviceMask;
 
     // Reset local draw call counter
-    m_perCmdBufDrawCallCounter     = 0;
-    m_perCmdBufDispatchCallCounter = 0;
+    m_perCmdBufDrawCallCounter       = 0;
+    m_perCmdBufDispatchCallCounter   = 0;
+    m_perCmdBufSetBindCounter        = 0;
+    m_perCmdBufSkippedSetBindCounter = 0;
 
     m_renderPassInstance.pExecuteInfo = nullptr;
     m_renderPassInstance.subpass      = VK_SUBPASS_EXTERNAL;
@@ -1846,11 +1925,13 @@ void CmdBuffer::ResetState()
     m_flags.hasConditionalRendering = false;
 
     m_debugPrintf.Reset(m_pDevice);
-    if (m_allGpuState.pDescBufBinding != nullptr)
+    if ((m_allGpuState.pDescBufBinding != nullptr) && (m_descBufBindingWatermark > 0))
     {
-        memset(m_allGpuState.pDescBufBinding, 0, sizeof(DescBufBinding));
+        memset(m_allGpuState.pDescBufBinding->baseAddr, 0, sizeof(VkDeviceAddress) * m_descBufBindingWatermark);
     }
 
+    m_descBufBindingWatermark = 0;
+
     m_writtenFlippableImages.Clear();
 }
 
@@ -2320,6 +2401,8 @@ void CmdBuffer::ExecuteCommands(
         // Increment per command list draw call counter
         m_perCmdBufDrawCallCounter += pInteralCmdBuf->GetDrawCallCount();
         m_perCmdBufDispatchCallCounter += pInteralCmdBuf->GetDispatchCallCount();
+        m_perCmdBufSetBindCounter += pInteralCmdBuf->GetDescriptorSetBindCount();
+        m_perCmdBufSkippedSetBindCounter += pInteralCmdBuf->GetSkippedDescriptorSetBindCount();
 
 #if VKI_RAY_TRACING
         m_flags.hasRayTracing |= pInteralCmdBuf->HasRayTracing();
@@ -2412,6 +2495,41 @@ VkResult CmdBuffer::Destroy(void)
     return VK_SUCCESS;
 }
 
+// =====================================================================================================================
+// Frees a command buffer on behalf of vkFreeCommandBuffers.  If the pool has room, the command buffer is reset with its
+// resources released and kept fully constructed in the pool's free list instead of being destroyed.  Command buffers
+// carrying SQTT state are never recycled because their debug tags and user marker history belong to the freed handle.
+VkResult CmdBuffer::Free(void)
+{
+    bool recycled = false;
+
+    if ((m_flags.disableResetReleaseResources == 0) &&
+        (m_pSqttState == nullptr)                   &&
+        m_pCmdPool->CanRecycleCmdBuffer(IsSecondaryLevel()))
+    {
+        recycled = (Reset(VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT) == VK_SUCCESS);
+
+        if (recycled)
+        {
+            // The private data slots belong to the freed handle, so drop them the same way FreeApiObject would before
+            // the object can be handed out again.
+            const size_t privateDataSize = m_pDevice->GetPrivateDataSize();
+
+            if (privateDataSize > 0)
+            {
+                void* pPrivateData = Util::VoidPtrDec(ApiCmdBuffer::FromObject(this), privateDataSize);
+
+                m_pDevice->FreeUnreservedPrivateData(pPrivateData);
+                memset(pPrivateData, 0, privateDataSize);
+            }
+
+            recycled = (m_pCmdPool->RecycleCmdBuffer(this) == Pal::Result::Success);
+        }
+    }
+
+    return recycled ? VK_SUCCESS : Destroy();
+}
+
 // =====================================================================================================================
 void CmdBuffer::ReleaseResources()
 {
@@ -2425,6 +2543,7 @@ void CmdBuffer::ReleaseResources()
     }
 
     m_palDepthStencilState.Clear();
+    m_palDepthStencilStateMap.Reset();
 
     for (uint32_t i = 0; i < m_palColorBlendState.NumElements(); ++i)
     {
@@ -2432,6 +2551,7 @@ void CmdBuffer::ReleaseResources()
     }
 
     m_palColorBlendState.Clear();
+    m_palColorBlendStateMap.Reset();
 
     for (uint32_t i = 0; i < m_palMsaaState.NumElements(); ++i)
     {
@@ -2439,6 +2559,7 @@ void CmdBuffer::ReleaseResources()
     }
 
     m_palMsaaState.Clear();
+    m_palMsaaStateMap.Reset();
 
     // Release per-attachment render pass instance memory
     if (m_renderPassInstance.pAttachments != nullptr)
@@ -2494,6 +2615,14 @@ void CmdBuffer::BindDescriptorSets(
         // Update descriptor set binding data shadow.
         VK_ASSERT((firstSet + setCount) <= layoutInfo.setCount);
 
+        // Sets bound through compact layouts are tracked so that rebinding a set which is still current only needs
+        // its dynamic data checked, and only the user data of sets that actually changed is written.
+        const bool     trackSets         = (pLayout->GetScheme() == PipelineLayoutScheme::Compact);
+        const uint32_t setBindingRegBase = layoutInfo.userDataLayout.compact.setBindingRegBase;
+
+        uint32_t firstDirtySet = setCount;
+        uint32_t lastDirtySet  = 0;
+
         for (uint32_t i = 0; i < setCount; ++i)
         {
             if (pDescriptorSets[i] != VK_NULL_HANDLE)
@@ -2512,6 +2641,11 @@ void CmdBuffer::BindDescriptorSets(
                     RegisterWriteToFlippableImage(pImage);
                 }
 
+                const bool wasBound = trackSets && IsDescriptorSetBound(
+                    apiBindPoint, setBindIdx, pDescriptorSets[i], setBindingRegBase, setLayoutInfo);
+
+                bool dirty = (wasBound == false);
+
                 // If this descriptor set has any dynamic descriptor data then write them into the shadow.
                 if (setLayoutInfo.dynDescCount > 0)
                 {
@@ -2521,6 +2655,16 @@ void CmdBuffer::BindDescriptorSets(
                     {
                         const uint32_t deviceIdx = deviceGroup.Index();
 
+                        uint32_t* pSetData =
+                            &(PerGpuState(deviceIdx)->setBindingData[apiBindPoint][setLayoutInfo.firstRegOffset]);
+                        uint32_t  prevSetData[MaxBindingRegCount];
+
+                        // The set is the same, but its dynamic offsets may have changed
+                        if (dirty == false)
+                        {
+                            memcpy(prevSetData, pSetData, setLayoutInfo.totalRegCount * sizeof(uint32_t));
+                        }
+
                         DescriptorSet<numPalDevices>::PatchedDynamicDataFromHandle(
                             pDescriptorSets[i],
                             deviceIdx,
@@ -2530,6 +2674,11 @@ void CmdBuffer::BindDescriptorSets(
                             setLayoutInfo.dynDescCount,
                             useCompactDescriptor);
 
+                        if (dirty == false)
+                        {
+                            dirty = (memcmp(prevSetData, pSetData, setLayoutInfo.totalRegCount * sizeof(uint32_t)) !=
+                                     0);
+                        }
                     }
                     while (deviceGroup.IterateNext());
 
@@ -2537,8 +2686,9 @@ void CmdBuffer::BindDescriptorSets(
                     pDynamicOffsets += setLayoutInfo.dynDescCount;
                 }
 
-                // If this descriptor set needs a set pointer, then write it to the shadow.
-                if (setLayoutInfo.setPtrRegOffset != PipelineLayout::InvalidReg)
+                // If this descriptor set needs a set pointer, then write it to the shadow.  The pointer only depends on
+                // the set, so it is still current if the set was already bound.
+                if ((setLayoutInfo.setPtrRegOffset != PipelineLayout::InvalidReg) && (wasBound == false))
                 {
                     utils::IterateMask deviceGroup(m_curDeviceMask);
 
@@ -2554,10 +2704,42 @@ void CmdBuffer::BindDescriptorSets(
                     }
                     while (deviceGroup.IterateNext());
                 }
+
+                if (trackSets == false)
+                {
+                    InvalidateBoundDescriptorSets(
+                        apiBindPoint, setLayoutInfo.firstRegOffset, setLayoutInfo.totalRegCount);
+                }
+                else if (dirty)
+                {
+                    TrackBoundDescriptorSet(
+                        apiBindPoint, setBindIdx, pDescriptorSets[i], setBindingRegBase, setLayoutInfo);
+                }
+
+                if (dirty)
+                {
+                    firstDirtySet = Util::Min(firstDirtySet, i);
+                    lastDirtySet  = i;
+                }
+                else
+                {
+                    m_perCmdBufSkippedSetBindCounter++;
+                }
+
+                m_perCmdBufSetBindCounter++;
             }
         }
 
-        SetUserDataPipelineLayout(firstSet, setCount, pLayout, palBindPoint, apiBindPoint);
+        if (trackSets == false)
+        {
+            SetUserDataPipelineLayout(firstSet, setCount, pLayout, palBindPoint, apiBindPoint);
+        }
+        else if (firstDirtySet <= lastDirtySet)
+        {
+            // Only the range spanning the changed sets needs to be written
+            SetUserDataPipelineLayout(
+                firstSet + firstDirtySet, (lastDirtySet - firstDirtySet) + 1, pLayout, palBindPoint, apiBindPoint);
+        }
     }
 
     DbgBarrierPostCmd(DbgBarrierBindSetsPushConstants);
@@ -2615,6 +2797,8 @@ void CmdBuffer::BindDescriptorSetsBuffers(
                         static_cast<uint32_t>((bufferAddress + offset) & 0xFFFFFFFFull);
                 }
                 while (deviceGroup.IterateNext());
+
+                InvalidateBoundDescriptorSets(apiBindPoint, setLayoutInfo.setPtrRegOffset, 1);
             }
         }
 
@@ -2738,6 +2922,76 @@ void CmdBuffer::SetUserDataPipelineLayout(
     }
 }
 
+// =====================================================================================================================
+// Returns true if the given descriptor set's user data, as laid out by the given layout, is still current in the set
+// binding data shadow from an earlier bind of the same set.
+bool CmdBuffer::IsDescriptorSetBound(
+    PipelineBindPoint                        apiBindPoint,
+    uint32_t                                 setBindIdx,
+    VkDescriptorSet                          descriptorSet,
+    uint32_t                                 setBindingRegBase,
+    const PipelineLayout::SetUserDataLayout& setLayoutInfo) const
+{
+    const PipelineBindState& bindState = m_allGpuState.pipelineState[apiBindPoint];
+    const BoundDescriptorSet& boundSet = bindState.boundSets[setBindIdx];
+
+    return ((bindState.boundSetValidMask & (1u << setBindIdx)) != 0)                     &&
+           (boundSet.handle                        == descriptorSet)                     &&
+           (boundSet.setBindingRegBase             == setBindingRegBase)                 &&
+           (boundSet.userData.setPtrRegOffset      == setLayoutInfo.setPtrRegOffset)      &&
+           (boundSet.userData.dynDescDataRegOffset == setLayoutInfo.dynDescDataRegOffset) &&
+           (boundSet.userData.dynDescCount         == setLayoutInfo.dynDescCount)         &&
+           (boundSet.userData.firstRegOffset       == setLayoutInfo.firstRegOffset)       &&
+           (boundSet.userData.totalRegCount        == setLayoutInfo.totalRegCount);
+}
+
+// =====================================================================================================================
+// Records that the user data of the given descriptor set has just been written to the set binding data shadow.
+void CmdBuffer::TrackBoundDescriptorSet(
+    PipelineBindPoint                        apiBindPoint,
+    uint32_t                                 setBindIdx,
+    VkDescriptorSet                          descriptorSet,
+    uint32_t                                 setBindingRegBase,
+    const PipelineLayout::SetUserDataLayout& setLayoutInfo)
+{
+    PipelineBindState* pBindState = &m_allGpuState.pipelineState[apiBindPoint];
+
+    // The set may be laid out differently than the sets bound before it, in which case it overwrote their user data
+    InvalidateBoundDescriptorSets(apiBindPoint, setLayoutInfo.firstRegOffset, setLayoutInfo.totalRegCount);
+
+    pBindState->boundSets[setBindIdx].handle            = descriptorSet;
+    pBindState->boundSets[setBindIdx].setBindingRegBase = setBindingRegBase;
+    pBindState->boundSets[setBindIdx].userData          = setLayoutInfo;
+    pBindState->boundSetValidMask                      |= (1u << setBindIdx);
+}
+
+// =====================================================================================================================
+// Stops tracking the bound descriptor sets whose user data overlaps a range of the set binding data shadow which is
+// being overwritten.
+void CmdBuffer::InvalidateBoundDescriptorSets(
+    PipelineBindPoint apiBindPoint,
+    uint32_t          regOffset,
+    uint32_t          regCount)
+{
+    PipelineBindState* pBindState = &m_allGpuState.pipelineState[apiBindPoint];
+
+    uint32_t validMask = pBindState->boundSetValidMask;
+    uint32_t setIdx    = 0;
+
+    while (Util::BitMaskScanForward(&setIdx, validMask))
+    {
+        const PipelineLayout::SetUserDataLayout& userData = pBindState->boundSets[setIdx].userData;
+
+        if ((userData.firstRegOffset < (regOffset + regCount)) &&
+            (regOffset < (userData.firstRegOffset + userData.totalRegCount)))
+        {
+            pBindState->boundSetValidMask &= ~(1u << setIdx);
+        }
+
+        validMask &= ~(1u << setIdx);
+    }
+}
+
 // =====================================================================================================================
 template<uint32_t numPalDevices, bool useCompactDescriptor>
 VKAPI_ATTR void VKAPI_CALL CmdBuffer::CmdBindDescriptorSets(
@@ -5216,6 +5470,8 @@ void CmdBuffer::BeginRendering(
     bool skipEverything = isResuming && m_flags.isRenderingSuspended;
     bool skipClears     = isResuming && (m_flags.isRenderingSuspended == false);
 
+    m_flags.dynamicRenderingStateDirty = true;
+
     m_allGpuState.dynamicRenderingInstance.viewMask = pRenderingInfo->viewMask;
     m_allGpuState.dynamicRenderingInstance.colorAttachmentCount = pRenderingInfo->colorAttachmentCount;
     m_allGpuState.dynamicRenderingInstance.enableResolveTarget = false;
@@ -9862,6 +10118,9 @@ void CmdBuffer::PushDescriptorSet(
         apiBindPoint,
         alignmentInDwords);
 
+    // The pushed set replaces whatever was bound at its user data
+    InvalidateBoundDescriptorSets(apiBindPoint, setLayoutInfo.firstRegOffset, setLayoutInfo.totalRegCount);
+
     DescriptorSet<numPalDevices>* pDestSet = DescriptorSet<numPalDevices>::ObjectFromHandle(pushDescriptorSet);
 
     utils::IterateMask deviceGroup(m_curDeviceMask);
@@ -10078,6 +10337,9 @@ void CmdBuffer::PushDescriptorSetWithTemplate(
         apiBindPoint,
         alignmentInDwords);
 
+    // The pushed set replaces whatever was bound at its user data
+    InvalidateBoundDescriptorSets(apiBindPoint, setLayoutInfo.firstRegOffset, setLayoutInfo.totalRegCount);
+
     // Issue the descriptor template update using the internal descriptor set to use the destination address of the
     // command buffer's shadow rather than descriptor pool memory like regular descriptor sets.
     pTemplate->Update(
@@ -10421,113 +10683,146 @@ void CmdBuffer::SetStencilReference(
 }
 
 // =====================================================================================================================
-// Calculate the hash of dynamic vertex input info
-static uint64_t GetDynamicVertexInputHash(
+// Builds uber-fetch shader internal data according to dynamic vertex input info.  States already translated by this
+// command buffer are found in its own map without taking the device cache lock.  Otherwise the data is taken from the
+// device's cache when possible and built by this command buffer as embedded data if the device cache is disabled or
+// full.
+const DynamicVertexInputInternalData* CmdBuffer::BuildUberFetchShaderInternalData(
     uint32_t                                     vertexBindingDescriptionCount,
     const VkVertexInputBindingDescription2EXT*   pVertexBindingDescriptions,
     uint32_t                                     vertexAttributeDescriptionCount,
     const VkVertexInputAttributeDescription2EXT* pVertexAttributeDescriptions)
 {
-    Util::MetroHash::Hash hash = {};
-    if (vertexBindingDescriptionCount > 0)
-    {
-        VK_ASSERT(vertexAttributeDescriptionCount > 0);
-        Util::MetroHash64 hasher;
-        hasher.Update(reinterpret_cast<const uint8_t*>(pVertexBindingDescriptions),
-            sizeof(VkVertexInputBindingDescription2EXT) * vertexBindingDescriptionCount);
-        hasher.Update(reinterpret_cast<const uint8_t*>(pVertexAttributeDescriptions),
-            sizeof(VkVertexInputAttributeDescription2EXT) * vertexAttributeDescriptionCount);
-        hasher.Finalize(hash.bytes);
-    }
-    return hash.qwords[0];
-}
+    Util::MetroHash::Hash key = {};
 
-// =====================================================================================================================
-// Builds uber-fetch shader internal data according to dynamic vertex input info.
-DynamicVertexInputInternalData* CmdBuffer::BuildUberFetchShaderInternalData(
-    uint32_t                                     vertexBindingDescriptionCount,
-    const VkVertexInputBindingDescription2EXT*   pVertexBindingDescriptions,
-    uint32_t                                     vertexAttributeDescriptionCount,
-    const VkVertexInputAttributeDescription2EXT* pVertexAttributeDescriptions)
-{
-    uint64_t vertexInputHash = GetDynamicVertexInputHash(
+    UberFetchShaderInternalDataCache::BuildKey(
         vertexBindingDescriptionCount,
         pVertexBindingDescriptions,
         vertexAttributeDescriptionCount,
-        pVertexAttributeDescriptions);
+        pVertexAttributeDescriptions,
+        m_flags.offsetMode,
+        &key);
 
     DynamicVertexInputInternalData* pVertexInputData = nullptr;
 
     bool         existed = false;
-    Util::Result result  = m_uberFetchShaderInternalDataMap.FindAllocate(vertexInputHash, &existed, &pVertexInputData);
-    if (result == Util::Result::Success)
-    {
-        if (existed == false)
-        {
-            if (m_pUberFetchShaderTempBuffer == nullptr)
-            {
-                m_pUberFetchShaderTempBuffer = m_pDevice->VkInstance()->AllocMem(
-                    PipelineCompiler::GetMaxUberFetchShaderInternalDataSize() * NumPalDevices(),
-                    VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
-            }
+    Util::Result result  = m_uberFetchShaderInternalDataMap.FindAllocate(key.qwords[0], &existed, &pVertexInputData);
 
-            if (m_pUberFetchShaderTempBuffer != nullptr)
-            {
-                void* pUberFetchShaderInternalData = m_pUberFetchShaderTempBuffer;
-
-                bool isDynamicStride = (m_pDevice->GetEnabledFeatures().deviceGeneratedCommands == true);
-
-                utils::IterateMask deviceGroup(m_curDeviceMask);
-                do
-                {
-                    const uint32_t deviceIdx = deviceGroup.Index();
+    if ((result == Util::Result::Success) && (existed == false))
+    {
+        UberFetchShaderInternalDataCache* pDeviceCache = m_pDevice->GetUberFetchShaderCache();
+        bool                              built        = false;
 
-                    uint32_t uberFetchShaderInternalDataSize =
-                        m_pDevice->GetCompiler(deviceIdx)->BuildUberFetchShaderInternalData(
-                            vertexBindingDescriptionCount,
-                            pVertexBindingDescriptions,
-                            vertexAttributeDescriptionCount,
-                            pVertexAttributeDescriptions,
-                            isDynamicStride,
-                            m_flags.offsetMode,
-                            pUberFetchShaderInternalData);
-
-                    Pal::gpusize gpuAddress = {};
-                    if (uberFetchShaderInternalDataSize > 0)
-                    {
-                        void* pCpuAddr = PalCmdBuffer(deviceIdx)->CmdAllocateEmbeddedData(
-                            uberFetchShaderInternalDataSize, 1, &gpuAddress);
-                        memcpy(pCpuAddr, pUberFetchShaderInternalData, uberFetchShaderInternalDataSize);
-                    }
-                    pVertexInputData->gpuAddress[deviceIdx] = gpuAddress;
+        if (pDeviceCache->IsEnabled())
+        {
+            bool cacheFull = false;
 
-                    pUberFetchShaderInternalData =
-                        Util::VoidPtrInc(pUberFetchShaderInternalData, uberFetchShaderInternalDataSize);
-                } while (deviceGroup.IterateNext());
+            const DynamicVertexInputInternalData* pPublished = pDeviceCache->GetInternalData(
+                key,
+                vertexBindingDescriptionCount,
+                pVertexBindingDescriptions,
+                vertexAttributeDescriptionCount,
+                pVertexAttributeDescriptions,
+                m_flags.offsetMode,
+                &cacheFull);
 
-                // we needn't set any user data if internal size is 0.
-                if (pVertexInputData->gpuAddress[0] == 0)
-                {
-                    pVertexInputData = nullptr;
-                }
-            }
-            else
+            if (pPublished != nullptr)
             {
-                // return nullptr for any fail case.
-                VK_NEVER_CALLED();
-                pVertexInputData = nullptr;
+                *pVertexInputData = *pPublished;
+                built             = true;
             }
         }
+
+        if (built == false)
+        {
+            built = BuildEmbeddedUberFetchShaderInternalData(
+                vertexBindingDescriptionCount,
+                pVertexBindingDescriptions,
+                vertexAttributeDescriptionCount,
+                pVertexAttributeDescriptions,
+                pVertexInputData);
+        }
+
+        if (built == false)
+        {
+            // return nullptr for any fail case.
+            VK_NEVER_CALLED();
+            m_uberFetchShaderInternalDataMap.Erase(key.qwords[0]);
+            pVertexInputData = nullptr;
+        }
     }
-    else
+    else if (result != Util::Result::Success)
     {
         VK_NEVER_CALLED();
         pVertexInputData = nullptr;
     }
 
+    // we needn't set any user data if internal size is 0.
+    if ((pVertexInputData != nullptr) && (pVertexInputData->gpuAddress[DefaultDeviceIndex] == 0))
+    {
+        pVertexInputData = nullptr;
+    }
+
     return pVertexInputData;
 }
 
+// =====================================================================================================================
+// Builds uber-fetch shader internal data for this command buffer only and uploads it as embedded data.  Returns false
+// if the staging memory could not be allocated.
+bool CmdBuffer::BuildEmbeddedUberFetchShaderInternalData(
+    uint32_t                                     vertexBindingDescriptionCount,
+    const VkVertexInputBindingDescription2EXT*   pVertexBindingDescriptions,
+    uint32_t                                     vertexAttributeDescriptionCount,
+    const VkVertexInputAttributeDescription2EXT* pVertexAttributeDescriptions,
+    DynamicVertexInputInternalData*              pVertexInputData)
+{
+    if (m_pUberFetchShaderTempBuffer == nullptr)
+    {
+        m_pUberFetchShaderTempBuffer = m_pDevice->VkInstance()->AllocMem(
+            PipelineCompiler::GetMaxUberFetchShaderInternalDataSize() * NumPalDevices(),
+            VK_SYSTEM_ALLOCATION_SCOPE_COMMAND);
+    }
+
+    if (m_pUberFetchShaderTempBuffer != nullptr)
+    {
+        void* pUberFetchShaderInternalData = m_pUberFetchShaderTempBuffer;
+
+        bool isDynamicStride = (m_pDevice->GetEnabledFeatures().deviceGeneratedCommands == true);
+
+        memset(pVertexInputData, 0, sizeof(*pVertexInputData));
+
+        utils::IterateMask deviceGroup(m_curDeviceMask);
+        do
+        {
+            const uint32_t deviceIdx = deviceGroup.Index();
+
+            uint32_t uberFetchShaderInternalDataSize =
+                m_pDevice->GetCompiler(deviceIdx)->BuildUberFetchShaderInternalData(
+                    vertexBindingDescriptionCount,
+                    pVertexBindingDescriptions,
+                    vertexAttributeDescriptionCount,
+                    pVertexAttributeDescriptions,
+                    isDynamicStride,
+                    m_flags.offsetMode,
+                    pUberFetchShaderInternalData);
+
+            Pal::gpusize gpuAddress = {};
+            if (uberFetchShaderInternalDataSize > 0)
+            {
+                void* pCpuAddr = PalCmdBuffer(deviceIdx)->CmdAllocateEmbeddedData(
+                    uberFetchShaderInternalDataSize, 1, &gpuAddress);
+                memcpy(pCpuAddr, pUberFetchShaderInternalData, uberFetchShaderInternalDataSize);
+            }
+            pVertexInputData->gpuAddress[deviceIdx] = gpuAddress;
+
+            pUberFetchShaderInternalData =
+                Util::VoidPtrInc(pUberFetchShaderInternalData, uberFetchShaderInternalDataSize);
+        } while (deviceGroup.IterateNext());
+    }
+
+    return (m_pUberFetchShaderTempBuffer != nullptr);
+}
+
 // =====================================================================================================================
 void CmdBuffer::SetVertexInput(
     uint32_t                                     vertexBindingDescriptionCount,
@@ -10647,6 +10942,8 @@ void CmdBuffer::SetRenderingAttachmentLocations(
     if ((pLocationInfo                            != nullptr) &&
         (pLocationInfo->pColorAttachmentLocations != nullptr))
     {
+        m_flags.dynamicRenderingStateDirty = true;
+
         for (uint32_t i = 0; i < pLocationInfo->colorAttachmentCount; ++i)
         {
             m_allGpuState.dynamicRenderingInstance.colorAttachmentLocations[i] =
@@ -12136,6 +12433,8 @@ void CmdBuffer::BindDescriptorBuffers(
         VK_ASSERT(pBindingInfos[ndx].sType == VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT);
         m_allGpuState.pDescBufBinding->baseAddr[ndx] = pBindingInfos[ndx].address;
     }
+
+    m_descBufBindingWatermark = Util::Max(m_descBufBindingWatermark, bufferCount);
 }
 
 // =====================================================================================================================
@@ -12231,6 +12530,8 @@ void CmdBuffer::BindDescriptorBufferEmbeddedSamplers(
         }
         while (deviceGroup.IterateNext());
 
+        InvalidateBoundDescriptorSets(apiBindPoint, setLayoutInfo.setPtrRegOffset, 1);
+
         SetUserDataPipelineLayout(set, 1, pLayout, palBindPoint, apiBindPoint);
     }
 }
@@ -12458,33 +12759,46 @@ void CmdBuffer::ValidateGraphicsStates()
                         }
                     }
 
-                    pRSCache->CreateColorBlendState(colorBlendCreateInfo,
-                        m_pDevice->VkInstance()->GetAllocCallbacks(),
-                        VK_SYSTEM_ALLOCATION_SCOPE_OBJECT,
-                        colorBlend.pPalColorBlend);
+                    // Reuse the object this command buffer already references for the same create info without
+                    // going through the render state cache.
+                    const uint32_t* pIndex = m_palColorBlendStateMap.FindKey(colorBlendCreateInfo);
 
-                    // Check if pPalColorBlend is already in the m_palColorBlendState, destroy it and use the old one
-                    // if yes.The destroy is not expensive since it's just a refCount--.
-                    for (uint32_t i = 0; i < m_palColorBlendState.NumElements(); ++i)
+                    if (pIndex != nullptr)
+                    {
+                        pColorBlend = &m_palColorBlendState.At(*pIndex);
+                    }
+                    else
                     {
-                        const DynamicColorBlend& palColorBlendState = m_palColorBlendState.At(i);
+                        pRSCache->CreateColorBlendState(colorBlendCreateInfo,
+                            m_pDevice->VkInstance()->GetAllocCallbacks(),
+                            VK_SYSTEM_ALLOCATION_SCOPE_OBJECT,
+                            colorBlend.pPalColorBlend);
 
-                        // Check device0 only should be sufficient
-                        if (palColorBlendState.pPalColorBlend[0] == colorBlend.pPalColorBlend[0])
+                        uint32_t index = 0;
+
+                        // Check if pPalColorBlend is already in the m_palColorBlendState, destroy it and use the old
+                        // one if yes.The destroy is not expensive since it's just a refCount--.
+                        for (; index < m_palColorBlendState.NumElements(); ++index)
                         {
-                            pRSCache->DestroyColorBlendState(colorBlend.pPalColorBlend,
-                                m_pDevice->VkInstance()->GetAllocCallbacks());
+                            // Check device0 only should be sufficient
+                            if (m_palColorBlendState.At(index).pPalColorBlend[0] == colorBlend.pPalColorBlend[0])
+                            {
+                                pRSCache->DestroyColorBlendState(colorBlend.pPalColorBlend,
+                                    m_pDevice->VkInstance()->GetAllocCallbacks());
+                                break;
+                            }
+                        }
 
-                            pColorBlend = &palColorBlendState;
-                            break;
+                        // Add it to the m_palColorBlendState if it doesn't exist
+                        if (index == m_palColorBlendState.NumElements())
+                        {
+                            m_palColorBlendState.PushBack(colorBlend);
                         }
-                    }
 
-                    // Add it to the m_palColorBlendState if it doesn't exist
-                    if (pColorBlend == nullptr)
-                    {
-                        m_palColorBlendState.PushBack(colorBlend);
-                        pColorBlend = &m_palColorBlendState.Back();
+                        pColorBlend = &m_palColorBlendState.At(index);
+
+                        // A failed insert only costs a later trip through the render state cache
+                        m_palColorBlendStateMap.Insert(colorBlendCreateInfo, index);
                     }
                 }
 
@@ -12660,33 +12974,44 @@ void CmdBuffer::ValidateGraphicsStates()
                 {
                     DynamicDepthStencil depthStencil = {};
 
-                    pRSCache->CreateDepthStencilState(m_allGpuState.depthStencilCreateInfo,
-                                                      m_pDevice->VkInstance()->GetAllocCallbacks(),
-                                                      VK_SYSTEM_ALLOCATION_SCOPE_OBJECT,
-                                                      depthStencil.pPalDepthStencil);
+                    const uint32_t* pIndex = m_palDepthStencilStateMap.FindKey(m_allGpuState.depthStencilCreateInfo);
 
-                    // Check if pPalDepthStencil is already in the m_allGpuState.palDepthStencilState, destroy it
-                    // and use the old one if yes. The destroy is not expensive since it's just a refCount--.
-                    for (uint32_t i = 0; i < m_palDepthStencilState.NumElements(); ++i)
+                    if (pIndex != nullptr)
+                    {
+                        pDepthStencil = &m_palDepthStencilState.At(*pIndex);
+                    }
+                    else
                     {
-                        const DynamicDepthStencil& palDepthStencilState = m_palDepthStencilState.At(i);
+                        pRSCache->CreateDepthStencilState(m_allGpuState.depthStencilCreateInfo,
+                                                          m_pDevice->VkInstance()->GetAllocCallbacks(),
+                                                          VK_SYSTEM_ALLOCATION_SCOPE_OBJECT,
+                                                          depthStencil.pPalDepthStencil);
+
+                        uint32_t index = 0;
 
-                        // Check device0 only should be sufficient
-                        if (palDepthStencilState.pPalDepthStencil[0] == depthStencil.pPalDepthStencil[0])
+                        // Check if pPalDepthStencil is already in the m_allGpuState.palDepthStencilState, destroy it
+                        // and use the old one if yes. The destroy is not expensive since it's just a refCount--.
+                        for (; index < m_palDepthStencilState.NumElements(); ++index)
                         {
-                            pRSCache->DestroyDepthStencilState(depthStencil.pPalDepthStencil,
-                                                               m_pDevice->VkInstance()->GetAllocCallbacks());
+                            // Check device0 only should be sufficient
+                            if (m_palDepthStencilState.At(index).pPalDepthStencil[0] ==
+                                depthStencil.pPalDepthStencil[0])
+                            {
+                                pRSCache->DestroyDepthStencilState(depthStencil.pPalDepthStencil,
+                                                                   m_pDevice->VkInstance()->GetAllocCallbacks());
+                                break;
+                            }
+                        }
 
-                            pDepthStencil = &palDepthStencilState;
-                            break;
+                        // Add it to the m_palDepthStencilState if it doesn't exist
+                        if (index == m_palDepthStencilState.NumElements())
+                        {
+                            m_palDepthStencilState.PushBack(depthStencil);
                         }
-                    }
 
-                    // Add it to the m_palDepthStencilState if it doesn't exist
-                    if (pDepthStencil == nullptr)
-                    {
-                        m_palDepthStencilState.PushBack(depthStencil);
-                        pDepthStencil = &m_palDepthStencilState.Back();
+                        pDepthStencil = &m_palDepthStencilState.At(index);
+
+                        m_palDepthStencilStateMap.Insert(m_allGpuState.depthStencilCreateInfo, index);
                     }
                 }
 
@@ -12720,33 +13045,43 @@ void CmdBuffer::ValidateGraphicsStates()
                 {
                     DynamicMsaa msaa = {};
 
-                    pRSCache->CreateMsaaState(m_allGpuState.msaaCreateInfo,
-                        m_pDevice->VkInstance()->GetAllocCallbacks(),
-                        VK_SYSTEM_ALLOCATION_SCOPE_OBJECT,
-                        msaa.pPalMsaa);
+                    const uint32_t* pIndex = m_palMsaaStateMap.FindKey(m_allGpuState.msaaCreateInfo);
 
-                    // Check if pPalMsaa is already in the m_palMsaaState, destroy it and use the old one if yes.
-                    // The destroy is not expensive since it's just a refCount--.
-                    for (uint32_t i = 0; i < m_palMsaaState.NumElements(); ++i)
+                    if (pIndex != nullptr)
                     {
-                        const DynamicMsaa& palMsaaState = m_palMsaaState.At(i);
+                        pMsaa = &m_palMsaaState.At(*pIndex);
+                    }
+                    else
+                    {
+                        pRSCache->CreateMsaaState(m_allGpuState.msaaCreateInfo,
+                            m_pDevice->VkInstance()->GetAllocCallbacks(),
+                            VK_SYSTEM_ALLOCATION_SCOPE_OBJECT,
+                            msaa.pPalMsaa);
+
+                        uint32_t index = 0;
 
-                        // Check device0 only should be sufficient
-                        if (palMsaaState.pPalMsaa[0] == msaa.pPalMsaa[0])
+                        // Check if pPalMsaa is already in the m_palMsaaState, destroy it and use the old one if yes.
+                        // The destroy is not expensive since it's just a refCount--.
+                        for (; index < m_palMsaaState.NumElements(); ++index)
                         {
-                            pRSCache->DestroyMsaaState(msaa.pPalMsaa,
-                                m_pDevice->VkInstance()->GetAllocCallbacks());
+                            // Check device0 only should be sufficient
+                            if (m_palMsaaState.At(index).pPalMsaa[0] == msaa.pPalMsaa[0])
+                            {
+                                pRSCache->DestroyMsaaState(msaa.pPalMsaa,
+                                    m_pDevice->VkInstance()->GetAllocCallbacks());
+                                break;
+                            }
+                        }
 
-                            pMsaa = &palMsaaState;
-                            break;
+                        // Add it to the m_palMsaaState if it doesn't exist
+                        if (index == m_palMsaaState.NumElements())
+                        {
+                            m_palMsaaState.PushBack(msaa);
                         }
-                    }
 
-                    // Add it to the m_palMsaaState if it doesn't exist
-                    if (pMsaa == nullptr)
-                    {
-                        m_palMsaaState.PushBack(msaa);
-                        pMsaa = &m_palMsaaState.Back();
+                        pMsaa = &m_palMsaaState.At(index);
+
+                        m_palMsaaStateMap.Insert(m_allGpuState.msaaCreateInfo, index);
                     }
                 }
 
@@ -164,6 +164,8 @@ VkResult ComputePipeline::CreatePipelineBinaries(
         VkResult convertResult = VK_ERROR_UNKNOWN;
         if (shouldConvert)
         {
+            const int64_t convertStartTime = Util::GetPerfCpuTime();
+
             convertResult = pDefaultCompiler->ConvertComputePipelineInfo(
                 pDevice,
                 pCreateInfo,
@@ -175,6 +177,9 @@ VkResult ComputePipeline::CreatePipelineBinaries(
                 pBinaryCreateInfo,
                 flags);
             result = (result == VK_SUCCESS) ? convertResult : result;
+
+            PipelineCompiler::RecordPipelineCreationPhase(
+                &pBinaryCreateInfo->pipelineFeedback, PipelineCreationPhaseConvertInfo, convertStartTime);
         }
 
         if ((result == VK_SUCCESS) && (convertResult == VK_SUCCESS) && shouldCompile)
@@ -206,6 +211,8 @@ VkResult ComputePipeline::CreatePipelineBinaries(
         {
             if (result == VK_SUCCESS)
             {
+                const int64_t compileStartTime = Util::GetPerfCpuTime();
+
                 result = pDevice->GetCompiler(deviceIdx)->CreateComputePipelineBinary(
                     pDevice,
                     deviceIdx,
@@ -213,6 +220,9 @@ VkResult ComputePipeline::CreatePipelineBinaries(
                     pBinaryCreateInfo,
                     &pPipelineBinaries[deviceIdx],
                     &pCacheIds[deviceIdx]);
+
+                PipelineCompiler::RecordPipelineCreationPhase(
+                    &pBinaryCreateInfo->pipelineFeedback, PipelineCreationPhaseCompile, compileStartTime);
             }
 
             if (result == VK_SUCCESS)
@@ -604,7 +614,8 @@ VkResult ComputePipeline::Create(
 
     if (result == VK_SUCCESS)
     {
-        void* pPalMem = Util::VoidPtrInc(pSystemMem, sizeof(ComputePipeline));
+        const int64_t palCreateStartTime = Util::GetPerfCpuTime();
+        void*         pPalMem            = Util::VoidPtrInc(pSystemMem, sizeof(ComputePipeline));
 
         for (uint32_t deviceIdx = 0;
             ((deviceIdx < pDevice->NumPalDevices()) && (palResult == Pal::Result::Success));
@@ -660,6 +671,9 @@ VkResult ComputePipeline::Create(
 
         result = PalToVkResult(palResult);
 
+        PipelineCompiler::RecordPipelineCreationPhase(
+            &binaryCreateInfo.pipelineFeedback, PipelineCreationPhasePalCreate, palCreateStartTime);
+
         if ((result == VK_SUCCESS) && storeBinaryToPipeline)
         {
             size_t pipelineBinaryOffset = sizeof(ComputePipeline) + (pipelineSize * pDevice->NumPalDevices());
@@ -759,6 +773,9 @@ VkResult ComputePipeline::Create(
         binaryCreateInfo.pipelineFeedback.feedbackValid = true;
         binaryCreateInfo.pipelineFeedback.duration      = duration;
 
+        pDefaultCompiler->GetTelemetry()->RecordPipelineCreation(
+            PipelineTelemetryType::Compute, binaryCreateInfo.pipelineFeedback);
+
         PipelineCompiler::SetPipelineCreationFeedbackInfo(
             pPipelineCreationFeedbackCreateInfo,
             0,
@@ -811,7 +828,9 @@ VkResult ComputePipeline::CreateCacheId(
     ShaderModuleHandle*                     pTempModule,
     Util::MetroHash::Hash*                  pCacheIds)
 {
-    VkResult result = VK_SUCCESS;
+    VkResult                  result    = VK_SUCCESS;
+    PipelineCreationFeedback* pFeedback = &pBinaryCreateInfo->pipelineFeedback;
+    int64_t                   phaseTime = Util::GetPerfCpuTime();
 
     // 1. Build shader stage info
     result = BuildShaderStageInfo(pDevice,
@@ -841,9 +860,12 @@ VkResult ComputePipeline::CreateCacheId(
                                                                 pShaderInfo->stage.codeSize,
                                                                 pPipelineOptimizerKey->pShaders);
 
+        phaseTime = PipelineCompiler::RecordPipelineCreationPhase(pFeedback, PipelineCreationPhaseCacheId, phaseTime);
+
         // 3. Build API and ELF hashes
         Util::MetroHash::Hash elfHash    = {};
         BuildApiHash(pCreateInfo, flags, *pShaderInfo, &elfHash, pApiPsoHash);
+        phaseTime = PipelineCompiler::RecordPipelineCreationPhase(pFeedback, PipelineCreationPhaseApiHash, phaseTime);
 
         // 4. Build Cache IDs
         for (uint32_t deviceIdx = 0; deviceIdx < pDevice->NumPalDevices(); ++deviceIdx)
@@ -858,6 +880,8 @@ VkResult ComputePipeline::CreateCacheId(
         }
     }
 
+    PipelineCompiler::RecordPipelineCreationPhase(pFeedback, PipelineCreationPhaseCacheId, phaseTime);
+
     return result;
 }
 
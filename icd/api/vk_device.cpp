@@ -271,6 +271,8 @@ Device::Device(
     m_pipelineBinningMode(m_settings.pipelineBinningMode),
     m_resourceOptimizer(this, pPhysicalDevices[DefaultDeviceIndex]),
     m_renderStateCache(this),
+    m_gplLinkCache(this),
+    m_uberFetchShaderCache(this),
     m_barrierPolicy(
         pPhysicalDevices[DefaultDeviceIndex],
         pCreateInfo,
@@ -1175,6 +1177,18 @@ VkResult Device::Initialize(
         result = m_renderStateCache.Init();
     }
 
+    // Initialize the GPL fast-link cache
+    if (result == VK_SUCCESS)
+    {
+        result = m_gplLinkCache.Init();
+    }
+
+    // Initialize the uber-fetch shader internal data cache
+    if (result == VK_SUCCESS)
+    {
+        result = m_uberFetchShaderCache.Init();
+    }
+
     memcpy(&m_pQueues, pQueues, sizeof(m_pQueues));
     const Pal::DeviceProperties& deviceProps = pPhysicalDevice->PalProperties();
 
@@ -1477,6 +1491,12 @@ VkResult Device::Initialize(
         result = AllocBorderColorPalette();
     }
 
+    if ((result == VK_SUCCESS) && m_enabledFeatures.graphicsPipelineLibrary)
+    {
+        // Load the color export shaders recorded by previous runs in the background before the first GPL links.
+        GetCompiler(DefaultDeviceIndex)->PrewarmColorExportShaderLibraries(this);
+    }
+
     if (IsExtensionEnabled(DeviceExtensions::KHR_COOPERATIVE_MATRIX))
     {
         VkResult powerRes = PalToVkResult(PalDevice(DefaultDeviceIndex)->SetMlPowerOptimization(true));
@@ -1833,6 +1853,23 @@ VkResult Device::Destroy(const VkAllocationCallbacks* pAllocator)
         }
     }
 
+    if (m_enabledFeatures.graphicsPipelineLibrary)
+    {
+        GetCompiler(DefaultDeviceIndex)->WaitForColorExportShaderPrewarm(this);
+    }
+
+    // The compiler outlives the device, so snapshot what the device's pipelines contributed now rather than only when
+    // the instance is destroyed.
+    if (m_settings.pipelineTelemetryDumpInterval != 0)
+    {
+        GetCompiler(DefaultDeviceIndex)->RequestTelemetryDump();
+    }
+
+    // Cached links reference the null fragment and color export libraries, so release them first.
+    m_gplLinkCache.Destroy();
+
+    m_uberFetchShaderCache.Destroy();
+
     DestroyInternalPipelines();
 
     DestroySharedPalCmdAllocator();
@@ -2790,6 +2827,204 @@ VkResult Device::CreateImageView(
     return ImageView::Create(this, pCreateInfo, pAllocator, pView);
 }
 
+// =====================================================================================================================
+// State shared by all threads creating the pipelines of a single vkCreate*Pipelines batch
+template<typename CreateInfo>
+struct PipelineBatchCreateState
+{
+    Device*                      pDevice;
+    PipelineCache*               pPipelineCache;
+    const CreateInfo*            pCreateInfos;
+    const VkAllocationCallbacks* pAllocator;
+    VkPipeline*                  pPipelines;
+    VkResult*                    pResults;         // Creation result per pipeline
+    uint32_t                     count;
+    volatile uint32_t            nextIndex;        // Index of the next pipeline to be picked up by a thread
+    volatile uint32_t            earlyReturnIndex; // Lowest index which failed with EARLY_RETURN_ON_FAILURE, or UINT_MAX
+};
+
+// =====================================================================================================================
+static VkResult CreatePipeline(
+    Device*                             pDevice,
+    PipelineCache*                      pPipelineCache,
+    const VkGraphicsPipelineCreateInfo* pCreateInfo,
+    VkPipelineCreateFlags2KHR           flags,
+    const VkAllocationCallbacks*        pAllocator,
+    VkPipeline*                         pPipeline)
+{
+    return GraphicsPipelineCommon::Create(pDevice, pPipelineCache, pCreateInfo, flags, pAllocator, pPipeline);
+}
+
+// =====================================================================================================================
+static VkResult CreatePipeline(
+    Device*                             pDevice,
+    PipelineCache*                      pPipelineCache,
+    const VkComputePipelineCreateInfo*  pCreateInfo,
+    VkPipelineCreateFlags2KHR           flags,
+    const VkAllocationCallbacks*        pAllocator,
+    VkPipeline*                         pPipeline)
+{
+    return ComputePipeline::Create(pDevice, pPipelineCache, pCreateInfo, flags, pAllocator, pPipeline);
+}
+
+// =====================================================================================================================
+// Creates pipelines of a batch until none are left. Executed by the calling thread and the helper threads alike.
+template<typename CreateInfo>
+static void CreateBatchedPipelines(
+    void* pPayload)
+{
+    auto pState = static_cast<PipelineBatchCreateState<CreateInfo>*>(pPayload);
+
+    uint32_t index = Util::AtomicIncrement(&pState->nextIndex) - 1;
+
+    // Pipelines following an early return failure are discarded anyway, so stop picking up pipelines once one failed.
+    // Indices are handed out in order, so every pipeline preceding the failure has already been picked up.
+    while ((index < pState->count) && (index < pState->earlyReturnIndex))
+    {
+        const CreateInfo*         pCreateInfo = &pState->pCreateInfos[index];
+        VkPipelineCreateFlags2KHR flags       = Device::GetPipelineCreateFlags(pCreateInfo);
+
+        VkResult result = CreatePipeline(
+            pState->pDevice,
+            pState->pPipelineCache,
+            pCreateInfo,
+            flags,
+            pState->pAllocator,
+            &pState->pPipelines[index]);
+
+        pState->pResults[index] = result;
+
+        if ((result != VK_SUCCESS) && (flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT))
+        {
+            uint32_t prevIndex = pState->earlyReturnIndex;
+
+            while (index < prevIndex)
+            {
+                const uint32_t oldIndex = Util::AtomicCompareAndSwap(&pState->earlyReturnIndex, prevIndex, index);
+
+                prevIndex = (oldIndex == prevIndex) ? index : oldIndex;
+            }
+
+            // Don't hand out any further indices, so that no thread starts creating a pipeline past the failure.
+            Util::AtomicExchange(&pState->nextIndex, pState->count);
+        }
+
+        index = Util::AtomicIncrement(&pState->nextIndex) - 1;
+    }
+}
+
+// =====================================================================================================================
+// Creates a batch of pipelines on the calling thread with the help of the compiler's worker threads. The outcome
+// matches creating the pipelines in order: the first failure in index order is returned, and every pipeline following
+// a failure with VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT is VK_NULL_HANDLE.
+template<typename CreateInfo>
+static VkResult CreatePipelinesParallel(
+    Device*                      pDevice,
+    PipelineCache*               pPipelineCache,
+    uint32_t                     count,
+    const CreateInfo*            pCreateInfos,
+    const VkAllocationCallbacks* pAllocator,
+    VkPipeline*                  pPipelines,
+    uint32_t                     helperCount)
+{
+    VkResult          finalResult = VK_SUCCESS;
+    PipelineCompiler* pCompiler   = pDevice->GetCompiler(DefaultDeviceIndex);
+
+    Util::AutoBuffer<VkResult, 16, PalAllocator> results(count, pDevice->VkInstance()->Allocator());
+
+    if (results.Capacity() < count)
+    {
+        finalResult = VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            results[i] = VK_SUCCESS;
+        }
+
+        PipelineBatchCreateState<CreateInfo> state = {};
+        state.pDevice          = pDevice;
+        state.pPipelineCache   = pPipelineCache;
+        state.pCreateInfos     = pCreateInfos;
+        state.pAllocator       = pAllocator;
+        state.pPipelines       = pPipelines;
+        state.pResults         = &results[0];
+        state.count            = count;
+        state.nextIndex        = 0;
+        state.earlyReturnIndex = UINT_MAX;
+
+        DeferCompileTaskGroup helperGroup;
+
+        // Without the group the calling thread can't wait for helpers, so it creates the whole batch by itself.
+        if (helperGroup.Init() != Util::Result::Success)
+        {
+            helperCount = 0;
+        }
+
+        DeferredCompileWorkload helperWorkload = {};
+        helperWorkload.pPayloads = &state;
+        helperWorkload.Execute   = &CreateBatchedPipelines<CreateInfo>;
+        helperWorkload.pGroup    = &helperGroup;
+
+        // The calling thread blocks until the helpers are done, so let them jump ahead of other queued work.
+        helperWorkload.priority  = DeferCompilePriority::High;
+
+        helperGroup.AddTasks(helperCount);
+
+        for (uint32_t i = 0; i < helperCount; ++i)
+        {
+            pCompiler->ExecuteDeferCompile(&helperWorkload);
+        }
+
+        // The calling thread takes part in the batch as well and then runs the helpers no worker has picked up yet,
+        // which guarantees progress if the helper threads are busy with other work.
+        CreateBatchedPipelines<CreateInfo>(&state);
+
+        pCompiler->WaitDeferCompileGroup(&helperGroup);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (i > state.earlyReturnIndex)
+            {
+                // This pipeline may have been created before the failure was seen, drop it to match serial creation.
+                if (pPipelines[i] != VK_NULL_HANDLE)
+                {
+                    Pipeline::BaseObjectFromHandle(pPipelines[i])->Destroy(pDevice, pAllocator);
+                    pPipelines[i] = VK_NULL_HANDLE;
+                }
+            }
+            else if (results[i] != VK_SUCCESS)
+            {
+                // In case of failure, VK_NULL_HANDLE must be set
+                VK_ASSERT(pPipelines[i] == VK_NULL_HANDLE);
+
+                // Capture the first failure result and save it to be returned
+                finalResult = (finalResult != VK_SUCCESS) ? finalResult : results[i];
+            }
+        }
+    }
+
+    return finalResult;
+}
+
+// =====================================================================================================================
+// Returns the number of worker threads which should help creating a batch of count pipelines, 0 for serial creation.
+uint32_t Device::GetPipelineCreateHelperCount(
+    uint32_t                     count,
+    const VkAllocationCallbacks* pAllocator) const
+{
+    uint32_t helperCount = 0;
+
+    // Command-specific allocation callbacks are only ever called from the application thread issuing the command.
+    if ((count > 1) && (pAllocator == VkInstance()->GetAllocCallbacks()))
+    {
+        helperCount = Util::Min(GetCompiler(DefaultDeviceIndex)->GetDeferCompileThreadCount(), count - 1);
+    }
+
+    return helperCount;
+}
+
 // =====================================================================================================================
 VkResult Device::CreateGraphicsPipelines(
     VkPipelineCache                             pipelineCache,
@@ -2810,30 +3045,40 @@ VkResult Device::CreateGraphicsPipelines(
         pPipelines[i] = VK_NULL_HANDLE;
     }
 
-    for (uint32_t i = 0; i < count; ++i)
-    {
-        const VkGraphicsPipelineCreateInfo* pCreateInfo = &pCreateInfos[i];
-        VkPipelineCreateFlags2KHR flags = GetPipelineCreateFlags(pCreateInfo);
+    const uint32_t helperCount = GetPipelineCreateHelperCount(count, pAllocator);
 
-        VkResult result = GraphicsPipelineCommon::Create(
-            this,
-            pPipelineCache,
-            pCreateInfo,
-            flags,
-            pAllocator,
-            &pPipelines[i]);
-
-        if (result != VK_SUCCESS)
+    if (helperCount > 0)
+    {
+        finalResult = CreatePipelinesParallel(
+            this, pPipelineCache, count, pCreateInfos, pAllocator, pPipelines, helperCount);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < count; ++i)
         {
-            // In case of failure, VK_NULL_HANDLE must be set
-            VK_ASSERT(pPipelines[i] == VK_NULL_HANDLE);
+            const VkGraphicsPipelineCreateInfo* pCreateInfo = &pCreateInfos[i];
+            VkPipelineCreateFlags2KHR flags = GetPipelineCreateFlags(pCreateInfo);
 
-            // Capture the first failure result and save it to be returned
-            finalResult = (finalResult != VK_SUCCESS) ? finalResult : result;
+            VkResult result = GraphicsPipelineCommon::Create(
+                this,
+                pPipelineCache,
+                pCreateInfo,
+                flags,
+                pAllocator,
+                &pPipelines[i]);
 
-            if (flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT)
+            if (result != VK_SUCCESS)
             {
-                break;
+                // In case of failure, VK_NULL_HANDLE must be set
+                VK_ASSERT(pPipelines[i] == VK_NULL_HANDLE);
+
+                // Capture the first failure result and save it to be returned
+                finalResult = (finalResult != VK_SUCCESS) ? finalResult : result;
+
+                if (flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT)
+                {
+                    break;
+                }
             }
         }
     }
@@ -2861,11 +3106,20 @@ VkResult Device::CreateComputePipelines(
         pPipelines[i] = VK_NULL_HANDLE;
     }
 
-    for (uint32_t i = 0; i < count; ++i)
+    const uint32_t helperCount = GetPipelineCreateHelperCount(count, pAllocator);
+
+    if (helperCount > 0)
+    {
+        finalResult = CreatePipelinesParallel(
+            this, pPipelineCache, count, pCreateInfos, pAllocator, pPipelines, helperCount);
+    }
+    else
     {
-        const VkComputePipelineCreateInfo* pCreateInfo = &pCreateInfos[i];
-        VkPipelineCreateFlags2KHR flags = GetPipelineCreateFlags(pCreateInfo);
-        VkResult result = VK_SUCCESS;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const VkComputePipelineCreateInfo* pCreateInfo = &pCreateInfos[i];
+            VkPipelineCreateFlags2KHR flags = GetPipelineCreateFlags(pCreateInfo);
+            VkResult result = VK_SUCCESS;
 
             result = ComputePipeline::Create(
                 this,
@@ -2875,17 +3129,18 @@ VkResult Device::CreateComputePipelines(
                 pAllocator,
                 &pPipelines[i]);
 
-        if (result != VK_SUCCESS)
-        {
-            // In case of failure, VK_NULL_HANDLE must be set
-            VK_ASSERT(pPipelines[i] == VK_NULL_HANDLE);
+            if (result != VK_SUCCESS)
+            {
+                // In case of failure, VK_NULL_HANDLE must be set
+                VK_ASSERT(pPipelines[i] == VK_NULL_HANDLE);
 
-            // Capture the first failure result and save it to be returned
-            finalResult = (finalResult != VK_SUCCESS) ? finalResult : result;
+                // Capture the first failure result and save it to be returned
+                finalResult = (finalResult != VK_SUCCESS) ? finalResult : result;
 
-            if (flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT)
-            {
-                break;
+                if (flags & VK_PIPELINE_CREATE_EARLY_RETURN_ON_FAILURE_BIT_EXT)
+                {
+                    break;
+                }
             }
         }
     }
@@ -129,6 +129,8 @@ VkResult GraphicsPipeline::CreatePipelineBinaries(
         VkResult convertResult = VK_ERROR_UNKNOWN;
         if (shouldConvert)
         {
+            const int64_t convertStartTime = Util::GetPerfCpuTime();
+
             convertResult = pDefaultCompiler->ConvertGraphicsPipelineInfo(
                 pDevice,
                 pCreateInfo,
@@ -154,6 +156,9 @@ VkResult GraphicsPipeline::CreatePipelineBinaries(
             }
 
             result = (result == VK_SUCCESS) ? convertResult : result;
+
+            PipelineCompiler::RecordPipelineCreationPhase(
+                &pBinaryCreateInfo->pipelineFeedback, PipelineCreationPhaseConvertInfo, convertStartTime);
         }
 
         if ((result == VK_SUCCESS) && (convertResult == VK_SUCCESS) && shouldCompile)
@@ -193,6 +198,8 @@ VkResult GraphicsPipeline::CreatePipelineBinaries(
             {
                 if ((deviceIdx == DefaultDeviceIndex) || (pCreateInfo == nullptr))
                 {
+                    const int64_t compileStartTime = Util::GetPerfCpuTime();
+
                     result = pDefaultCompiler->CreateGraphicsPipelineBinary(
                         pDevice,
                         deviceIdx,
@@ -202,6 +209,9 @@ VkResult GraphicsPipeline::CreatePipelineBinaries(
                         &pPipelineBinaries[deviceIdx],
                         &pCacheIds[deviceIdx]);
 
+                    PipelineCompiler::RecordPipelineCreationPhase(
+                        &pBinaryCreateInfo->pipelineFeedback, PipelineCreationPhaseCompile, compileStartTime);
+
                     if (result == VK_SUCCESS && (pPipelineBinaries[deviceIdx].codeSize > 0))
                     {
                         result = pDefaultCompiler->WriteBinaryMetadata(
@@ -418,6 +428,7 @@ VkResult GraphicsPipeline::CreatePipelineObjects(
     const Util::MetroHash::Hash*        pCacheIds,
     uint64_t                            apiPsoHash,
     const PipelineBinaryStorage&        binaryStorage,
+    const uint64_t*                     pFastLinkLibraryHashes,
     GraphicsPipelineObjectCreateInfo*   pObjectCreateInfo,
     VkPipeline*                         pPipeline)
 {
@@ -440,9 +451,21 @@ VkResult GraphicsPipeline::CreatePipelineObjects(
     pObjectCreateInfo->pipeline.pipelineBinarySize = pPipelineBinaries[DefaultDeviceIndex].codeSize;
     pObjectCreateInfo->pipeline.pPipelineBinary    = pPipelineBinaries[DefaultDeviceIndex].pCode;
 
-    palSize =
-        pDevice->PalDevice(DefaultDeviceIndex)->GetGraphicsPipelineSize(pObjectCreateInfo->pipeline, &palResult);
-    VK_ASSERT(palResult == Pal::Result::Success);
+    // Fast-linked pipelines share their PAL pipeline objects through the device's link cache.  Developer mode may
+    // replace the binary of an individual pipeline and the device memory report tracks PAL suballocations per Vulkan
+    // pipeline, so neither can use shared objects.
+    GraphicsPipelineLinkCache* pLinkCache    = pDevice->GetGplLinkCache();
+    const bool                 useLinkCache  = (pFastLinkLibraryHashes != nullptr)                 &&
+                                               pLinkCache->IsEnabled()                             &&
+                                               (pDevice->VkInstance()->GetDevModeMgr() == nullptr) &&
+                                               (pDevice->GetEnabledFeatures().gpuMemoryEventHandler == false);
+
+    if (useLinkCache == false)
+    {
+        palSize =
+            pDevice->PalDevice(DefaultDeviceIndex)->GetGraphicsPipelineSize(pObjectCreateInfo->pipeline, &palResult);
+        VK_ASSERT(palResult == Pal::Result::Success);
+    }
 
     size_t     allocationSize        = sizeof(GraphicsPipeline) + (palSize * numPalDevices);
     const bool storeBinaryToPipeline = (flags & VK_PIPELINE_CREATE_2_CAPTURE_DATA_BIT_KHR) != 0;
@@ -463,7 +486,21 @@ VkResult GraphicsPipeline::CreatePipelineObjects(
 
     RenderStateCache* pRSCache = pDevice->GetRenderStateCache();
 
-    if (result == VK_SUCCESS)
+    if ((result == VK_SUCCESS) && useLinkCache)
+    {
+        Util::MetroHash::Hash linkKey  = {};
+        bool                  cacheHit  = false;
+
+        GraphicsPipelineLinkCache::BuildKey(pObjectCreateInfo->pipeline, pFastLinkLibraryHashes, flags, &linkKey);
+
+        result = pLinkCache->AcquirePalPipelines(linkKey, pObjectCreateInfo->pipeline, pPalPipeline, &cacheHit);
+
+        if (result == VK_SUCCESS)
+        {
+            pObjectCreateInfo->flags.sharedPalPipeline = true;
+        }
+    }
+    else if (result == VK_SUCCESS)
     {
         result = CreatePalPipelineObjects(pDevice,
             pPipelineCache,
@@ -638,11 +675,18 @@ VkResult GraphicsPipeline::CreatePipelineObjects(
         }
 
         // Something went wrong with creating the PAL object. Free memory and return error.
-        for (uint32_t deviceIdx = 0; deviceIdx < pDevice->NumPalDevices(); deviceIdx++)
+        if (pObjectCreateInfo->flags.sharedPalPipeline)
         {
-            if (pPalPipeline[deviceIdx] != nullptr)
+            pLinkCache->ReleasePalPipelines(pPalPipeline);
+        }
+        else
+        {
+            for (uint32_t deviceIdx = 0; deviceIdx < pDevice->NumPalDevices(); deviceIdx++)
             {
-                pPalPipeline[deviceIdx]->Destroy();
+                if (pPalPipeline[deviceIdx] != nullptr)
+                {
+                    pPalPipeline[deviceIdx]->Destroy();
+                }
             }
         }
 
@@ -913,6 +957,8 @@ VkResult GraphicsPipeline::Create(
 
     if (IsGplFastLinkPossible(pDevice, libInfo, &resourceLayout.userDataLayout) && (result == VK_SUCCESS))
     {
+        const int64_t convertStartTime = Util::GetPerfCpuTime();
+
         result = pDefaultCompiler->BuildGplFastLinkCreateInfo(pDevice,
                                                               pCreateInfo,
                                                               extStructs,
@@ -922,6 +968,9 @@ VkResult GraphicsPipeline::Create(
                                                               &binaryMetadata,
                                                               &binaryCreateInfo);
 
+        PipelineCompiler::RecordPipelineCreationPhase(
+            &binaryCreateInfo.pipelineFeedback, PipelineCreationPhaseConvertInfo, convertStartTime);
+
         if (result == VK_SUCCESS)
         {
             const GraphicsPipelineBinaryCreateInfo& preRasterCreateInfo =
@@ -967,6 +1016,8 @@ VkResult GraphicsPipeline::Create(
                 pDevice->GetRuntimeSettings().enablePipelineDump ||
                 pDevice->GetRuntimeSettings().logTagIdMask)
             {
+                const int64_t apiHashStartTime = Util::GetPerfCpuTime();
+
                 BuildApiHash(pCreateInfo,
                             flags,
                             extStructs,
@@ -975,6 +1026,9 @@ VkResult GraphicsPipeline::Create(
                             &apiPsoHash,
                             &elfHash);
                 binaryCreateInfo.apiPsoHash = apiPsoHash;
+
+                PipelineCompiler::RecordPipelineCreationPhase(
+                    &binaryCreateInfo.pipelineFeedback, PipelineCreationPhaseApiHash, apiHashStartTime);
             }
             enableFastLink = true;
         }
@@ -1161,6 +1215,8 @@ VkResult GraphicsPipeline::Create(
 #endif
 
             // 6. Create pipeline objects
+            const int64_t palCreateStartTime = Util::GetPerfCpuTime();
+
             result = CreatePipelineObjects(
                 pDevice,
                 pCreateInfo,
@@ -1175,9 +1231,13 @@ VkResult GraphicsPipeline::Create(
                 cacheId,
                 apiPsoHash,
                 binaryStorage,
+                enableFastLink ? binaryCreateInfo.libraryHash : nullptr,
                 &objectCreateInfo,
                 pPipeline);
 
+            PipelineCompiler::RecordPipelineCreationPhase(
+                &binaryCreateInfo.pipelineFeedback, PipelineCreationPhasePalCreate, palCreateStartTime);
+
             if (result != VK_SUCCESS)
             {
                 // Free the binaries only if we failed to create the pipeline objects.
@@ -1209,6 +1269,9 @@ VkResult GraphicsPipeline::Create(
         uint64_t duration = vk::utils::TicksToNano(durationTicks);
         binaryCreateInfo.pipelineFeedback.feedbackValid = true;
         binaryCreateInfo.pipelineFeedback.duration = duration;
+
+        pDefaultCompiler->GetTelemetry()->RecordPipelineCreation(
+            PipelineTelemetryType::Graphics, binaryCreateInfo.pipelineFeedback);
         PipelineCompiler::SetPipelineCreationFeedbackInfo(
             pPipelineCreationFeedbackCreateInfo,
             pCreateInfo->stageCount,
@@ -1317,7 +1380,9 @@ VkResult GraphicsPipeline::CreateCacheId(
     ShaderModuleHandle*                     pTempModules,
     Util::MetroHash::Hash*                  pCacheIds)
 {
-    VkResult result = VK_SUCCESS;
+    VkResult                  result    = VK_SUCCESS;
+    PipelineCreationFeedback* pFeedback = &pBinaryCreateInfo->pipelineFeedback;
+    int64_t                   phaseTime = Util::GetPerfCpuTime();
 
     // 1. Build shader stage infos
     result = BuildShaderStageInfo(pDevice,
@@ -1344,6 +1409,8 @@ VkResult GraphicsPipeline::CreateCacheId(
             pShaderOptimizerKeys,
             pPipelineOptimizerKey);
 
+        phaseTime = PipelineCompiler::RecordPipelineCreationPhase(pFeedback, PipelineCreationPhaseCacheId, phaseTime);
+
         // 3. Build API and ELF hashes
         BuildApiHash(pCreateInfo,
                      flags,
@@ -1352,6 +1419,7 @@ VkResult GraphicsPipeline::CreateCacheId(
                      *pBinaryCreateInfo,
                      pApiPsoHash,
                      pElfHash);
+        phaseTime = PipelineCompiler::RecordPipelineCreationPhase(pFeedback, PipelineCreationPhaseApiHash, phaseTime);
 
         // 4. Build Cache IDs
         for (uint32_t deviceIdx = 0; deviceIdx < pDevice->NumPalDevices(); ++deviceIdx)
@@ -1366,6 +1434,8 @@ VkResult GraphicsPipeline::CreateCacheId(
         }
     }
 
+    PipelineCompiler::RecordPipelineCreationPhase(pFeedback, PipelineCreationPhaseCacheId, phaseTime);
+
     return result;
 }
 
@@ -1681,6 +1751,17 @@ VkResult GraphicsPipeline::Destroy(
         pDevice->VkInstance()->FreeMem(const_cast<InternalMemory*>(m_pInternalMem));
     }
 
+    if (m_flags.sharedPalPipeline)
+    {
+        // The PAL pipelines belong to the link cache; clear them so Pipeline::Destroy() leaves them alone.
+        pDevice->GetGplLinkCache()->ReleasePalPipelines(m_pPalPipeline);
+
+        for (uint32_t deviceIdx = 0; deviceIdx < MaxPalDevices; deviceIdx++)
+        {
+            m_pPalPipeline[deviceIdx] = nullptr;
+        }
+    }
+
     return Pipeline::Destroy(pDevice, pAllocator);
 }
 
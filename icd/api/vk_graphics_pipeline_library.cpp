@@ -321,6 +321,7 @@ VkResult GraphicsPipelineLibrary::CreatePartialPipelineBinary(
 {
     VkResult          result            = VK_SUCCESS;
     PipelineCompiler* pCompiler         = pDevice->GetCompiler(DefaultDeviceIndex);
+    int64_t           phaseTime         = Util::GetPerfCpuTime();
 
     const uint32_t shaderBuildMask = GraphicsPipelineLibrary::CalculateShaderBuildMask(
         pDevice,
@@ -387,6 +388,9 @@ VkResult GraphicsPipelineLibrary::CreatePartialPipelineBinary(
         }
     }
 
+    phaseTime = PipelineCompiler::RecordPipelineCreationPhase(
+        &pBinaryCreateInfo->pipelineFeedback, PipelineCreationPhaseCompile, phaseTime);
+
     // Create shader libraries for fast-link
     for (uint32_t stage = 0; (result == VK_SUCCESS) && (stage < ShaderStage::ShaderStageGfxCount); ++stage)
     {
@@ -408,6 +412,9 @@ VkResult GraphicsPipelineLibrary::CreatePartialPipelineBinary(
         }
     }
 
+    PipelineCompiler::RecordPipelineCreationPhase(
+        &pBinaryCreateInfo->pipelineFeedback, PipelineCreationPhasePalCreate, phaseTime);
+
     // If there is no fragment shader when create fragment library, we use a null pal graphics library.
     if ((pLibInfo->libFlags & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) &&
         (pBinaryCreateInfo->pipelineInfo.fs.pModuleData == nullptr) &&
@@ -838,6 +845,9 @@ VkResult GraphicsPipelineLibrary::Create(
         pBinInfo->pipelineFeedback.feedbackValid = true;
         pBinInfo->pipelineFeedback.duration      = duration;
 
+        pCompiler->GetTelemetry()->RecordPipelineCreation(
+            PipelineTelemetryType::GraphicsLibrary, pBinInfo->pipelineFeedback);
+
         bool hitPipelineCache  = true;
         bool containValidStage = false;
         for (uint32_t i = 0; i < ShaderStage::ShaderStageGfxCount; ++i)
@@ -879,6 +889,9 @@ VkResult GraphicsPipelineLibrary::CreateCacheId(
     PipelineMetadata*                       pBinaryMetadata,
     Util::MetroHash::Hash*                  pCacheIds)
 {
+    PipelineCreationFeedback* pFeedback = &pBinaryCreateInfo->pipelineFeedback;
+    int64_t                   phaseTime = Util::GetPerfCpuTime();
+
     // 1. Build shader stage infos
     VkResult result = BuildShaderStageInfo(pDevice,
                                            pCreateInfo->stageCount,
@@ -903,6 +916,8 @@ VkResult GraphicsPipelineLibrary::CreateCacheId(
                                      pShaderOptimizerKeys,
                                      pPipelineOptimizerKey);
 
+        phaseTime = PipelineCompiler::RecordPipelineCreationPhase(pFeedback, PipelineCreationPhaseCacheId, phaseTime);
+
         // 3. Build API and ELF hashes
         BuildApiHash(pCreateInfo,
                      flags,
@@ -911,6 +926,7 @@ VkResult GraphicsPipelineLibrary::CreateCacheId(
                      *pBinaryCreateInfo,
                      pApiPsoHash,
                      pElfHash);
+        phaseTime = PipelineCompiler::RecordPipelineCreationPhase(pFeedback, PipelineCreationPhaseApiHash, phaseTime);
 
         // 4. Populate binary create info
         result = pDevice->GetCompiler(DefaultDeviceIndex)->ConvertGraphicsPipelineInfo(
@@ -924,6 +940,8 @@ VkResult GraphicsPipelineLibrary::CreateCacheId(
             pPipelineOptimizerKey,
             pBinaryMetadata,
             pBinaryCreateInfo);
+        phaseTime = PipelineCompiler::RecordPipelineCreationPhase(
+            pFeedback, PipelineCreationPhaseConvertInfo, phaseTime);
     }
 
     if (result == VK_SUCCESS)
@@ -943,6 +961,8 @@ VkResult GraphicsPipelineLibrary::CreateCacheId(
         }
     }
 
+    PipelineCompiler::RecordPipelineCreationPhase(pFeedback, PipelineCreationPhaseCacheId, phaseTime);
+
     return result;
 }
 
@@ -1023,6 +1043,11 @@ VkResult GraphicsPipelineLibrary::Destroy(
         pCompiler->FreeGplModuleState(&m_gplModuleStates[i]);
     }
 
+    // Links against this library's shader libraries must not outlive them in the link cache.
+    pDevice->GetGplLinkCache()->EvictShaderLibraries(
+        ArrayLen32(m_pBinaryCreateInfo->pShaderLibraries),
+        m_pBinaryCreateInfo->pShaderLibraries);
+
     for (uint32_t i = 0; i < ArrayLen(m_pBinaryCreateInfo->pShaderLibraries); ++i)
     {
         Pal::IShaderLibrary* pShaderLib = m_pBinaryCreateInfo->pShaderLibraries[i];
@@ -37,6 +37,7 @@
 #include "include/vk_physical_device.h"
 #include "include/vk_physical_device_manager.h"
 
+#include "include/shader_module_cache.h"
 #include "include/virtual_stack_mgr.h"
 
 #include "sqtt/sqtt_layer.h"
@@ -94,7 +95,8 @@ Instance::Instance(
     m_debugReportCallbacks(&m_palAllocator),
     m_debugUtilsMessengers(&m_palAllocator),
     m_logTagIdMask(0),
-    m_pGpuMemoryEventHandler(nullptr)
+    m_pGpuMemoryEventHandler(nullptr),
+    m_pShaderModuleCache(nullptr)
 {
     m_flags.u32All = 0;
 
@@ -517,6 +519,11 @@ VkResult Instance::Init(
             m_pPhysicalDeviceManager->Destroy();
         }
 
+        if (m_pShaderModuleCache != nullptr)
+        {
+            m_pShaderModuleCache->Destroy();
+        }
+
         if (m_pVirtualStackMgr != nullptr)
         {
             m_pVirtualStackMgr->Destroy();
@@ -685,6 +692,12 @@ VkResult Instance::Destroy(void)
         m_pPhysicalDeviceManager->Destroy();
     }
 
+    // Destroy the shared shader module cache, now that no compiler references it anymore
+    if (m_pShaderModuleCache != nullptr)
+    {
+        m_pShaderModuleCache->Destroy();
+    }
+
     // Destroy screens
     for (uint32_t i = 0; i < m_screenCount; ++i)
     {
@@ -723,6 +736,23 @@ VkResult Instance::Destroy(void)
     return VK_SUCCESS;
 }
 
+// =====================================================================================================================
+// Returns the shader module cache shared by all physical devices of this instance, creating it on first use with the
+// given entry limit. Returns nullptr if it can't be created.
+ShaderModuleCache* Instance::GetShaderModuleCache(
+    uint32_t maxEntries)
+{
+    Util::MutexAuto lock(&m_shaderModuleCacheMutex);
+
+    if (m_pShaderModuleCache == nullptr)
+    {
+        VkResult result = ShaderModuleCache::Create(this, maxEntries, &m_pShaderModuleCache);
+        VK_ALERT(result != VK_SUCCESS);
+    }
+
+    return m_pShaderModuleCache;
+}
+
 // =====================================================================================================================
 // Called when the physical devices in the system have been re-enumerated.
 void Instance::PhysicalDevicesChanged()
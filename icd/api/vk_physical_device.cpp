@@ -30,6 +30,7 @@
  */
 
 #include "include/khronos/vulkan.h"
+#include "include/binary_cache_serialization.h"
 #include "include/color_space_helper.h"
 #include "include/pipeline_binary_cache.h"
 #include "include/vk_buffer_view.h"
@@ -780,6 +781,7 @@ static void GenerateCacheUuid(
         uint32               palInterfaceVersion;
         uint32               osHash;
         uint32               buildTimeHash;
+        uint32               blobVersion;
     } cacheVersionInfo =
     {
         Util::HashLiteralString("pipelineCache"),
@@ -790,7 +792,8 @@ static void GenerateCacheUuid(
         VulkanIcdVersion,
         PAL_CLIENT_INTERFACE_MAJOR_VERSION,
         Util::HashLiteralString("Linux"),
-        buildTimeHash
+        buildTimeHash,
+        PipelineBinaryCacheBlobVersion
     };
 
     Util::Uuid::Uuid scope = {};
@@ -465,7 +465,8 @@ VkResult Pipeline::BuildShaderStageInfo(
                         pDevice,
                         flags | ShaderModuleForceUncached,
                         shaderBinary,
-                        &pTempModules[outIdx]);
+                        &pTempModules[outIdx],
+                        &codeHash);
 
                     pTempModules[outIdx].codeHash          = codeHash;
                     pShaderStageInfo[outIdx].pModuleHandle = &pTempModules[outIdx];
@@ -23,6 +23,7 @@
  *
  **********************************************************************************************************************/
 
+#include "include/log.h"
 #include "include/vk_conv.h"
 #include "include/vk_device.h"
 #include "include/vk_instance.h"
@@ -84,7 +85,10 @@ VkResult PipelineCache::Create(
                     size_t dataSize     = pCreateInfo->initialDataSize - sizeof(PipelineCacheHeaderData);
                     vk::PhysicalDevice* pPhysicalDevice = pDevice->VkPhysicalDevice(DefaultDeviceIndex);
 
-                    if (PipelineBinaryCache::IsValidBlob(pPhysicalDevice->VkInstance()->GetAllocCallbacks(),
+                    // With lazy validation, entries are checked one by one on first lookup instead of hashing a
+                    // potentially huge blob up front.  This also skips the platform key check, so it is opt-in.
+                    if (settings.pipelineCacheLazyValidation ||
+                        PipelineBinaryCache::IsValidBlob(pPhysicalDevice->VkInstance()->GetAllocCallbacks(),
                                                          pPhysicalDevice->GetPlatformKey(),
                                                          dataSize,
                                                          pData))
@@ -137,6 +141,12 @@ VkResult PipelineCache::Create(
 
             // This isn't a terminal failure, the device can continue without the pipeline cache if need be.
             VK_ALERT(pBinaryCache == nullptr);
+
+            if ((pBinaryCache != nullptr) && settings.pipelineCacheIncrementalSerialization)
+            {
+                // Entries from the initial data are already known to the application, only track what is new.
+                pBinaryCache->EnableGenerationTracking();
+            }
         }
         PipelineCache* pCache = VK_PLACEMENT_NEW(pMemory) PipelineCache(pDevice, pBinaryCache);
         *pPipelineCache = PipelineCache::HandleFromVoidPointer(pMemory);
@@ -176,7 +186,14 @@ VkResult PipelineCache::GetData(
 
     if (m_pBinaryCache != nullptr)
     {
-        result = m_pBinaryCache->Serialize(pData, pSize);
+        if (m_pBinaryCache->IsTrackingGenerations())
+        {
+            result = m_pBinaryCache->SerializeDelta(pData, pSize);
+        }
+        else
+        {
+            result = m_pBinaryCache->Serialize(pData, pSize);
+        }
     }
     else
     {
@@ -186,6 +203,130 @@ VkResult PipelineCache::GetData(
     return result;
 }
 
+// =====================================================================================================================
+// State shared by all threads merging source caches into a single binary cache
+struct PipelineCacheMergeState
+{
+    PipelineBinaryCache*                pBinaryCache;
+    const PipelineBinaryCache**         ppSrcCaches;
+    const PipelineBinaryCacheMergeList* pMergeList;    // Source cache IDs bucketed by hash space partition
+    volatile uint32_t                   nextPartition; // Index of the next partition to be picked up by a thread
+    VkResult*                           pResults;      // Merge result per partition
+    PipelineBinaryCacheMergeStats*      pStats;        // Merge statistics per partition
+};
+
+// =====================================================================================================================
+// Merges partitions of the hash space until none are left. Executed by the calling thread and the helper threads alike.
+static void MergeCachePartitions(
+    void* pPayload)
+{
+    auto pState = static_cast<PipelineCacheMergeState*>(pPayload);
+
+    uint32_t index = Util::AtomicIncrement(&pState->nextPartition) - 1;
+
+    while (index < pState->pMergeList->partitionCount)
+    {
+        pState->pResults[index] = pState->pBinaryCache->MergePartition(
+            pState->ppSrcCaches,
+            pState->pMergeList,
+            index,
+            &pState->pStats[index]);
+
+        index = Util::AtomicIncrement(&pState->nextPartition) - 1;
+    }
+}
+
+// =====================================================================================================================
+// Merges the source caches on the calling thread with the help of the compiler's worker threads. Each thread owns a
+// disjoint partition of the cache ID space, so an entry present in several sources is only ever copied once. The IDs
+// of every source are fetched once up front and bucketed by partition.
+static VkResult MergeParallel(
+    const Device*                  pDevice,
+    PipelineBinaryCache*           pBinaryCache,
+    uint32_t                       srcCacheCount,
+    const PipelineBinaryCache**    ppSrcCaches,
+    uint32_t                       helperCount,
+    PipelineBinaryCacheMergeStats* pStats)
+{
+    VkResult              finalResult = VK_SUCCESS;
+    PipelineCompiler*     pCompiler   = pDevice->GetCompiler(DefaultDeviceIndex);
+    DeferCompileTaskGroup helperGroup;
+
+    // Without the group the calling thread can't wait for helpers, so it merges all partitions by itself.
+    if (helperGroup.Init() != Util::Result::Success)
+    {
+        helperCount = 0;
+    }
+
+    const uint32_t partitionCount = helperCount + 1;
+
+    Util::AutoBuffer<VkResult, 8, PalAllocator>                      results(partitionCount,
+                                                                             pDevice->VkInstance()->Allocator());
+    Util::AutoBuffer<PipelineBinaryCacheMergeStats, 8, PalAllocator> stats(partitionCount,
+                                                                           pDevice->VkInstance()->Allocator());
+
+    PipelineBinaryCacheMergeList mergeList = {};
+
+    if ((results.Capacity() < partitionCount) || (stats.Capacity() < partitionCount))
+    {
+        finalResult = VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    else
+    {
+        finalResult = pBinaryCache->BuildMergeList(srcCacheCount, ppSrcCaches, partitionCount, &mergeList);
+    }
+
+    if (finalResult == VK_SUCCESS)
+    {
+        PipelineCacheMergeState state = {};
+        state.pBinaryCache   = pBinaryCache;
+        state.ppSrcCaches    = ppSrcCaches;
+        state.pMergeList     = &mergeList;
+        state.nextPartition  = 0;
+        state.pResults       = &results[0];
+        state.pStats         = &stats[0];
+
+        for (uint32_t i = 0; i < partitionCount; ++i)
+        {
+            stats[i] = {};
+        }
+
+        DeferredCompileWorkload helperWorkload = {};
+        helperWorkload.pPayloads = &state;
+        helperWorkload.Execute   = &MergeCachePartitions;
+        helperWorkload.pGroup    = &helperGroup;
+        helperWorkload.priority  = DeferCompilePriority::High;
+
+        helperGroup.AddTasks(helperCount);
+
+        for (uint32_t i = 0; i < helperCount; ++i)
+        {
+            pCompiler->ExecuteDeferCompile(&helperWorkload);
+        }
+
+        // The calling thread takes part in the merge as well and then runs the helpers no worker has picked up yet,
+        // which guarantees progress if the helper threads are busy with other work.
+        MergeCachePartitions(&state);
+
+        pCompiler->WaitDeferCompileGroup(&helperGroup);
+
+        for (uint32_t i = 0; i < partitionCount; ++i)
+        {
+            if ((finalResult == VK_SUCCESS) && (results[i] != VK_SUCCESS))
+            {
+                finalResult = results[i];
+            }
+
+            pStats->mergedCount    += stats[i].mergedCount;
+            pStats->duplicateCount += stats[i].duplicateCount;
+        }
+    }
+
+    pBinaryCache->FreeMergeList(&mergeList);
+
+    return finalResult;
+}
+
 // =====================================================================================================================
 VkResult PipelineCache::Merge(
     uint32_t              srcCacheCount,
@@ -199,12 +340,42 @@ VkResult PipelineCache::Merge(
             srcCacheCount,
             m_pDevice->VkInstance()->Allocator());
 
-        for (uint32_t cacheIdx = 0; cacheIdx < srcCacheCount; cacheIdx++)
+        if (binaryCaches.Capacity() < srcCacheCount)
         {
-            binaryCaches[cacheIdx] = ppSrcCaches[cacheIdx]->GetPipelineCache();
+            result = VK_ERROR_OUT_OF_HOST_MEMORY;
         }
+        else
+        {
+            for (uint32_t cacheIdx = 0; cacheIdx < srcCacheCount; cacheIdx++)
+            {
+                binaryCaches[cacheIdx] = ppSrcCaches[cacheIdx]->GetPipelineCache();
+            }
+
+            PipelineBinaryCacheMergeStats stats = {};
+
+            // Merging a single source doesn't have enough work to be worth spreading across threads.  The helpers
+            // run on the compiler's worker threads, so the merge stays serial unless PipelineCreateThreadCount
+            // enables them.
+            const uint32_t helperCount = (srcCacheCount > 1) ?
+                Util::Min(m_pDevice->GetCompiler(DefaultDeviceIndex)->GetDeferCompileThreadCount(), srcCacheCount - 1) :
+                0;
+
+            if (helperCount > 0)
+            {
+                result = MergeParallel(m_pDevice, m_pBinaryCache, srcCacheCount, &binaryCaches[0], helperCount, &stats);
+            }
+            else
+            {
+                result = m_pBinaryCache->Merge(srcCacheCount, &binaryCaches[0], &stats);
+            }
 
-        result = m_pBinaryCache->Merge(srcCacheCount, &binaryCaches[0]);
+            AmdvlkLog(m_pDevice->GetRuntimeSettings().logTagIdMask,
+                      GeneralPrint,
+                      "Merged %u pipeline caches: %llu entries merged, %llu duplicates skipped",
+                      srcCacheCount,
+                      stats.mergedCount,
+                      stats.duplicateCount);
+        }
     }
 
     return result;
@@ -257,7 +428,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetPipelineCacheData(
         return VK_SUCCESS;
     }
 
-    if (nBytesRequested < fullDataSize)
+    if (nBytesRequested < VkPipelineCacheHeaderDataSize)
     {
         // "If pDataSize is less than what is necessary to store this header, nothing will be written to pData and
         // zero will be written to pDataSize."
@@ -265,6 +436,13 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetPipelineCacheData(
 
         result = VK_INCOMPLETE;
     }
+    else if (nBytesRequested < fullDataSize)
+    {
+        // The cache may have grown since the application queried the size. "If pDataSize is less than the maximum size
+        // that can be retrieved by the pipeline cache, at most pDataSize bytes will be written to pData, and
+        // VK_INCOMPLETE will be returned."
+        privateDataSize = nBytesRequested - VkPipelineCacheHeaderDataSize;
+    }
 
     // The vk spec says the data should be written least significant byte first.
 #ifdef BIGENDIAN_CPU
@@ -298,6 +476,10 @@ VKAPI_ATTR VkResult VKAPI_CALL vkGetPipelineCacheData(
                 void* pPrivateData = Util::VoidPtrInc(pData, headerBytesWritten);
                 result = pCache->GetData(pPrivateData, &privateDataSize);
             }
+            else if (fullDataSize > headerBytesWritten)
+            {
+                result = VK_INCOMPLETE;
+            }
             // set pDataSize, privateDataSize can be 0.
             *pDataSize = privateDataSize + headerBytesWritten;
         }
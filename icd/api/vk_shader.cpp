@@ -212,7 +212,8 @@ VkResult ShaderModule::Init(
         pDevice,
         m_flags,
         shaderBinary,
-        &m_handle);
+        &m_handle,
+        &m_codeHash);
 
     m_handle.codeHash = m_codeHash;
 